@@ -50,12 +50,89 @@
 #include "soc_AM335x.h"
 #include "hw_cm_per.h"
 #include "hw_types.h"
+#include <string.h>
+#include "cache.h"
+#include "../interrupt/dr_interrupt.h"
+#include "../watch/dr_watch.h"
+
+/****************************************************************************/
+/*                      INTERNAL MACRO DEFINITIONS                          */
+/****************************************************************************/
+
+/* Count leading zeros, maps to the ARM CLZ instruction. Undefined for 0. */
+#if defined(__TI_COMPILER_VERSION__)
+#define EDMA3_CLZ(x)                          ((unsigned int)_norm(x))
+#else
+#define EDMA3_CLZ(x)                          ((unsigned int)__builtin_clz(x))
+#endif
+
+/* Index of the highest set bit of a non-zero word */
+#define EDMA3_MSB(x)                          (31u - EDMA3_CLZ(x))
+
+/* Instrumentation hooks, compiled out unless EDMA3_TRACE_ENABLED is set */
+#ifdef EDMA3_TRACE_ENABLED
+#define EDMA3_TRACE_SUBMIT(baseAdd, chNum)    EDMA3TraceSubmit(baseAdd, chNum)
+#define EDMA3_TRACE_COMPLETE(tccNum)          EDMA3TraceComplete(tccNum)
+#define EDMA3_TRACE_ERROR(chNum)              EDMA3TraceError(chNum)
+#define EDMA3_TRACE_QUEUE_ERROR(pending)      EDMA3TraceQueueError(pending)
+#else
+#define EDMA3_TRACE_SUBMIT(baseAdd, chNum)
+#define EDMA3_TRACE_COMPLETE(tccNum)
+#define EDMA3_TRACE_ERROR(chNum)
+#define EDMA3_TRACE_QUEUE_ERROR(pending)
+#endif
 
 /****************************************************************************/
 /*                         GLOBAL VARIABLES                                 */
 /****************************************************************************/
 unsigned int regionId;
 
+/* Per TCC callback registry used by the completion and error handlers */
+static struct {
+    EDMA3Callback cbFxn;
+    void *ctx;
+} edma3CbRegistry[EDMA3_NUM_TCC];
+
+/* Instance serviced by the interrupt handlers installed by EDMA3IntrSetup */
+static unsigned int edma3IntrBaseAdd;
+
+/*
+** Default QoS policy: real-time clients get queue 0 with the highest
+** priority and a low watermark so that backlog shows up as a CC error,
+** latency sensitive clients queue 1, bulk transfers (SD, memcpy) queue 2
+** with the lowest priority.
+*/
+static EDMA3QosClassCfg edma3QosCfg[EDMA3_QOS_NUM_CLASSES] = {
+    /* EDMA3_QOS_CLASS_BULK */
+    { 2u, EDMA3_QOS_PRI_LOWEST, EDMA3_QOS_WM_DISABLE },
+    /* EDMA3_QOS_CLASS_LATENCY */
+    { 1u, 3u, 8u },
+    /* EDMA3_QOS_CLASS_REALTIME */
+    { 0u, EDMA3_QOS_PRI_HIGHEST, 2u }
+};
+
+/* Source block of EDMA3MemFill, read again for every array */
+#define EDMA3_FILL_PATTERN_SIZE               (64u)
+#pragma DATA_ALIGN(edma3FillPattern, 64);
+static unsigned char edma3FillPattern[EDMA3_FILL_PATTERN_SIZE];
+
+static void EDMA3ComplIsr(void);
+static void EDMA3CCErrIsr(void);
+
+#ifdef EDMA3_TRACE_ENABLED
+/* Statistics per DMA channel and the channel owning each TCC */
+static EDMA3ChStats edma3Stats[SOC_EDMA3_NUM_DMACH];
+static unsigned char edma3TccToCh[EDMA3_NUM_TCC];
+
+/* Queue threshold errors per event queue */
+static unsigned int edma3QueueErr[SOC_EDMA3_NUM_EVQUE];
+
+static void EDMA3TraceSubmit(unsigned int baseAdd, unsigned int chNum);
+static void EDMA3TraceComplete(unsigned int tccNum);
+static void EDMA3TraceError(unsigned int chNum);
+static void EDMA3TraceQueueError(unsigned int pending);
+#endif
+
 /****************************************************************************/
 /*                     API FUNCTION DEFINITIONS                             */
 /****************************************************************************/
@@ -93,6 +170,12 @@ void EDMA3Init(unsigned int baseAdd,
     regionId = (unsigned int)0u;
 #endif
 
+#ifdef EDMA3_TRACE_ENABLED
+    /* Latencies are measured with the CPU cycle counter */
+    WatchCycleCounterInit();
+    EDMA3TraceReset();
+#endif
+
     /* Clear the Event miss Registers                                       */
     HWREG(baseAdd + EDMA3CC_EMCR) = EDMA3_SET_ALL_BITS;
     HWREG(baseAdd + EDMA3CC_EMCRH) = EDMA3_SET_ALL_BITS;
@@ -1260,6 +1343,7 @@ unsigned int EDMA3EnableTransfer(unsigned int baseAdd,
         case EDMA3_TRIG_MODE_MANUAL :
             if (chNum < SOC_EDMA3_NUM_DMACH)
             {
+                EDMA3_TRACE_SUBMIT(baseAdd, chNum);
                 EDMA3SetEvt(baseAdd, chNum);
                 retVal = TRUE;
             }
@@ -1279,6 +1363,8 @@ unsigned int EDMA3EnableTransfer(unsigned int baseAdd,
                 /*clear SECR & EMCR to clean any previous NULL request    */
                 EDMA3ClrMissEvt(baseAdd, chNum);
 
+                EDMA3_TRACE_SUBMIT(baseAdd, chNum);
+
                 /* Set EESR to enable event                               */
                 EDMA3EnableDmaEvt(baseAdd, chNum);
                 retVal = TRUE;
@@ -1814,4 +1900,798 @@ void EDMAModuleClkConfig(void)
 
 
 
+/**
+ *  \brief   Registers a callback for a transfer completion code.
+ *
+ *  The callback is invoked from EDMA3ComplHandlerIsr() when the IPR/IPRH bit
+ *  of the TCC is set and from EDMA3CCErrHandlerIsr() when an event of the
+ *  channel with the same number was missed. Registering a new callback for
+ *  a TCC replaces the previous one.
+ *
+ *  \param   tccNum      Transfer completion code (0 - 63).\n
+ *
+ *  \param   cbFxn       Function to call, NULL removes the registration.\n
+ *
+ *  \param   ctx         Opaque pointer handed back to the callback.\n
+ *
+ *  \return  TRUE if the TCC is valid, else FALSE
+ */
+unsigned int EDMA3RegisterCallback(unsigned int tccNum,
+                                   EDMA3Callback cbFxn,
+                                   void *ctx)
+{
+    if(tccNum >= EDMA3_NUM_TCC)
+    {
+         return FALSE;
+    }
+
+    /* Clear the callback first so that the ISR never sees a stale ctx */
+    edma3CbRegistry[tccNum].cbFxn = NULL;
+    edma3CbRegistry[tccNum].ctx = ctx;
+    edma3CbRegistry[tccNum].cbFxn = cbFxn;
+
+    return TRUE;
+}
+
+/**
+ *  \brief   Removes the callback registered for a transfer completion code.
+ *
+ *  \param   tccNum      Transfer completion code (0 - 63).\n
+ *
+ *  \return  None
+ */
+void EDMA3UnregisterCallback(unsigned int tccNum)
+{
+    if(tccNum < EDMA3_NUM_TCC)
+    {
+         edma3CbRegistry[tccNum].cbFxn = NULL;
+         edma3CbRegistry[tccNum].ctx = NULL;
+    }
+}
+
+/*
+** Dispatches all set bits of a pending word, highest TCC first. Every bit is
+** acknowledged before its callback runs so a callback may start the next
+** transfer on the same TCC.
+*/
+static void EDMA3DispatchPending(unsigned int baseAdd,
+                                 unsigned int pending,
+                                 unsigned int tccBase)
+{
+    unsigned int bit;
+    unsigned int tccNum;
+
+    while(pending)
+    {
+         bit = EDMA3_MSB(pending);
+         pending &= ~(1u << bit);
+         tccNum = tccBase + bit;
+
+         EDMA3ClrIntr(baseAdd, tccNum);
+         EDMA3_TRACE_COMPLETE(tccNum);
+
+         if(edma3CbRegistry[tccNum].cbFxn != NULL)
+         {
+              edma3CbRegistry[tccNum].cbFxn(tccNum, EDMA3_XFER_COMPLETE,
+                                            edma3CbRegistry[tccNum].ctx);
+         }
+    }
+}
+
+/**
+ *  \brief   Transfer completion interrupt handler.
+ *
+ *  Services all pending TCCs of the shadow region in IPR and IPRH and calls
+ *  the registered callbacks. Instead of polling IPR again, IEVAL is written
+ *  at the end so that completions which arrived during dispatch re-assert
+ *  the interrupt.
+ *
+ *  \param   baseAdd     Memory address of the EDMA instance used.\n
+ *
+ *  \return  None
+ */
+void EDMA3ComplHandlerIsr(unsigned int baseAdd)
+{
+    EDMA3DispatchPending(baseAdd, EDMA3GetIntrStatus(baseAdd), 0u);
+    EDMA3DispatchPending(baseAdd, EDMA3IntrStatusHighGet(baseAdd), 32u);
+
+    HWREG(baseAdd + EDMA3CC_S_IEVAL(regionId)) =
+                            EDMA3CC_IEVAL_EVAL << EDMA3CC_IEVAL_EVAL_SHIFT;
+}
+
+/*
+** Clears the missed events of one EMR/EMRH word and reports them to the
+** callbacks of the affected channels.
+*/
+static void EDMA3DispatchMissed(unsigned int baseAdd,
+                                unsigned int pending,
+                                unsigned int chBase)
+{
+    unsigned int bit;
+    unsigned int chNum;
+
+    while(pending)
+    {
+         bit = EDMA3_MSB(pending);
+         pending &= ~(1u << bit);
+         chNum = chBase + bit;
+
+         EDMA3ClrMissEvt(baseAdd, chNum);
+         EDMA3_TRACE_ERROR(chNum);
+
+         if(edma3CbRegistry[chNum].cbFxn != NULL)
+         {
+              edma3CbRegistry[chNum].cbFxn(chNum, EDMA3_CC_DMA_EVT_MISS,
+                                           edma3CbRegistry[chNum].ctx);
+         }
+    }
+}
+
+/**
+ *  \brief   Channel controller error interrupt handler.
+ *
+ *  Decodes missed DMA events per channel (EMR/EMRH), missed QDMA events
+ *  (QEMR) and the CC error register (queue threshold and TCC errors).
+ *  Missed DMA events are reported to the callback registered for the
+ *  channel number with EDMA3_CC_DMA_EVT_MISS, a TCC error is reported to
+ *  every registered callback with EDMA3_CC_TCC_ERR since CCERR does not
+ *  name the TCC. EEVAL is written at the end to re-evaluate late errors.
+ *
+ *  \param   baseAdd     Memory address of the EDMA instance used.\n
+ *
+ *  \return  None
+ */
+void EDMA3CCErrHandlerIsr(unsigned int baseAdd)
+{
+    unsigned int pending;
+    unsigned int bit;
+    unsigned int tccNum;
+
+    EDMA3DispatchMissed(baseAdd, EDMA3GetErrIntrStatus(baseAdd), 0u);
+    EDMA3DispatchMissed(baseAdd, EDMA3ErrIntrHighStatusGet(baseAdd), 32u);
+
+    pending = EDMA3QdmaGetErrIntrStatus(baseAdd);
+    while(pending)
+    {
+         bit = EDMA3_MSB(pending);
+         pending &= ~(1u << bit);
+         EDMA3QdmaClrMissEvt(baseAdd, bit);
+    }
+
+    pending = EDMA3GetCCErrStatus(baseAdd);
+    if(pending != 0u)
+    {
+         /* Queue threshold errors, one bit per event queue */
+         EDMA3_TRACE_QUEUE_ERROR(pending);
+         EDMA3ClrCCErr(baseAdd, pending & ((1u << SOC_EDMA3_NUM_EVQUE) - 1u));
+
+         if(pending & EDMA3CC_CCERR_TCCERR)
+         {
+              EDMA3ClrCCErr(baseAdd, EDMA3CC_CLR_TCCERR);
+
+              for(tccNum = 0; tccNum < EDMA3_NUM_TCC; tccNum++)
+              {
+                   if(edma3CbRegistry[tccNum].cbFxn != NULL)
+                   {
+                        EDMA3_TRACE_ERROR(tccNum);
+                        edma3CbRegistry[tccNum].cbFxn(tccNum, EDMA3_CC_TCC_ERR,
+                                                      edma3CbRegistry[tccNum].ctx);
+                   }
+              }
+         }
+    }
+
+    EDMA3CCErrorEvaluate(baseAdd);
+}
+
+static void EDMA3ComplIsr(void)
+{
+    EDMA3ComplHandlerIsr(edma3IntrBaseAdd);
+}
+
+static void EDMA3CCErrIsr(void)
+{
+    EDMA3CCErrHandlerIsr(edma3IntrBaseAdd);
+}
+
+/**
+ *  \brief   Registers and enables the EDMA3CC completion and error
+ *           interrupts in the AINTC.
+ *
+ *  Clients only register their callbacks with EDMA3RegisterCallback(),
+ *  the handlers are shared. Calling this more than once is harmless.
+ *
+ *  \param   baseAdd     Memory address of the EDMA instance used.\n
+ *
+ *  \return  None
+ */
+void EDMA3IntrSetup(unsigned int baseAdd)
+{
+    edma3IntrBaseAdd = baseAdd;
+
+    IntRegister(SYS_INT_EDMACOMPINT, EDMA3ComplIsr);
+    IntRegister(SYS_INT_EDMAERRINT, EDMA3CCErrIsr);
+
+    IntHandlerEnable(SYS_INT_EDMACOMPINT);
+    IntHandlerEnable(SYS_INT_EDMAERRINT);
+}
+
+/**
+ *  \brief   Applies the QoS policy of the DMA client classes.
+ *
+ *  Programs the queue priorities (QUEPRI) and the watermark thresholds
+ *  (QWMTHRA) of the event queues used by the classes. Channels requested
+ *  with EDMA3QosRequestChannel() afterwards are mapped to the event queue
+ *  of their class. Classes may share a queue, the settings of the class
+ *  with the higher index win in that case.
+ *
+ *  \param   baseAdd     Memory address of the EDMA instance used.\n
+ *
+ *  \param   cfg         Array of EDMA3_QOS_NUM_CLASSES entries indexed by
+ *                       class, NULL applies the built-in defaults.\n
+ *
+ *  \return  None
+ */
+void EDMA3QosConfig(unsigned int baseAdd,
+                    const EDMA3QosClassCfg *cfg)
+{
+    unsigned int qosClass;
+    unsigned int evtQNum;
+    unsigned int shift;
+
+    for(qosClass = 0; qosClass < EDMA3_QOS_NUM_CLASSES; qosClass++)
+    {
+         if(cfg != NULL)
+         {
+              edma3QosCfg[qosClass] = cfg[qosClass];
+         }
+
+         evtQNum = edma3QosCfg[qosClass].evtQNum % EDMA3_AM335X_NUM_EVTQUE;
+         edma3QosCfg[qosClass].evtQNum = evtQNum;
+
+         /* PRIQn is a 3 bit field every 4 bits */
+         shift = evtQNum * 4u;
+         HWREG(baseAdd + EDMA3CC_QUEPRI) &= ~(0x7u << shift);
+         HWREG(baseAdd + EDMA3CC_QUEPRI) |=
+                        (edma3QosCfg[qosClass].priority & 0x7u) << shift;
+
+         /* Qn watermark threshold is a 5 bit field every 8 bits */
+         shift = evtQNum * 8u;
+         HWREG(baseAdd + EDMA3CC_QWMTHRA) &= ~(0x1Fu << shift);
+         HWREG(baseAdd + EDMA3CC_QWMTHRA) |=
+                        (edma3QosCfg[qosClass].watermark & 0x1Fu) << shift;
+    }
+}
+
+/**
+ *  \brief   Returns the event queue assigned to a DMA client class.
+ *
+ *  \param   qosClass    One of the EDMA3_QOS_CLASS_* values.\n
+ *
+ *  \return  Event queue number, queue of the bulk class if the class is
+ *           invalid
+ */
+unsigned int EDMA3QosEvtQGet(unsigned int qosClass)
+{
+    if(qosClass >= EDMA3_QOS_NUM_CLASSES)
+    {
+         qosClass = EDMA3_QOS_CLASS_BULK;
+    }
+
+    return edma3QosCfg[qosClass].evtQNum;
+}
+
+/**
+ *  \brief   Requests a channel on the event queue of a DMA client class.
+ *
+ *  Same as EDMA3RequestChannel() but the event queue is chosen by the
+ *  QoS policy instead of the caller.
+ *
+ *  \param   baseAdd     Memory address of the EDMA instance used.\n
+ *
+ *  \param   chType      EDMA3_CHANNEL_TYPE_DMA or EDMA3_CHANNEL_TYPE_QDMA.\n
+ *
+ *  \param   chNum       Channel number.\n
+ *
+ *  \param   tccNum      Transfer completion code.\n
+ *
+ *  \param   qosClass    One of the EDMA3_QOS_CLASS_* values.\n
+ *
+ *  \return  TRUE if parameters are valid, else FALSE
+ */
+unsigned int EDMA3QosRequestChannel(unsigned int baseAdd, unsigned int chType,
+                                    unsigned int chNum, unsigned int tccNum,
+                                    unsigned int qosClass)
+{
+    return EDMA3RequestChannel(baseAdd, chType, chNum, tccNum,
+                               EDMA3QosEvtQGet(qosClass));
+}
+
+/**
+ *  \brief   Returns the highest fill level an event queue reached.
+ *
+ *  \param   baseAdd     Memory address of the EDMA instance used.\n
+ *
+ *  \param   evtQNum     Event queue number.\n
+ *
+ *  \return  Watermark (WM field of QSTATn), number of queue entries
+ */
+unsigned int EDMA3QosWatermarkGet(unsigned int baseAdd,
+                                  unsigned int evtQNum)
+{
+    return (HWREG(baseAdd + EDMA3CC_QSTAT(evtQNum)) & EDMA3CC_QSTAT_WM) >>
+                                                     EDMA3CC_QSTAT_WM_SHIFT;
+}
+
+/*
+** Completion callback of the benchmark channels, ctx points to a flag.
+*/
+static void EDMA3QosBenchCallback(unsigned int tccNum, unsigned int status,
+                                  void *ctx)
+{
+    *(volatile unsigned int *)ctx = 1;
+}
+
+/*
+** Programs a manually triggered, AB-synchronized memory transfer of bCnt
+** arrays of aCnt bytes which completes with one trigger and interrupts on
+** the channel's TCC. srcBIdx is the source step between the arrays, aCnt
+** for a copy, 0 to read the same source block for every array.
+*/
+static void EDMA3MemParamSet(unsigned int baseAdd, unsigned int chNum,
+                             void *src, void *dst, unsigned int aCnt,
+                             unsigned int bCnt, unsigned int srcBIdx)
+{
+    EDMA3CCPaRAMEntry paramSet;
+
+    paramSet.srcAddr    = (unsigned int)src;
+    paramSet.destAddr   = (unsigned int)dst;
+    paramSet.aCnt       = (unsigned short)aCnt;
+    paramSet.bCnt       = (unsigned short)bCnt;
+    paramSet.cCnt       = 1;
+    paramSet.srcBIdx    = (short)srcBIdx;
+    paramSet.destBIdx   = (short)aCnt;
+    paramSet.srcCIdx    = 0;
+    paramSet.destCIdx   = 0;
+    paramSet.bCntReload = 0;
+    paramSet.linkAddr   = 0xffff;
+    paramSet.rsvd       = 0;
+    paramSet.opt        = EDMA3CC_OPT_TCC_SET(chNum) |
+                          (1u << EDMA3CC_OPT_TCINTEN_SHIFT) |
+                          (1u << EDMA3CC_OPT_SYNCDIM_SHIFT);
+
+    EDMA3SetPaRAM(baseAdd, chNum, &paramSet);
+}
+
+/**
+ *  \brief   Measures small transfer latency while a bulk copy is running.
+ *
+ *  A bulk memory copy is kept running on bulkCh (re-triggered as soon as
+ *  it completes) while small copies are triggered on smallCh one after the
+ *  other. The trigger to completion time of every small copy is measured
+ *  with the CPU cycle counter. Running it once with both channels in the
+ *  same class and once in different classes shows the effect of the queue
+ *  assignment. Interrupts and EDMA3IntrSetup() must be active, the
+ *  channels must be free and are released afterwards.
+ *
+ *  \param   baseAdd     Memory address of the EDMA instance used.\n
+ *  \param   bulkCh      Channel for the bulk copy.\n
+ *  \param   bulkClass   QoS class of the bulk channel.\n
+ *  \param   bulkSrc     Source of the bulk copy.\n
+ *  \param   bulkDst     Destination of the bulk copy.\n
+ *  \param   bulkLen     Bytes of the bulk copy, multiple of 1024.\n
+ *  \param   smallCh     Channel for the small copies.\n
+ *  \param   smallClass  QoS class of the small channel.\n
+ *  \param   smallSrc    Source of the small copies.\n
+ *  \param   smallDst    Destination of the small copies.\n
+ *  \param   smallLen    Bytes per small copy (1 - 65535).\n
+ *  \param   samples     Number of small copies.\n
+ *  \param   result      Latency statistics.\n
+ *
+ *  \return  TRUE on success, FALSE if a parameter is invalid or a small
+ *           copy did not complete
+ */
+unsigned int EDMA3QosLatencyBench(unsigned int baseAdd,
+                                  unsigned int bulkCh, unsigned int bulkClass,
+                                  void *bulkSrc, void *bulkDst,
+                                  unsigned int bulkLen,
+                                  unsigned int smallCh, unsigned int smallClass,
+                                  void *smallSrc, void *smallDst,
+                                  unsigned int smallLen,
+                                  unsigned int samples,
+                                  EDMA3QosBenchResult *result)
+{
+    volatile unsigned int bulkDone = 0;
+    volatile unsigned int smallDone = 0;
+    volatile unsigned int timeOut;
+    unsigned long long latTotal = 0;
+    unsigned int retVal = TRUE;
+    unsigned int stamp;
+    unsigned int lat;
+    unsigned int i;
+
+    if((bulkCh == smallCh) || (bulkCh >= SOC_EDMA3_NUM_DMACH) ||
+       (smallCh >= SOC_EDMA3_NUM_DMACH) || (bulkLen < 1024u) ||
+       ((bulkLen >> 10) > 0xFFFFu) || (smallLen == 0) ||
+       (smallLen > 0xFFFFu) || (samples == 0) || (result == NULL))
+    {
+         return FALSE;
+    }
+
+    memset(result, 0, sizeof(*result));
+    WatchCycleCounterInit();
+
+    EDMA3QosRequestChannel(baseAdd, EDMA3_CHANNEL_TYPE_DMA, bulkCh, bulkCh,
+                           bulkClass);
+    EDMA3QosRequestChannel(baseAdd, EDMA3_CHANNEL_TYPE_DMA, smallCh, smallCh,
+                           smallClass);
+    EDMA3RegisterCallback(bulkCh, EDMA3QosBenchCallback, (void *)&bulkDone);
+    EDMA3RegisterCallback(smallCh, EDMA3QosBenchCallback, (void *)&smallDone);
+
+    EDMA3MemParamSet(baseAdd, bulkCh, bulkSrc, bulkDst, 1024u,
+                     bulkLen >> 10, 1024u);
+    EDMA3EnableTransfer(baseAdd, bulkCh, EDMA3_TRIG_MODE_MANUAL);
+
+    for(i = 0; i < samples; i++)
+    {
+         if(bulkDone)
+         {
+              /* Keep the bulk copy running, PaRAM was consumed */
+              bulkDone = 0;
+              result->bulkXfers++;
+              EDMA3MemParamSet(baseAdd, bulkCh, bulkSrc, bulkDst, 1024u,
+                               bulkLen >> 10, 1024u);
+              EDMA3EnableTransfer(baseAdd, bulkCh, EDMA3_TRIG_MODE_MANUAL);
+         }
+
+         smallDone = 0;
+         EDMA3MemParamSet(baseAdd, smallCh, smallSrc, smallDst, smallLen, 1,
+                          smallLen);
+
+         stamp = WatchCycleCountGet();
+         EDMA3EnableTransfer(baseAdd, smallCh, EDMA3_TRIG_MODE_MANUAL);
+
+         timeOut = 0xFFFFFF;
+         while((smallDone == 0) && (timeOut-- != 0));
+         lat = WatchCycleCountGet() - stamp;
+
+         if(smallDone == 0)
+         {
+              retVal = FALSE;
+              break;
+         }
+
+         if((result->samples == 0) || (lat < result->latMin))
+         {
+              result->latMin = lat;
+         }
+         if(lat > result->latMax)
+         {
+              result->latMax = lat;
+         }
+         latTotal += lat;
+         result->samples++;
+    }
+
+    /* Let the last bulk copy drain before the channel is released */
+    timeOut = 0xFFFFFF;
+    while((bulkDone == 0) && (timeOut-- != 0));
+
+    if(result->samples != 0)
+    {
+         result->latAvg = (unsigned int)(latTotal / result->samples);
+    }
+
+    EDMA3UnregisterCallback(bulkCh);
+    EDMA3UnregisterCallback(smallCh);
+    EDMA3FreeChannel(baseAdd, EDMA3_CHANNEL_TYPE_DMA, bulkCh,
+                     EDMA3_TRIG_MODE_MANUAL, bulkCh,
+                     EDMA3QosEvtQGet(bulkClass));
+    EDMA3FreeChannel(baseAdd, EDMA3_CHANNEL_TYPE_DMA, smallCh,
+                     EDMA3_TRIG_MODE_MANUAL, smallCh,
+                     EDMA3QosEvtQGet(smallClass));
+
+    return retVal;
+}
+
+/*
+** Completion callback of EDMA3MemFill, ctx points to the state of the chunk:
+** 1 when it completed, 2 on an error of the channel.
+*/
+static void EDMA3MemFillCallback(unsigned int tccNum, unsigned int status,
+                                 void *ctx)
+{
+    *(volatile unsigned int *)ctx = (status == EDMA3_XFER_COMPLETE) ? 1u : 2u;
+}
+
+/**
+ *  \brief   Fills memory with a byte value by DMA.
+ *
+ *  The source of every array is the same pattern block (SRCBIDX 0), so no
+ *  source buffer of the destination size is needed. Chunks of up to 0xFFFF
+ *  arrays are triggered one after the other, the remainder below the
+ *  pattern size is set by the CPU. Interrupts and EDMA3IntrSetup() must be
+ *  active. The channel is requested with EDMA3RequestChannel() for the fill
+ *  and released afterwards; a channel with a registered callback belongs to
+ *  another client and is refused.
+ *
+ *  \param   baseAdd     Memory address of the EDMA instance used.\n
+ *  \param   chNum       Channel used for the fill.\n
+ *  \param   qosClass    QoS class of the channel.\n
+ *  \param   dst         Start of the memory to fill.\n
+ *  \param   value       Byte value written.\n
+ *  \param   len         Number of bytes to fill.\n
+ *
+ *  \return  TRUE if all chunks completed, FALSE on an invalid or busy
+ *           channel, an error of the channel or a timeout.
+ */
+unsigned int EDMA3MemFill(unsigned int baseAdd, unsigned int chNum,
+                          unsigned int qosClass, void *dst,
+                          unsigned char value, unsigned int len)
+{
+    volatile unsigned int done;
+    volatile unsigned int timeOut;
+    unsigned char *ptr = (unsigned char *)dst;
+    unsigned int retVal = TRUE;
+    unsigned int arrays;
+
+    if(chNum >= SOC_EDMA3_NUM_DMACH)
+    {
+         return FALSE;
+    }
+
+    if(len >= EDMA3_FILL_PATTERN_SIZE)
+    {
+         /* A registered callback means another client owns the channel */
+         if(edma3CbRegistry[chNum].cbFxn != NULL)
+         {
+              return FALSE;
+         }
+
+         memset(edma3FillPattern, value, EDMA3_FILL_PATTERN_SIZE);
+
+         /* The EDMA reads the pattern from memory */
+         CacheDataCleanBuff((unsigned int)edma3FillPattern,
+                            EDMA3_FILL_PATTERN_SIZE);
+
+         EDMA3QosRequestChannel(baseAdd, EDMA3_CHANNEL_TYPE_DMA, chNum, chNum,
+                                qosClass);
+         EDMA3RegisterCallback(chNum, EDMA3MemFillCallback, (void *)&done);
+
+         while(len >= EDMA3_FILL_PATTERN_SIZE)
+         {
+              arrays = len / EDMA3_FILL_PATTERN_SIZE;
+              if(arrays > 0xFFFFu)
+              {
+                   arrays = 0xFFFFu;
+              }
+
+              done = 0;
+              EDMA3MemParamSet(baseAdd, chNum, edma3FillPattern, ptr,
+                               EDMA3_FILL_PATTERN_SIZE, arrays, 0);
+              EDMA3EnableTransfer(baseAdd, chNum, EDMA3_TRIG_MODE_MANUAL);
+
+              timeOut = 0xFFFFFF;
+              while((done == 0) && (timeOut-- != 0));
+
+              if(done != 1u)
+              {
+                   retVal = FALSE;
+                   break;
+              }
+
+              ptr += arrays * EDMA3_FILL_PATTERN_SIZE;
+              len -= arrays * EDMA3_FILL_PATTERN_SIZE;
+         }
+
+         EDMA3UnregisterCallback(chNum);
+         EDMA3FreeChannel(baseAdd, EDMA3_CHANNEL_TYPE_DMA, chNum,
+                          EDMA3_TRIG_MODE_MANUAL, chNum,
+                          EDMA3QosEvtQGet(qosClass));
+    }
+
+    if(retVal == TRUE)
+    {
+         memset(ptr, value, len);
+    }
+
+    return retVal;
+}
+
+#ifdef EDMA3_TRACE_ENABLED
+/*
+** Records size, event queue and start time of a transfer about to be
+** triggered. The PaRAM set of a DMA channel has the channel's number.
+*/
+static void EDMA3TraceSubmit(unsigned int baseAdd, unsigned int chNum)
+{
+    EDMA3CCPaRAMEntry paRAM;
+    EDMA3ChStats *stats = &edma3Stats[chNum];
+    unsigned int tccNum;
+
+    EDMA3GetPaRAM(baseAdd, chNum, &paRAM);
+
+    tccNum = (paRAM.opt & EDMA3CC_OPT_TCC) >> EDMA3CC_OPT_TCC_SHIFT;
+    edma3TccToCh[tccNum] = (unsigned char)chNum;
+
+    stats->evtQNum = (HWREG(baseAdd + EDMA3CC_DMAQNUM(chNum >> 3u)) >>
+                      ((chNum % 8u) * 4u)) & 0x7u;
+    stats->pendingBytes = (unsigned int)paRAM.aCnt * paRAM.bCnt * paRAM.cCnt;
+    stats->submitStamp = WatchCycleCountGet();
+}
+
+/*
+** Accounts a completed transfer to the channel that last used the TCC.
+*/
+static void EDMA3TraceComplete(unsigned int tccNum)
+{
+    EDMA3ChStats *stats = &edma3Stats[edma3TccToCh[tccNum]];
+    unsigned int lat;
+
+    if(stats->pendingBytes == 0)
+    {
+         return;
+    }
+
+    lat = WatchCycleCountGet() - stats->submitStamp;
+
+    if((stats->xferCount == 0) || (lat < stats->latMin))
+    {
+         stats->latMin = lat;
+    }
+    if(lat > stats->latMax)
+    {
+         stats->latMax = lat;
+    }
+
+    stats->latTotal += lat;
+    stats->bytes += stats->pendingBytes;
+    stats->pendingBytes = 0;
+    stats->xferCount++;
+}
+
+static void EDMA3TraceError(unsigned int chNum)
+{
+    edma3Stats[chNum].errCount++;
+}
+
+static void EDMA3TraceQueueError(unsigned int pending)
+{
+    unsigned int evtQNum;
+
+    for(evtQNum = 0; evtQNum < SOC_EDMA3_NUM_EVQUE; evtQNum++)
+    {
+         if(pending & (1u << evtQNum))
+         {
+              edma3QueueErr[evtQNum]++;
+         }
+    }
+}
+
+/**
+ *  \brief   Clears all transfer statistics.
+ *
+ *  \return  None
+ */
+void EDMA3TraceReset(void)
+{
+    memset(edma3Stats, 0, sizeof(edma3Stats));
+    memset(edma3QueueErr, 0, sizeof(edma3QueueErr));
+}
+
+/**
+ *  \brief   Returns a snapshot of the statistics of one DMA channel.
+ *
+ *  \param   chNum       DMA channel number.\n
+ *
+ *  \param   stats       Destination of the snapshot.\n
+ *
+ *  \return  TRUE if the channel is valid, else FALSE
+ */
+unsigned int EDMA3TraceGet(unsigned int chNum, EDMA3ChStats *stats)
+{
+    if(chNum >= SOC_EDMA3_NUM_DMACH)
+    {
+         return FALSE;
+    }
+
+    *stats = edma3Stats[chNum];
+
+    return TRUE;
+}
+
+/**
+ *  \brief   Returns the number of queue threshold errors of an event queue.
+ *
+ *  A non-zero count means the queue filled up, i.e. events of the channels
+ *  mapped to it (see EDMA3MapChToEvtQ) were waiting for the TC.
+ *
+ *  \param   evtQNum     Event queue number.\n
+ *
+ *  \return  Error count, 0 for an invalid queue
+ */
+unsigned int EDMA3TraceQueueErrGet(unsigned int evtQNum)
+{
+    if(evtQNum >= SOC_EDMA3_NUM_EVQUE)
+    {
+         return 0;
+    }
+
+    return edma3QueueErr[evtQNum];
+}
+
+/**
+ *  \brief   Writes a compact text summary of all active channels.
+ *
+ *  One line per channel which transferred data or saw errors:
+ *  "ch<n> q<queue> n=<transfers> kB=<kBytes> lat=<min>/<avg>/<max>us
+ *  err=<errors>", followed by one line with the queue threshold errors.
+ *
+ *  \param   buf         Destination buffer.\n
+ *
+ *  \param   len         Size of buf in bytes.\n
+ *
+ *  \return  Number of characters written (without the terminating 0)
+ */
+unsigned int EDMA3TraceDump(char *buf, unsigned int len)
+{
+    unsigned int chNum;
+    unsigned int evtQNum;
+    unsigned int pos = 0;
+    unsigned int avg;
+    int n;
+    EDMA3ChStats *stats;
+
+    for(chNum = 0; (chNum < SOC_EDMA3_NUM_DMACH) && (pos < len); chNum++)
+    {
+         stats = &edma3Stats[chNum];
+
+         if((stats->xferCount == 0) && (stats->errCount == 0))
+         {
+              continue;
+         }
+
+         avg = (stats->xferCount != 0) ?
+               (unsigned int)(stats->latTotal / stats->xferCount) : 0;
+
+         n = snprintf(buf + pos, len - pos,
+                      "ch%u q%u n=%u kB=%u lat=%u/%u/%uus err=%u\n",
+                      chNum, stats->evtQNum, stats->xferCount,
+                      (unsigned int)(stats->bytes >> 10),
+                      (unsigned int)WatchCyclesToUs(stats->latMin),
+                      (unsigned int)WatchCyclesToUs(avg),
+                      (unsigned int)WatchCyclesToUs(stats->latMax),
+                      stats->errCount);
+         if(n < 0)
+         {
+              break;
+         }
+         pos += (unsigned int)n;
+    }
+
+    /* Queue errors, one count per event queue */
+    for(evtQNum = 0; (evtQNum < SOC_EDMA3_NUM_EVQUE) && (pos < len); evtQNum++)
+    {
+         n = snprintf(buf + pos, len - pos, (evtQNum == 0) ? "qerr %u" : " %u",
+                      edma3QueueErr[evtQNum]);
+         if(n < 0)
+         {
+              break;
+         }
+         pos += (unsigned int)n;
+    }
+
+    if(pos < len)
+    {
+         n = snprintf(buf + pos, len - pos, "\n");
+         if(n > 0)
+         {
+              pos += (unsigned int)n;
+         }
+    }
+
+    return (pos < len) ? pos : ((len != 0) ? len - 1 : 0);
+}
+#endif
+
 /********************************* End of file ******************************/
@@ -140,6 +140,25 @@ extern "C" {
 #define EDMA3CC_CLR_QTHRQ0                     EDMA3CC_CCERRCLR_QTHRXCD0
 #define EDMA3CC_CLR_QTHRQ1                     EDMA3CC_CCERRCLR_QTHRXCD1
 
+/** Event queues (and TCs, queue n is served by TC n) on AM335x */
+#define EDMA3_AM335X_NUM_EVTQUE               (3u)
+
+/** DMA client classes of the QoS layer */
+#define EDMA3_QOS_CLASS_BULK                  (0u)
+#define EDMA3_QOS_CLASS_LATENCY               (1u)
+#define EDMA3_QOS_CLASS_REALTIME              (2u)
+#define EDMA3_QOS_NUM_CLASSES                 (3u)
+
+/** Queue priority range, 0 is the highest */
+#define EDMA3_QOS_PRI_HIGHEST                 (0u)
+#define EDMA3_QOS_PRI_LOWEST                  (7u)
+
+/** Watermark threshold which disables the queue threshold error */
+#define EDMA3_QOS_WM_DISABLE                  (17u)
+
+/** Status passed to a callback when a TCC error is flagged in CCERR */
+#define EDMA3_CC_TCC_ERR                      (3u)
+
 
 /* paRAMEntry Fields*/
     /**
@@ -286,6 +305,82 @@ typedef struct EDMA3CCPaRAMEntry {
 
 }EDMA3CCPaRAMEntry;
 
+/**
+ * \brief Transfer completion / error callback
+ *
+ * Called from EDMA3ComplHandlerIsr()/EDMA3CCErrHandlerIsr() in interrupt
+ * context with the TCC (or channel) number, one of EDMA3_XFER_COMPLETE,
+ * EDMA3_CC_DMA_EVT_MISS or EDMA3_CC_TCC_ERR and the context pointer which
+ * was passed to EDMA3RegisterCallback().
+ */
+typedef void (*EDMA3Callback)(unsigned int tccNum, unsigned int status,
+                              void *ctx);
+
+/**
+ * \brief Event queue assignment of one DMA client class
+ */
+typedef struct EDMA3QosClassCfg {
+        /** Event queue (and thereby TC) used by the class */
+        unsigned int evtQNum;
+
+        /** Priority of the queue towards the TC, 0 (highest) - 7 */
+        unsigned int priority;
+
+        /**
+         * \brief Queue watermark threshold (0 - 16 entries)
+         * A CC queue threshold error is raised when the queue holds more
+         * entries, EDMA3_QOS_WM_DISABLE turns the check off.
+         */
+        unsigned int watermark;
+}EDMA3QosClassCfg;
+
+/**
+ * \brief Result of EDMA3QosLatencyBench()
+ *
+ * Latencies of the small transfers in CPU cycles.
+ */
+typedef struct EDMA3QosBenchResult {
+        unsigned int samples;
+        unsigned int latMin;
+        unsigned int latMax;
+        unsigned int latAvg;
+
+        /** Bulk transfers completed while sampling */
+        unsigned int bulkXfers;
+}EDMA3QosBenchResult;
+
+#ifdef EDMA3_TRACE_ENABLED
+/**
+ * \brief Per channel transfer statistics
+ *
+ * Collected when the driver is built with EDMA3_TRACE_ENABLED. A transfer
+ * is counted from EDMA3EnableTransfer() (submit) to the completion
+ * interrupt of its TCC, latencies are in CPU cycles (see dr_watch.h).
+ */
+typedef struct EDMA3ChStats {
+        /** Completed transfers */
+        unsigned int xferCount;
+
+        /** Bytes moved by completed transfers (ACNT * BCNT * CCNT) */
+        unsigned long long bytes;
+
+        /** Missed events and TCC errors seen on the channel */
+        unsigned int errCount;
+
+        /** Submit to completion latency in cycles */
+        unsigned int latMin;
+        unsigned int latMax;
+        unsigned long long latTotal;
+
+        /** Event queue the channel was mapped to at the last submit */
+        unsigned int evtQNum;
+
+        /** Cycle stamp and size of the transfer in flight, 0 if idle */
+        unsigned int submitStamp;
+        unsigned int pendingBytes;
+}EDMA3ChStats;
+#endif
+
 /*
 ** Structure to store the EDMA context
 */
@@ -459,6 +554,54 @@ extern void EDMA3ContextRestore(unsigned int baseAddr,
                                 EDMACONTEXT *edmaCntxPtr);
 
 void EDMAModuleClkConfig(void);
+
+unsigned int EDMA3RegisterCallback(unsigned int tccNum,
+                                   EDMA3Callback cbFxn,
+                                   void *ctx);
+
+void EDMA3UnregisterCallback(unsigned int tccNum);
+
+void EDMA3ComplHandlerIsr(unsigned int baseAdd);
+
+void EDMA3CCErrHandlerIsr(unsigned int baseAdd);
+
+void EDMA3IntrSetup(unsigned int baseAdd);
+
+void EDMA3QosConfig(unsigned int baseAdd,
+                    const EDMA3QosClassCfg *cfg);
+
+unsigned int EDMA3QosEvtQGet(unsigned int qosClass);
+
+unsigned int EDMA3QosRequestChannel(unsigned int baseAdd, unsigned int chType,
+                                    unsigned int chNum, unsigned int tccNum,
+                                    unsigned int qosClass);
+
+unsigned int EDMA3QosWatermarkGet(unsigned int baseAdd,
+                                  unsigned int evtQNum);
+
+unsigned int EDMA3QosLatencyBench(unsigned int baseAdd,
+                                  unsigned int bulkCh, unsigned int bulkClass,
+                                  void *bulkSrc, void *bulkDst,
+                                  unsigned int bulkLen,
+                                  unsigned int smallCh, unsigned int smallClass,
+                                  void *smallSrc, void *smallDst,
+                                  unsigned int smallLen,
+                                  unsigned int samples,
+                                  EDMA3QosBenchResult *result);
+
+unsigned int EDMA3MemFill(unsigned int baseAdd, unsigned int chNum,
+                          unsigned int qosClass, void *dst,
+                          unsigned char value, unsigned int len);
+
+#ifdef EDMA3_TRACE_ENABLED
+void EDMA3TraceReset(void);
+
+unsigned int EDMA3TraceGet(unsigned int chNum, EDMA3ChStats *stats);
+
+unsigned int EDMA3TraceQueueErrGet(unsigned int evtQNum);
+
+unsigned int EDMA3TraceDump(char *buf, unsigned int len);
+#endif
 #ifdef __cplusplus
 }
 #endif
@@ -341,6 +341,90 @@ uint32_t CPSWWrCoreIntStatusGet(uint32_t baseAddr, uint32_t core, uint32_t chann
     return (reg32r(baseAddr, CPSW_WR_C_RX_THRESH_STAT(core) + intFlag) & (1 << channel));
 }
 
+/**
+ * \brief   Sets the prescaler of the interrupt pacing counters. The value
+ *          is the number of CPSW main clock periods in 4us.
+ *
+ * \param   baseAddr    Base address of the CPSW Wrapper Module
+ * \param   prescale    Main clock periods in 4us (500 at 125MHz)
+ *
+ * \return  None
+ **/
+void CPSWWrPrescaleSet(uint32_t baseAddr, uint32_t prescale)
+{
+    reg32an(baseAddr, CPSW_WR_INT_CONTROL, CPSW_WR_INT_CONTROL_INT_PRESCALE);
+    reg32m(baseAddr, CPSW_WR_INT_CONTROL, prescale & CPSW_WR_INT_CONTROL_INT_PRESCALE);
+}
+
+/**
+ * \brief   Enables interrupt pacing for the given pulse interrupts. A paced
+ *          interrupt is raised at most as often as set by
+ *          CPSWWrRxIntMaxSet / CPSWWrTxIntMaxSet.
+ *
+ * \param   baseAddr    Base address of the CPSW Wrapper Module
+ * \param   pacFlag     Interrupts to be paced
+ *    'pacFlag' can take a combination of the below values. \n
+ *          CPSW_INT_PACING_C0_RX_PULSE - RX pulse of core 0 \n
+ *          CPSW_INT_PACING_C0_TX_PULSE - TX pulse of core 0 \n
+ *          CPSW_INT_PACING_C1_RX_PULSE - RX pulse of core 1 \n
+ *          CPSW_INT_PACING_C1_TX_PULSE - TX pulse of core 1 \n
+ *          CPSW_INT_PACING_C2_RX_PULSE - RX pulse of core 2 \n
+ *          CPSW_INT_PACING_C2_TX_PULSE - TX pulse of core 2
+ *
+ * \return  None
+ **/
+void CPSWWrIntPacingEnable(uint32_t baseAddr, uint32_t pacFlag)
+{
+    reg32m(baseAddr, CPSW_WR_INT_CONTROL, pacFlag & CPSW_WR_INT_CONTROL_INT_PACE_EN);
+}
+
+/**
+ * \brief   Disables interrupt pacing for the given pulse interrupts, they
+ *          are raised for every completed packet again.
+ *
+ * \param   baseAddr    Base address of the CPSW Wrapper Module
+ * \param   pacFlag     Interrupts not to be paced any more, see
+ *                      CPSWWrIntPacingEnable
+ *
+ * \return  None
+ **/
+void CPSWWrIntPacingDisable(uint32_t baseAddr, uint32_t pacFlag)
+{
+    reg32an(baseAddr, CPSW_WR_INT_CONTROL, pacFlag & CPSW_WR_INT_CONTROL_INT_PACE_EN);
+}
+
+/**
+ * \brief   Sets the maximum number of RX pulse interrupts per millisecond
+ *          of a core. Only effective while pacing is enabled.
+ *
+ * \param   baseAddr    Base address of the CPSW Wrapper Module
+ * \param   core        Core number
+ * \param   intPerMs    Interrupts per millisecond, CPSW_INT_PER_MS_MIN to
+ *                      CPSW_INT_PER_MS_MAX
+ *
+ * \return  None
+ **/
+void CPSWWrRxIntMaxSet(uint32_t baseAddr, uint32_t core, uint32_t intPerMs)
+{
+    reg32w(baseAddr, CPSW_WR_C_RX_IMAX(core), intPerMs & CPSW_INT_PER_MS_MAX);
+}
+
+/**
+ * \brief   Sets the maximum number of TX pulse interrupts per millisecond
+ *          of a core. Only effective while pacing is enabled.
+ *
+ * \param   baseAddr    Base address of the CPSW Wrapper Module
+ * \param   core        Core number
+ * \param   intPerMs    Interrupts per millisecond, CPSW_INT_PER_MS_MIN to
+ *                      CPSW_INT_PER_MS_MAX
+ *
+ * \return  None
+ **/
+void CPSWWrTxIntMaxSet(uint32_t baseAddr, uint32_t core, uint32_t intPerMs)
+{
+    reg32w(baseAddr, CPSW_WR_C_TX_IMAX(core), intPerMs & CPSW_INT_PER_MS_MAX);
+}
+
 /**
  * \brief   Returns the RGMII status requested.
  *
@@ -854,6 +938,24 @@ void CPSWHostPortDualMacModeSet(uint32_t baseAddr)
     reg32m(baseAddr, CPSW_PORT_TX_IN_CTL, CPSW_PORT_P0_TX_IN_CTL_TX_IN_DUAL_MAC);
 }
 
+/**
+ * \brief   Sets the RX DMA channel of the packets from the slave ports to
+ *          the host, selected by slave port and switch priority.
+ *
+ * \param   baseAddr      Base address of the CPSW Host Port Module registers
+ * \param   chMap         Channel map
+ *            'chMap' is built of CPSW_RX_CH_MAP(port, pri, ch) for each
+ *            slave port (1 or 2) and switch priority (0 to 3). Priorities
+ *            left out go to channel 0.
+ *
+ * \return  None
+ *
+ **/
+void CPSWHostPortRxChMapSet(uint32_t baseAddr, uint32_t chMap)
+{
+    reg32w(baseAddr, CPSW_PORT_CPDMA_RX_CH_MAP, chMap);
+}
+
 /**
  * \brief   Configures Port VLAN
  *
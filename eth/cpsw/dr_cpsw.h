@@ -138,6 +138,12 @@ extern "C" {
 #define CPSW_INT_PACING_C2_RX_PULSE            (0x10 << CPSW_WR_INT_CONTROL_INT_PACE_EN_SHIFT)
 #define CPSW_INT_PACING_C2_TX_PULSE            (0x20 << CPSW_WR_INT_CONTROL_INT_PACE_EN_SHIFT)
 
+/*
+** Range of 'intPerMs' of the APIs CPSWWrRxIntMaxSet and CPSWWrTxIntMaxSet
+*/
+#define CPSW_INT_PER_MS_MIN                    (0x02u)
+#define CPSW_INT_PER_MS_MAX                    (0x3Fu)
+
 /*
 ** Macros which can be passed as 'portState' to CPSWALEPortStateSet
 */
@@ -224,9 +230,54 @@ extern "C" {
 #define CPDMA_CFG_RX_OWN_1                     (CPSW_CPDMA_DMACONTROL_RX_OWNERSHIP)
 #define CPDMA_CFG_RX_OWN_0                     (0x00u)
 
-/* Values for 'tx_ptype' */
-#define CPDMA_CFG_TX_PRI_ROUND_ROBIN           (CPSW_CPDMA_DMACONTROL_TX_PTYPE)
-#define CPDMA_CFG_TX_PRI_FIXED                 (0x00u)
+/* Values for 'tx_ptype', TX_PTYPE set selects fixed priority (channel 7 highest) */
+#define CPDMA_CFG_TX_PRI_ROUND_ROBIN           (0x00u)
+#define CPDMA_CFG_TX_PRI_FIXED                 (CPSW_CPDMA_DMACONTROL_TX_PTYPE)
+
+/*
+** Macro which can be passed as 'chMap' to CPSWHostPortRxChMapSet, one for
+** each slave port and switch priority ORed together
+*/
+#define CPSW_RX_CH_MAP(port, pri, ch)          ((ch) << ((((port) - 1) * 16) + ((pri) * 4)))
+
+/*
+** Macros which can be passed as 'statReg' to CPSWStatisticsGet. The
+** counters sum up all ports enabled by CPSWStatisticsEnable.
+*/
+#define CPSW_STAT_RX_GOOD_FRAMES               (0x00u)
+#define CPSW_STAT_RX_BCAST_FRAMES              (0x04u)
+#define CPSW_STAT_RX_MCAST_FRAMES              (0x08u)
+#define CPSW_STAT_RX_PAUSE_FRAMES              (0x0Cu)
+#define CPSW_STAT_RX_CRC_ERRORS                (0x10u)
+#define CPSW_STAT_RX_ALIGN_CODE_ERRORS         (0x14u)
+#define CPSW_STAT_RX_OVERSIZED_FRAMES          (0x18u)
+#define CPSW_STAT_RX_JABBER_FRAMES             (0x1Cu)
+#define CPSW_STAT_RX_UNDERSIZED_FRAMES         (0x20u)
+#define CPSW_STAT_RX_FRAGMENTS                 (0x24u)
+#define CPSW_STAT_RX_OCTETS                    (0x30u)
+#define CPSW_STAT_TX_GOOD_FRAMES               (0x34u)
+#define CPSW_STAT_TX_BCAST_FRAMES              (0x38u)
+#define CPSW_STAT_TX_MCAST_FRAMES              (0x3Cu)
+#define CPSW_STAT_TX_PAUSE_FRAMES              (0x40u)
+#define CPSW_STAT_TX_DEFERRED_FRAMES           (0x44u)
+#define CPSW_STAT_TX_COLLISION_FRAMES          (0x48u)
+#define CPSW_STAT_TX_SINGLE_COLL_FRAMES        (0x4Cu)
+#define CPSW_STAT_TX_MULT_COLL_FRAMES          (0x50u)
+#define CPSW_STAT_TX_EXCESSIVE_COLLISIONS      (0x54u)
+#define CPSW_STAT_TX_LATE_COLLISIONS           (0x58u)
+#define CPSW_STAT_TX_UNDERRUN                  (0x5Cu)
+#define CPSW_STAT_TX_CARRIER_SENSE_ERRORS      (0x60u)
+#define CPSW_STAT_TX_OCTETS                    (0x64u)
+#define CPSW_STAT_FRAMES_64                    (0x68u)
+#define CPSW_STAT_FRAMES_65_127                (0x6Cu)
+#define CPSW_STAT_FRAMES_128_255               (0x70u)
+#define CPSW_STAT_FRAMES_256_511               (0x74u)
+#define CPSW_STAT_FRAMES_512_1023              (0x78u)
+#define CPSW_STAT_FRAMES_1024_UP               (0x7Cu)
+#define CPSW_STAT_NET_OCTETS                   (0x80u)
+#define CPSW_STAT_RX_SOF_OVERRUNS              (0x84u)
+#define CPSW_STAT_RX_MOF_OVERRUNS              (0x88u)
+#define CPSW_STAT_RX_DMA_OVERRUNS              (0x8Cu)
 
 /*
 ** Macros which can be passed as 'intType' to CPSWCPDMARxIntStatRawGet
@@ -295,6 +346,11 @@ extern void CPSWWrControlRegReset(uint32_t baseAddr);
 extern void CPSWWrCoreIntEnable(uint32_t baseAddr, uint32_t core, uint32_t channel, uint32_t intFlag);
 extern void CPSWWrCoreIntDisable(uint32_t baseAddr, uint32_t core, uint32_t channel, uint32_t intFlag);
 extern uint32_t CPSWWrCoreIntStatusGet(uint32_t baseAddr, uint32_t core, uint32_t channel, uint32_t intFlag);
+extern void CPSWWrPrescaleSet(uint32_t baseAddr, uint32_t prescale);
+extern void CPSWWrIntPacingEnable(uint32_t baseAddr, uint32_t pacFlag);
+extern void CPSWWrIntPacingDisable(uint32_t baseAddr, uint32_t pacFlag);
+extern void CPSWWrRxIntMaxSet(uint32_t baseAddr, uint32_t core, uint32_t intPerMs);
+extern void CPSWWrTxIntMaxSet(uint32_t baseAddr, uint32_t core, uint32_t intPerMs);
 extern uint32_t CPSWWrRGMIIStatusGet(uint32_t baseAddr, uint32_t statFlag);
 extern void CPSWALEInit(uint32_t baseAddr);
 extern void CPSWALEPortStateSet(uint32_t baseAddr, uint32_t portNum, uint32_t portState);
@@ -338,6 +394,7 @@ extern uint32_t CPSWCPDMARxIntStatMaskedGet(uint32_t baseAddr, uint32_t channel,
 extern void CPSWContextSave(CPSWCONTEXT *contextPtr);
 extern void CPSWContextRestore(CPSWCONTEXT *contextPtr);
 extern void CPSWHostPortDualMacModeSet(uint32_t baseAddr);
+extern void CPSWHostPortRxChMapSet(uint32_t baseAddr, uint32_t chMap);
 extern void CPSWALEVLANAwareSet(uint32_t baseAddr);
 extern void CPSWALEVLANAwareClear(uint32_t baseAddr);
 extern void CPSWPortVLANConfig(uint32_t baseAddr, uint32_t vlanId, uint32_t cfiBit, uint32_t vlanPri);
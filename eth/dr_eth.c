@@ -10,10 +10,13 @@
 #include "dr_eth.h"
 #include "cpsw/dr_cpsw.h"
 #include "lwip/ports/cpsw/include/lwiplib.h"
+#include "lwip/ports/cpsw/include/netif/cpswif.h"
 #include "../timer/dr_timer.h"
 #include "../interrupt/dr_interrupt.h"
+#include "../watch/dr_watch.h"
 
-uint32_t ConfigureCore(uint32_t ip);
+uint32_t ConfigureCore(uint32_t ip, uint32_t netMask);
+uint32_t ConfigurePort(uint32_t port, uint32_t ip, uint32_t netMask);
 void CPSWCore0RxIsr();
 void CPSWCore0TxIsr();
 
@@ -28,12 +31,197 @@ void InterruptSetup();
  *
  **/
 uint32_t EthConfigureWithIP(uint32_t ip) {
-	return ConfigureCore(ip);
+	return ConfigureCore(ip, 0);
 }
 
-uint32_t ConfigureCore(uint32_t ip) {
-	LWIP_IF lwipIfPort1, lwipIfPort2;
+/**
+ * \brief   Configure both ethernet ports as separate interfaces (dual MAC
+ * 			mode), each with its own MAC and IP address. The ports do not
+ * 			switch frames to each other, so both carry their own traffic.
+ *
+ * \param   ip1		IP address of port 1, e.g. 0xC0A80007 for 192.168.0.7
+ * \param   ip2		IP address of port 2
+ * \param   netMask	Net mask of both ports, e.g. 0xFFFFFF00. Packets are
+ * 					sent on the port whose subnet holds the destination, so
+ * 					ip1 and ip2 have to be in different subnets.
+ *
+ * \return	Number of ports which got their IP, 2 if both are up.
+ *
+ **/
+uint32_t EthConfigureDualMac(uint32_t ip1, uint32_t ip2, uint32_t netMask) {
+	uint32_t ports = 0;
+
+	lwIPDualMacModeSet(0, 1);
+
+	if (0 != ConfigureCore(ip1, netMask)) {
+		ports++;
+	}
+
+	if (0 != ConfigurePort(2, ip2, netMask)) {
+		ports++;
+	}
+
+	return ports;
+}
+
+/**
+ * \brief   Get the counters of an ethernet port.
+ *
+ * \param   port		Port number, 1 or 2
+ * \param   stats		Filled with the counters. In dual MAC mode they are the
+ * 					traffic of the port, the hw_ counters are the sum of
+ * 					all ports. All 0 for another port number.
+ *
+ **/
+void EthPortStatsGet(uint32_t port, struct cpswif_port_stats *stats) {
+	cpswif_port_stats_get(0, port, stats);
+}
+
+/**
+ * \brief   Process received packets. Only needed when the lwIP port is built
+ * 			with CPSW_RX_POLL_MODE, call it from the main loop then. Every call
+ * 			handles at most CPSW_RX_BUDGET packets, so the loop keeps running
+ * 			under a packet flood.
+ *
+ * \return	Number of packets processed.
+ *
+ **/
+uint32_t EthPoll(void) {
+	return lwIPRxPoll(0);
+}
+
+/**
+ * \brief   Measure the receive path under load. Runs a main loop which
+ * 			only calls EthPoll for the given time and reports the receive
+ * 			counters of the run and how long the loop was kept from running.
+ * 			Flood the port while it runs, e.g. with minimum size frames at
+ * 			line rate; compare a build with and without CPSW_RX_POLL_MODE.
+ *
+ * \param   ms			Length of the run in ms
+ * \param   result		Filled with the counters of the run
+ *
+ * \return	Frames per second passed to lwIP.
+ *
+ **/
+uint32_t EthRxBench(uint32_t ms, EthRxBenchResult *result) {
+	struct cpswif_rx_stats before, after;
+	uint64_t elapsed = 0;
+	uint64_t end = (uint64_t) ms * 1000 * WATCH_CYCLES_PER_US;
+	uint32_t last, now, gap, maxGap = 0, loops = 0;
+
+	WatchCycleCounterInit();
+	cpswif_rx_stats_max_reset(0);
+	cpswif_rx_stats_get(0, &before);
+	last = WatchCycleCountGet();
+
+	while (elapsed < end) {
+		EthPoll();
+		loops++;
+
+		// An RX interrupt which ran in between shows up as a long gap
+		now = WatchCycleCountGet();
+		gap = now - last;
+		last = now;
+		elapsed += gap;
+
+		if (gap > maxGap) {
+			maxGap = gap;
+		}
+	}
+
+	cpswif_rx_stats_get(0, &after);
+
+	result->us = (uint32_t) (elapsed / WATCH_CYCLES_PER_US);
+	result->frames = after.frames - before.frames;
+	result->irqs = after.irqs - before.irqs;
+	result->polls = after.polls - before.polls;
+	result->budgetHits = after.budget_hits - before.budget_hits;
+	result->maxBurst = after.max_burst;
+	result->rxCycles = after.cycles - before.cycles;
+	result->maxRxCycles = after.max_cycles;
+	result->loops = loops;
+	result->maxGapUs = WatchCyclesToUs(maxGap);
 
+	if (0 == result->us) {
+		return 0;
+	}
+
+	return (uint32_t) (((uint64_t) result->frames * 1000000) / result->us);
+}
+
+/**
+ * \brief   Limit the ethernet interrupts. Fewer interrupts leave more CPU
+ * 			time under load, but a packet may wait up to 1/limit ms.
+ *
+ * \param   rxPerMs		Receive interrupts per ms (2 - 63), 0 for one per packet
+ * \param   txPerMs		Transmit interrupts per ms (2 - 63), 0 for one per packet
+ *
+ **/
+void EthIntPacingSet(uint32_t rxPerMs, uint32_t txPerMs) {
+	lwIPIntPacingSet(0, rxPerMs, txPerMs);
+}
+
+/**
+ * \brief   Let the driver choose the receive interrupt limit from the
+ * 			packet rate: one interrupt per packet when idle, fewer under load.
+ *
+ * \param   enable		1 to start, 0 to stop the adaptive mode
+ *
+ **/
+void EthIntPacingAdaptive(uint32_t enable) {
+	lwIPIntPacingAdaptive(0, enable);
+}
+
+/**
+ * \brief   Compare the interrupt pacing settings under the current load.
+ * 			Runs EthRxBench with pacing off, 4, 16 and 63 interrupts per ms
+ * 			and in the adaptive mode, and prints per setting the interrupts
+ * 			and frames per second, the CPU time spent on the frames and the
+ * 			longest ISR. A paced frame may wait up to the bound for its
+ * 			interrupt, the latency itself has to be taken at the sender
+ * 			(ping round trip). Pacing is off afterwards.
+ *
+ * \param   ms			Length of the run per setting in ms
+ *
+ **/
+void EthIntPacingBench(uint32_t ms) {
+	static const uint32_t limits[] = { 0, 4, 16, 63 };
+	const uint32_t num = sizeof(limits) / sizeof(limits[0]);
+	struct cpswif_tx_stats txBefore, txAfter;
+	EthRxBenchResult r;
+	uint32_t i, fps, us;
+
+	printf("pacing    rx irq/s  tx irq/s  frames/s  rx cpu  max isr  bound\n");
+
+	// The last run is the adaptive mode
+	for (i = 0; i <= num; i++) {
+		if (i < num) {
+			EthIntPacingSet(limits[i], limits[i]);
+			printf("%2u/ms     ", (unsigned int) limits[i]);
+		} else {
+			EthIntPacingAdaptive(1);
+			printf("adaptive  ");
+		}
+
+		cpswif_tx_stats_get(0, &txBefore);
+		fps = EthRxBench(ms, &r);
+		cpswif_tx_stats_get(0, &txAfter);
+
+		us = r.us ? r.us : 1;
+
+		printf("%8u  %8u  %8u  %5u%%  %4u us  %u us\n",
+				(unsigned int) (((uint64_t) r.irqs * 1000000) / us),
+				(unsigned int) (((uint64_t) (txAfter.irqs - txBefore.irqs) * 1000000) / us),
+				(unsigned int) fps,
+				(unsigned int) (((uint64_t) WatchCyclesToUs(r.rxCycles) * 100) / us),
+				(unsigned int) WatchCyclesToUs(r.maxRxCycles),
+				(unsigned int) ((i < num && limits[i]) ? 1000 / limits[i] : 0));
+	}
+
+	EthIntPacingSet(0, 0);
+}
+
+uint32_t ConfigureCore(uint32_t ip, uint32_t netMask) {
 	#ifdef LWIP_CACHE_ENABLED
 		CacheEnable(CACHE_ALL);
 	#endif
@@ -43,28 +231,36 @@ uint32_t ConfigureCore(uint32_t ip) {
 
 	CPSWEVMPortMIIModeSelect();
 
-	// Get the MAC address
-	CPSWEVMMACAddrGet(0, lwipIfPort1.macArray);
-	CPSWEVMMACAddrGet(1, lwipIfPort2.macArray);
-
 	//Configure Interrupt handler
 	InterruptSetup();
 
-	lwipIfPort1.ipMode = IPADDR_USE_STATIC;
-	lwipIfPort1.instNum = 0;
-	lwipIfPort1.slvPortNum = 1;
-	lwipIfPort1.ipAddr = ip;
-    lwipIfPort1.netMask = 0;
-    lwipIfPort1.gwAddr = 0;
+	return ConfigurePort(1, ip, netMask);
+}
 
-	uint32_t ipAddr = (uint32_t)lwIPInit(&lwipIfPort1);
+/*
+ ** Bring up the interface of a slave port. In switch mode only port 1 has
+ ** one, in dual MAC mode both ports.
+ */
+uint32_t ConfigurePort(uint32_t port, uint32_t ip, uint32_t netMask) {
+	LWIP_IF lwipIf;
+	uint32_t ipAddr;
 
-	if(0 == ipAddr) {
-		printf("\n\rUnable to get IP-Address!");
+	// Get the MAC address of the port
+	CPSWEVMMACAddrGet(port - 1, lwipIf.macArray);
 
+	lwipIf.ipMode = IPADDR_USE_STATIC;
+	lwipIf.instNum = 0;
+	lwipIf.slvPortNum = port;
+	lwipIf.ipAddr = ip;
+	lwipIf.netMask = netMask;
+	lwipIf.gwAddr = 0;
 
+	ipAddr = (uint32_t)lwIPInit(&lwipIf);
+
+	if(0 == ipAddr) {
+		printf("\n\rUnable to get IP-Address for port %d!", port);
 	} else {
-		printf("\n\rUsing IP-Addr: %d.%d.%d.%d\n\r", (ipAddr & 0xFF), ((ipAddr >> 8) & 0xFF), ((ipAddr >> 16) & 0xFF), ((ipAddr >> 24) & 0xFF));
+		printf("\n\rPort %d using IP-Addr: %d.%d.%d.%d\n\r", port, (ipAddr & 0xFF), ((ipAddr >> 8) & 0xFF), ((ipAddr >> 16) & 0xFF), ((ipAddr >> 24) & 0xFF));
 	}
 
 	return ipAddr;
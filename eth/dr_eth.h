@@ -12,6 +12,29 @@
 
 #include <inttypes.h>
 
+struct cpswif_port_stats;
+
+/* Result of EthRxBench, counters are deltas over the run */
+typedef struct {
+	uint32_t us;			/* length of the run */
+	uint32_t frames;		/* frames passed to lwIP */
+	uint32_t irqs;			/* RX interrupts */
+	uint32_t polls;			/* EthPoll calls which had frames to process */
+	uint32_t budgetHits;	/* polls which left frames for the next poll */
+	uint32_t maxBurst;		/* most frames processed in one ISR or poll */
+	uint32_t rxCycles;		/* CPU cycles spent on the frames */
+	uint32_t maxRxCycles;	/* longest ISR or poll in CPU cycles */
+	uint32_t loops;			/* iterations of the main loop */
+	uint32_t maxGapUs;		/* longest time the main loop did not run */
+} EthRxBenchResult;
+
 uint32_t EthConfigureWithIP(uint32_t ip);
+uint32_t EthConfigureDualMac(uint32_t ip1, uint32_t ip2, uint32_t netMask);
+void EthPortStatsGet(uint32_t port, struct cpswif_port_stats *stats);
+uint32_t EthPoll(void);
+uint32_t EthRxBench(uint32_t ms, EthRxBenchResult *result);
+void EthIntPacingSet(uint32_t rxPerMs, uint32_t txPerMs);
+void EthIntPacingAdaptive(uint32_t enable);
+void EthIntPacingBench(uint32_t ms);
 
 #endif /* DR_ETH_H_ */
@@ -281,7 +281,12 @@ extern unsigned int lwIPLinkStatusGet(unsigned int instNum,
 extern unsigned int lwIPNetIfStatusGet(unsigned int instNum, 
                                        unsigned int slvPortNum);
 extern unsigned int lwIPInit(LWIP_IF *lwipIf);
+extern void lwIPDualMacModeSet(unsigned int instNum, unsigned int enable);
 extern void lwIPRxIntHandler(unsigned int instNum);
+extern unsigned int lwIPRxPoll(unsigned int instNum);
+extern void lwIPIntPacingSet(unsigned int instNum, unsigned int rxPerMs,
+                             unsigned int txPerMs);
+extern void lwIPIntPacingAdaptive(unsigned int instNum, unsigned int enable);
 extern void lwIPTxIntHandler(unsigned int instNum);
 extern unsigned int lwIPDHCPStart(unsigned int instNum,
                                   unsigned int slvPortNum);
@@ -67,6 +67,7 @@
 #define CPSW0_SLIVER_1_REGS             SOC_CPSW_SLIVER_1_REGS
 #define CPSW0_PORT_2_REGS               SOC_CPSW_PORT_2_REGS
 #define CPSW0_SLIVER_2_REGS             SOC_CPSW_SLIVER_2_REGS
+#define CPSW0_STAT_REGS                 (SOC_CPSW_SS_REGS + 0x900)
 
 #ifdef evmAM335x
 #define CPSW0_PORT_1_PHY_ADDR           0
@@ -106,10 +107,161 @@ struct cpswportif {
   u8_t eth_addr[6];
 }cpswportif;
 
+/* Transmit classes, each is queued and sent on a TX channel of its own.
+   CPSW_TXQ_CTRL is the most urgent one */
+#define CPSW_TXQ_CTRL                   0
+#define CPSW_TXQ_INTERACTIVE            1
+#define CPSW_TXQ_BULK                   2
+#define CPSW_TXQ_CLASSES                3
+
+/* RX channels (1, 2 or 4), received frames are spread by VLAN priority */
+#ifndef CPSW_RX_CH_NUM
+#define CPSW_RX_CH_NUM                  2
+#endif
+
+/**
+ * Receive path counters of an instance, see cpswif_rx_stats_get.
+ */
+struct cpswif_rx_stats {
+  /* RX interrupts */
+  u32_t irqs;
+
+  /* cpswif_rx_poll calls which found the RX interrupt masked */
+  u32_t polls;
+
+  /* Frames passed to lwIP */
+  u32_t frames;
+
+  /* Polls which left frames in the ring for the next poll */
+  u32_t budget_hits;
+
+  /* Most frames processed in one ISR or poll */
+  u32_t max_burst;
+
+  /* CPU cycles spent on the frames, cycles / frames is the cost per frame */
+  u32_t cycles;
+
+  /* Longest ISR or poll in CPU cycles, the main loop was blocked that long */
+  u32_t max_cycles;
+
+  /* Current RX interrupt limit per ms, 0 if not paced */
+  u32_t int_per_ms;
+
+  /* Limit changes made by the adaptive pacing */
+  u32_t pacing_changes;
+
+  /* Refills which left rx bd's unarmed for lack of pbufs */
+  u32_t starved;
+
+  /* Frames received on each RX channel */
+  u32_t ch_frames[CPSW_RX_CH_NUM];
+
+  /* Receive pool (LWIP_SUPPORT_CUSTOM_PBUF): free buffers, lowest number
+     of free buffers seen, frames dropped to keep the ring armed */
+  u32_t pool_free;
+  u32_t pool_low;
+  u32_t pool_drops;
+};
+
+/**
+ * Transmit path counters of an instance, see cpswif_tx_stats_get.
+ */
+struct cpswif_tx_stats {
+  /* Frames queued to the DMA, in total and of each class */
+  u32_t frames;
+  u32_t class_frames[CPSW_TXQ_CLASSES];
+
+  /* CPU cycles spent in cpswif_transmit for these frames */
+  u32_t cycles;
+
+  /* TX interrupts and the packets they reclaimed */
+  u32_t irqs;
+  u32_t completed;
+
+  /* CPU cycles spent in the TX interrupt, in total and at most */
+  u32_t isr_cycles;
+  u32_t isr_max_cycles;
+
+  /* DMA restarts for packets chained after the end of queue */
+  u32_t restarts;
+
+  /* Frames waiting in the transmit queue, most frames seen waiting */
+  u32_t queued;
+  u32_t max_queued;
+
+  /* Drains stopped by a full tx bd ring of a class, the frames waited for
+     the TX interrupt instead of being dropped */
+  u32_t ring_full;
+
+  /* Frames dropped because the queue of their class was full, cpswif_output
+     returned ERR_MEM */
+  u32_t drop_full[CPSW_TXQ_CLASSES];
+
+  /* Frames dropped because they had more pbufs than the ring has bd's */
+  u32_t drop_chain;
+};
+
+/**
+ * Counters of a slave port, see cpswif_port_stats_get.
+ */
+struct cpswif_port_stats {
+  /* Frames and octets received from the port */
+  u32_t rx_frames;
+  u32_t rx_octets;
+
+  /* Frames and octets sent to the port. In switch mode the ALE chooses the
+     port, the frames count for the port of the netif */
+  u32_t tx_frames;
+  u32_t tx_octets;
+
+  /* Good frames and octets of the CPSW statistics, all ports together */
+  u32_t hw_rx_frames;
+  u32_t hw_rx_octets;
+  u32_t hw_tx_frames;
+  u32_t hw_tx_octets;
+};
+
+/**
+ * Number and CPU cycles of one kind of ALE operation.
+ */
+struct cpswif_ale_op {
+  u32_t count;
+
+  /* CPU cycles in total and at most, cycles / count is the cost per call */
+  u32_t cycles;
+  u32_t max_cycles;
+};
+
+/**
+ * ALE table counters of an instance, see cpswif_ale_stats_get. The
+ * operations are the CONFIG_SWITCH_ADD_*, _FIND_* and _DEL_* commands of
+ * cpsw_switch_configuration.
+ */
+struct cpswif_ale_stats {
+  struct cpswif_ale_op add;
+  struct cpswif_ale_op lookup;
+  struct cpswif_ale_op del;
+
+  /* Reloads of the shadow, each reads all ALE entries. A unicast address
+     the shadow does not hold costs one, so unicast adds are not faster */
+  u32_t reloads;
+};
+
 extern u32_t cpswif_netif_status(struct netif *netif);
 extern u32_t cpswif_link_status(u32_t inst_num, u32_t slv_port_num);
 extern err_t cpswif_init(struct netif *netif);
+extern void cpswif_dual_mac_set(u32_t inst_num, u32_t enable);
+extern u32_t cpswif_if_num(u32_t inst_num, u32_t port_num);
 extern void cpswif_rx_inthandler(u32_t inst_num, struct netif * netif_arr); 
+extern u32_t cpswif_rx_poll(u32_t inst_num, struct netif * netif_arr);
+extern void cpswif_rx_stats_get(u32_t inst_num, struct cpswif_rx_stats *stats);
+extern void cpswif_rx_stats_max_reset(u32_t inst_num);
+extern void cpswif_tx_stats_get(u32_t inst_num, struct cpswif_tx_stats *stats);
+extern void cpswif_port_stats_get(u32_t inst_num, u32_t port_num,
+                                  struct cpswif_port_stats *stats);
+extern void cpswif_ale_stats_get(u32_t inst_num, struct cpswif_ale_stats *stats);
+extern void cpswif_int_pacing_set(u32_t inst_num, u32_t rx_per_ms, u32_t tx_per_ms);
+extern void cpswif_int_pacing_adaptive(u32_t inst_num, u32_t enable);
 extern void cpswif_tx_inthandler(u32_t inst_num);
 
 #endif /* _CPSWIF_H__ */
@@ -124,13 +124,10 @@ static void lwIPDHCPComplete(unsigned int ifNum);
 **                       INTERNAL VARIABLE DEFINITIONS
 ******************************************************************************/
 /*
-** The lwIP network interface structure for CPSW ports.
+** The lwIP network interface structure for CPSW ports. In switch mode only
+** the first one of each instance is used.
 */
-#ifdef CPSW_DUAL_MAC_MODE
 static struct netif cpswNetIF[MAX_CPSW_INST * MAX_SLAVEPORT_PER_INST];
-#else
-static struct netif cpswNetIF[MAX_CPSW_INST];
-#endif
 
 /*
 ** Helper to identify ports
@@ -213,11 +210,7 @@ unsigned int lwIPInit(LWIP_IF *lwipIf)
         gw_addr.addr = 0;
     }
 
-#ifdef CPSW_DUAL_MAC_MODE
-    ifNum = (lwipIf->instNum * MAX_SLAVEPORT_PER_INST) + lwipIf->slvPortNum - 1;
-#else
-    ifNum = lwipIf->instNum;
-#endif
+    ifNum = cpswif_if_num(lwipIf->instNum, lwipIf->slvPortNum);
 
     cpswPortIf[ifNum].inst_num = lwipIf->instNum;
     cpswPortIf[ifNum].port_num = lwipIf->slvPortNum;
@@ -273,6 +266,21 @@ unsigned int lwIPInit(LWIP_IF *lwipIf)
     return (*ipAddrPtr);
 }
 
+/**
+ * \brief   Selects dual MAC mode: each slave port is brought up as a netif
+ *          of its own by lwIPInit, with its own MAC and IP address. Call it
+ *          before the first lwIPInit of the instance.
+ *
+ * \param   instNum   The instance number of CPSW module
+ * \param   enable    Non-zero for dual MAC mode, 0 for switch mode
+ *
+ * \return  None.
+*/
+void lwIPDualMacModeSet(unsigned int instNum, unsigned int enable)
+{
+    cpswif_dual_mac_set(instNum, enable);
+}
+
 /*
  * \brief   Checks if the ethernet link is up
  *
@@ -285,7 +293,7 @@ unsigned int lwIPNetIfStatusGet(unsigned int instNum, unsigned int slvPortNum)
 {
     unsigned int ifNum;
 
-    ifNum = instNum * MAX_SLAVEPORT_PER_INST + slvPortNum - 1;
+    ifNum = cpswif_if_num(instNum, slvPortNum);
     
     return (cpswif_netif_status(&cpswNetIF[ifNum]));
 }
@@ -317,6 +325,50 @@ void lwIPRxIntHandler(unsigned int instNum)
     cpswif_rx_inthandler(instNum, &cpswNetIF[0]);
 }
 
+/**
+ * \brief   Receive poll. With CPSW_RX_POLL_MODE the receive interrupt only
+ *          masks itself and this function, called from the main loop,
+ *          passes the received packets to lwIP in bounded steps.
+ *
+ * \param   instNum  The instance number of CPSW module to poll
+ *
+ * \return  Number of packets processed.
+*/
+unsigned int lwIPRxPoll(unsigned int instNum)
+{
+    return (cpswif_rx_poll(instNum, &cpswNetIF[0]));
+}
+
+/**
+ * \brief   Limits the receive and transmit interrupts of an instance and
+ *          ends the adaptive pacing.
+ *
+ * \param   instNum   The instance number of CPSW module
+ * \param   rxPerMs   Receive interrupts per ms, 0 for one per packet
+ * \param   txPerMs   Transmit interrupts per ms, 0 for one per packet
+ *
+ * \return  None.
+*/
+void lwIPIntPacingSet(unsigned int instNum, unsigned int rxPerMs,
+                      unsigned int txPerMs)
+{
+    cpswif_int_pacing_set(instNum, rxPerMs, txPerMs);
+}
+
+/**
+ * \brief   Starts or ends the adaptive receive interrupt pacing, which
+ *          limits the interrupts under load and turns pacing off when idle.
+ *
+ * \param   instNum   The instance number of CPSW module
+ * \param   enable    Non-zero to start the adaptive pacing
+ *
+ * \return  None.
+*/
+void lwIPIntPacingAdaptive(unsigned int instNum, unsigned int enable)
+{
+    cpswif_int_pacing_adaptive(instNum, enable);
+}
+
 /**
  * \brief   Interrupt handler for Transmit Interrupt. Directly calls the 
  *          cpsw interface transmit interrupt handler.
@@ -344,7 +396,7 @@ unsigned int lwIPDHCPStart(unsigned int instNum, unsigned int slvPortNum)
     unsigned int *ipAddrPtr;
     unsigned int ifNum;
 
-    ifNum = instNum * MAX_SLAVEPORT_PER_INST + slvPortNum - 1;
+    ifNum = cpswif_if_num(instNum, slvPortNum);
 
     lwIPDHCPComplete(ifNum);
 
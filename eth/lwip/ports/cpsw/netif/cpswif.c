@@ -60,6 +60,7 @@
 #include "eth/mdio/dr_mdio.h"
 #include "interrupt/dr_interrupt.h"
 #include "timer/dr_timer.h"
+#include "watch/dr_watch.h"
 #include "eth/phy/dr_phy.h"
 //#include "cache.h"
 #include "basic.h"
@@ -72,6 +73,56 @@
 #define SIZE_CPPI_RAM                            0x2000
 #endif
 
+/* Size of a CPDMA buffer descriptor in bytes */
+#define CPDMA_BD_SIZE                            16
+
+/**
+ * Number of tx and rx buffer descriptors. By default both rings take half
+ * of the CPPI RAM. The rx ring starts on a cache line of its own.
+ */
+#ifndef CPSW_TX_BD_NUM
+#define CPSW_TX_BD_NUM                           ((SIZE_CPPI_RAM >> 1) / CPDMA_BD_SIZE)
+#endif
+
+#ifndef CPSW_RX_BD_NUM
+#define CPSW_RX_BD_NUM                           ((SIZE_CPPI_RAM >> 1) / CPDMA_BD_SIZE)
+#endif
+
+/* Offset of the rx ring in the CPPI RAM */
+#define CPSW_RX_BD_OFFSET                        (((CPSW_TX_BD_NUM * CPDMA_BD_SIZE) \
+		+ SOC_CACHELINE_SIZE_BYTES - 1) & ~(SOC_CACHELINE_SIZE_BYTES - 1))
+
+#if ((CPSW_RX_BD_OFFSET + (CPSW_RX_BD_NUM * CPDMA_BD_SIZE)) > SIZE_CPPI_RAM)
+#error "CPSW_TX_BD_NUM and CPSW_RX_BD_NUM do not fit into the CPPI RAM"
+#endif
+
+/**
+ * DMA channels. Each transmit class has a TX channel and a ring of its own,
+ * the DMA serves the channels in fixed priority, CPSW_TXQ_CTRL first, or in
+ * turn with CPSW_TX_PRIO_ROUND_ROBIN. Received frames go to one of the
+ * CPSW_RX_CH_NUM RX channels by switch priority (VLAN priority / 2), higher
+ * priorities to higher channels, which are processed first. The tx and rx
+ * bd's are split evenly among the channels.
+ */
+#if (CPSW_RX_CH_NUM != 1) && (CPSW_RX_CH_NUM != 2) && (CPSW_RX_CH_NUM != 4)
+#error "CPSW_RX_CH_NUM must be 1, 2 or 4"
+#endif
+
+#define CPSW_TX_CH_BD_NUM                        (CPSW_TX_BD_NUM / CPSW_TXQ_CLASSES)
+#define CPSW_RX_CH_BD_NUM                        (CPSW_RX_BD_NUM / CPSW_RX_CH_NUM)
+
+/* TX channel of a transmit class, the highest one is the most urgent */
+#define CPSW_TX_CHANNEL(cls)                     (CPSW_TXQ_CLASSES - 1 - (cls))
+
+/* RX channel of a switch priority (0 - 3) */
+#define CPSW_RX_CHANNEL(pri)                     (((pri) * CPSW_RX_CH_NUM) >> 2)
+
+#ifdef CPSW_TX_PRIO_ROUND_ROBIN
+#define CPSW_TX_PRIO                             CPDMA_CFG_TX_PRI_ROUND_ROBIN
+#else
+#define CPSW_TX_PRIO                             CPDMA_CFG_TX_PRI_FIXED
+#endif
+
 #define PORT_1                                   0x0
 #define PORT_2                                   0x1
 #define PORT_0_MASK                              0x1
@@ -86,6 +137,10 @@
 #define ENTRY_TYPE_IDX                           7
 #define ENTRY_FREE                               0
 
+/* Buckets of the hash index of the ALE shadow, a power of 2 */
+#define ALE_HASH_SIZE                            256
+#define ALE_IDX_NONE                             (-1)
+
 /* MDIO input and output frequencies in Hz */
 #define MDIO_FREQ_INPUT                          125000000
 #define MDIO_FREQ_OUTPUT                         1000000
@@ -105,6 +160,83 @@
 
 #define MIN_PKT_LEN                              60
 
+/**
+ * Frames processed by one cpswif_rx_poll call. With CPSW_RX_POLL_MODE the
+ * RX interrupt only masks itself and the ring is emptied from the main loop
+ * in steps of this size, so a flood can not keep the CPU in the ISR.
+ */
+#ifndef CPSW_RX_BUDGET
+#define CPSW_RX_BUDGET                           16
+#endif
+
+/**
+ * Interrupt pacing of core 0. CPSW_INT_PACING_RX/TX are the RX/TX pulse
+ * interrupts per millisecond set at init, 0 raises an interrupt per packet.
+ * With CPSW_INT_PACING_ADAPTIVE the RX limit follows the frame rate measured
+ * over CPSW_PACING_WINDOW_US: no pacing up to CPSW_PACING_IDLE_RATE frames
+ * per ms, above that about CPSW_PACING_BATCH frames per interrupt.
+ */
+#ifndef CPSW_INT_PACING_RX
+#define CPSW_INT_PACING_RX                       0
+#endif
+
+#ifndef CPSW_INT_PACING_TX
+#define CPSW_INT_PACING_TX                       0
+#endif
+
+#ifndef CPSW_PACING_WINDOW_US
+#define CPSW_PACING_WINDOW_US                    10000
+#endif
+
+#ifndef CPSW_PACING_IDLE_RATE
+#define CPSW_PACING_IDLE_RATE                    16
+#endif
+
+#ifndef CPSW_PACING_BATCH
+#define CPSW_PACING_BATCH                        8
+#endif
+
+/* Pacing counter prescale, main clock periods in 4us */
+#define CPSW_INT_PRESCALE                        (MDIO_FREQ_INPUT / 250000)
+
+/**
+ * Receive buffers. With LWIP_SUPPORT_CUSTOM_PBUF (lwipopts.h) the rx bd's
+ * are armed from a pool of the driver instead of PBUF_POOL. The pool holds
+ * a buffer for every rx bd plus CPSW_RX_POOL_SPARE for frames still owned
+ * by lwIP; when lwIP holds more, frames are dropped so the ring stays armed.
+ */
+#ifndef CPSW_RX_POOL_SPARE
+#define CPSW_RX_POOL_SPARE                       32
+#endif
+
+/**
+ * Transmit queue. cpswif_output queues every frame by class and the queues
+ * are drained into the tx bd rings by cpswif_output and by the TX interrupt,
+ * so a full ring delays frames instead of dropping them. Each class holds
+ * CPSW_TXQ_DEPTH frames. ARP, PTP, ICMP, IGMP and VLAN priorities 6 and 7
+ * are CPSW_TXQ_CTRL, TCP, VLAN priorities 4 and 5 and other frames up to
+ * CPSW_TXQ_SMALL_LEN bytes CPSW_TXQ_INTERACTIVE, the rest CPSW_TXQ_BULK.
+ */
+#ifndef CPSW_TXQ_DEPTH
+#define CPSW_TXQ_DEPTH                           32
+#endif
+
+#ifndef CPSW_TXQ_SMALL_LEN
+#define CPSW_TXQ_SMALL_LEN                       128
+#endif
+
+/* PTP over ethernet and the PTP event and general UDP ports */
+#ifndef ETHTYPE_PTP
+#define ETHTYPE_PTP                              0x88F7U
+#endif
+
+#define PTP_EVENT_PORT                           319
+#define PTP_GENERAL_PORT                         320
+
+/* Receive buffer size, whole cache lines */
+#define CPSW_RX_BUF_SIZE                         ((PBUF_LEN_MAX \
+		+ SOC_CACHELINE_SIZE_BYTES - 1) & ~(SOC_CACHELINE_SIZE_BYTES - 1))
+
 /* Define those to better describe the network interface. */
 #define IFNAME0                                  'e'
 #define IFNAME1                                  'n'
@@ -169,28 +301,31 @@
 #define SELECT_HALF_DUPLEX                      (0)
 #define SELECT_FULL_DUPLEX                      (1)
 
-/* TX Buffer descriptor data structure */
+/**
+ * TX Buffer descriptor data structure. Hardware layout only, it lives in
+ * the uncached CPPI RAM. The pbuf of a bd is kept in txch->pbuf.
+ */
 struct cpdma_tx_bd {
 	volatile struct cpdma_tx_bd *next;
 	volatile u32_t bufptr;
 	volatile u32_t bufoff_len;
 	volatile u32_t flags_pktlen;
-
-	/* helper to know which pbuf this tx bd corresponds to */
-	volatile struct pbuf *pbuf;
 } cpdma_tx_bd;
 
-/* RX Buffer descriptor data structure */
+/**
+ * RX Buffer descriptor data structure. Hardware layout only, the pbuf of a
+ * bd is kept in rxch->pbuf.
+ */
 struct cpdma_rx_bd {
 	volatile struct cpdma_rx_bd *next;
 	volatile u32_t bufptr;
 	volatile u32_t bufoff_len;
 	volatile u32_t flags_pktlen;
-
-	/* helper to know which pbuf this rx bd corresponds to */
-	volatile struct pbuf *pbuf;
 } cpdma_rx_bd;
 
+/* Slot of a bd in its ring, the index into the pbuf array of the channel */
+#define BD_SLOT(ch, bd)                          ((bd) - (ch)->bd_base)
+
 /**
  * Helper struct to hold the data used to operate on the receive 
  * buffer descriptor ring
@@ -207,6 +342,13 @@ struct rxch {
 
 	/* The number of free bd's, which can be allocated for reception */
 	volatile u32_t free_num;
+
+	/* DMA channel number */
+	u32_t ch;
+
+	/* First bd of the ring and the pbuf which each bd is armed with */
+	volatile struct cpdma_rx_bd *bd_base;
+	struct pbuf *pbuf[CPSW_RX_CH_BD_NUM];
 } rxch;
 
 /**
@@ -225,6 +367,13 @@ struct txch {
 
 	/* The number of free bd's, which can be sent */
 	volatile u32_t free_num;
+
+	/* DMA channel number */
+	u32_t ch;
+
+	/* First bd of the ring and the pbuf sent by each bd, set at the EOP bd */
+	volatile struct cpdma_tx_bd *bd_base;
+	struct pbuf *pbuf[CPSW_TX_CH_BD_NUM];
 } txch;
 
 volatile struct cpdma_tx_bd *free_head;
@@ -239,8 +388,97 @@ struct cpswport {
 
 	/* The PHY is capable of GitaBit or Not */
 	u32_t phy_gbps;
+
+	/* Frames received from and sent to the port */
+	struct cpswif_port_stats stats;
 } cpswport;
 
+/**
+ * Interrupt pacing state
+ */
+struct pacing {
+	/* Interrupts per ms of core 0, 0 if not paced */
+	u32_t rx_per_ms;
+	u32_t tx_per_ms;
+
+	/* RX limit is chosen by cpswif_pacing_update */
+	u32_t adaptive;
+
+	/* Measurement window of the adaptive mode */
+	u32_t win_start;
+	u32_t win_frames;
+};
+
+/**
+ * Frame waiting in the transmit queue
+ */
+struct txqent {
+	struct pbuf *p;
+	struct netif *netif;
+
+	/* Number of tx bd's the frame needs */
+	u32_t clen;
+};
+
+/**
+ * Transmit queue of an instance, a ring of frames per class
+ */
+struct txq {
+	struct txqent ent[CPSW_TXQ_CLASSES][CPSW_TXQ_DEPTH];
+	u32_t head[CPSW_TXQ_CLASSES];
+	volatile u32_t num[CPSW_TXQ_CLASSES];
+
+	/* cpswif_tx_drain owns the tx bd rings */
+	volatile u32_t busy;
+};
+
+#if LWIP_SUPPORT_CUSTOM_PBUF
+#define CPSW_RX_POOL_SIZE             (CPSW_RX_BD_NUM + CPSW_RX_POOL_SPARE)
+
+/**
+ * Receive buffer of the pool. The custom pbuf has to be the first member,
+ * lwIP passes it to cpswif_rxbuf_free.
+ */
+struct rxbuf {
+	struct pbuf_custom pc;
+
+	/* Next free buffer */
+	struct rxbuf *next;
+
+	/* The pool the buffer belongs to */
+	struct rxpool *pool;
+
+	/* Cache line aligned payload memory */
+	u8_t *mem;
+};
+
+/**
+ * Receive buffer pool of an instance
+ */
+struct rxpool {
+	struct rxbuf *free_list;
+	volatile u32_t free_num;
+
+	/* Lowest free_num seen */
+	u32_t low_mark;
+
+	/* Frames dropped because lwIP held all spare buffers */
+	u32_t drops;
+};
+#endif
+
+/**
+ * RAM copy of the ALE table. Address and VLAN entries are chained in
+ * buckets hashed on (MAC, VID), free entries in the free list, both
+ * through next.
+ */
+struct aleshadow {
+	u32_t entry[MAX_ALE_ENTRIES][ALE_ENTRY_NUM_WORDS];
+	s16_t bucket[ALE_HASH_SIZE];
+	s16_t next[MAX_ALE_ENTRIES];
+	s16_t free_head;
+};
+
 /** 
  * CPSW instance information 
  */
@@ -253,18 +491,63 @@ struct cpswinst {
 	u32_t cpdma_base;
 	u32_t cppi_ram_base;
 	u32_t host_port_base;
+	u32_t stat_base;
 
 	/* Slave port information */
 	struct cpswport port[MAX_SLAVEPORT_PER_INST];
 
-	/* The tx/rx channels for the interface */
-	struct txch txch;
-	struct rxch rxch;
-} cpswinst;
+	/* The tx channel of each transmit class and the rx channels */
+	struct txch txch[CPSW_TXQ_CLASSES];
+	struct rxch rxch[CPSW_RX_CH_NUM];
+
+	/* RX interrupts are masked, cpswif_rx_poll processes the rings */
+	volatile u32_t rx_polling;
+
+	/* Frames waiting for tx bd's */
+	struct txq txq;
+
+	/* Receive and transmit path counters */
+	struct cpswif_rx_stats rx_stats;
+	struct cpswif_tx_stats tx_stats;
+
+	/* Interrupt pacing */
+	struct pacing pacing;
+
+	/* Shadow of the ALE table and its counters */
+	struct aleshadow ale;
+	struct cpswif_ale_stats ale_stats;
+
+#if LWIP_SUPPORT_CUSTOM_PBUF
+	/* Buffers for the rx bd's */
+	struct rxpool rxpool;
+#endif
+};
 
 /* Defining set of CPSW base addresses for all the instances */
 static struct cpswinst cpsw_inst_data[MAX_CPSW_INST];
 
+/* Instances in dual MAC mode, one bit each, see cpswif_dual_mac_set */
+#ifdef CPSW_DUAL_MAC_MODE
+static u32_t cpsw_dual_mac = (1 << MAX_CPSW_INST) - 1;
+#else
+static u32_t cpsw_dual_mac = 0;
+#endif
+
+#define CPSW_DUAL_MAC(inst_num)           ((cpsw_dual_mac >> (inst_num)) & 0x01)
+
+#if LWIP_SUPPORT_CUSTOM_PBUF
+static struct rxbuf rx_bufs[MAX_CPSW_INST][CPSW_RX_POOL_SIZE];
+
+/* DMA target, cache line aligned */
+#ifdef __TMS470__
+#pragma DATA_ALIGN(rx_buf_mem, SOC_CACHELINE_SIZE_BYTES)
+static u8_t rx_buf_mem[MAX_CPSW_INST][CPSW_RX_POOL_SIZE][CPSW_RX_BUF_SIZE];
+#else
+static u8_t rx_buf_mem[MAX_CPSW_INST][CPSW_RX_POOL_SIZE][CPSW_RX_BUF_SIZE]
+		__attribute__ ((aligned (SOC_CACHELINE_SIZE_BYTES)));
+#endif
+#endif
+
 /**
  * Function to setup the instance parameters inside the interface
  * @param  cpswif  The interface structure pointer
@@ -286,6 +569,7 @@ static void cpswif_inst_config(struct cpswportif *cpswif) {
 		cpswinst->ale_base = CPSW0_ALE_REGS;
 		cpswinst->cppi_ram_base = CPSW0_CPPI_RAM_REGS;
 		cpswinst->host_port_base = CPSW0_PORT_0_REGS;
+		cpswinst->stat_base = CPSW0_STAT_REGS;
 		cpswinst->port[PORT_1].port_base = CPSW0_PORT_1_REGS;
 		cpswinst->port[PORT_1].sliver_base = CPSW0_SLIVER_1_REGS;
 #ifdef CPSW0_PORT_1_PHY_ADDR
@@ -302,31 +586,237 @@ static void cpswif_inst_config(struct cpswportif *cpswif) {
 }
 
 /**
- * Gives the index of the ALE entry which is free
+ * Gives the hash bucket of an address or VLAN
+ * @param  addr  The address, last byte first as in the ALE entry,
+ *               NULL for a VLAN
+ * @param  vid   VLAN ID
+ *
+ * @return the hash bucket
+ */
+static u32_t cpswif_ale_hash(u8_t *addr, u32_t vid) {
+	u32_t hash = vid;
+	u32_t cnt;
+
+	if (NULL == addr) {
+		/* Keep VLANs apart from the addresses of VLAN 0 */
+		hash |= ALE_VLAN_ID_MASK + 1;
+	} else {
+		for (cnt = 0; cnt < ETHARP_HWADDR_LEN; cnt++) {
+			hash = (hash * 31) + addr[cnt];
+		}
+	}
+
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+
+	return hash & (ALE_HASH_SIZE - 1);
+}
+
+/**
+ * Gives the hash bucket of an ALE entry
+ * @param  ale_entry  The ALE entry
+ *
+ * @return the hash bucket
+ *         ALE_IDX_NONE if the entry is free
+ */
+static s32_t cpswif_ale_entry_hash(u32_t *ale_entry) {
+	u32_t type = *(((u8_t *)ale_entry) + ENTRY_TYPE_IDX) & ENTRY_TYPE;
+	u32_t vid = *(((u16_t *)ale_entry) + ALE_VLAN_ENTRY_ID) & ALE_VLAN_ID_MASK;
+
+	if (ENTRY_FREE == type)
+		return ALE_IDX_NONE;
+
+	if (ALE_ENTRY_VLAN == type)
+		return cpswif_ale_hash(NULL, vid);
+
+	return cpswif_ale_hash((u8_t *)ale_entry, vid);
+}
+
+/**
+ * Checks if an ALE entry is an ageable unicast address, one the ALE may
+ * have learned and may age out.
+ * @param  ale_entry  The ALE entry
+ *
+ * @return TRUE if the entry is ageable
+ */
+static u32_t cpswif_ale_entry_ageable(u32_t *ale_entry) {
+	u32_t type = *(((u8_t *)ale_entry) + ENTRY_TYPE_IDX) & ENTRY_TYPE;
+
+	if ((type != ALE_ENTRY_ADDR) && (type != ALE_ENTRY_VLAN_ADDR))
+		return FALSE;
+
+	/* The multicast bit is in the first byte of the address, stored last */
+	if (*(((u8_t *)ale_entry) + ETHARP_HWADDR_LEN - 1) & MASK_MULTICAST_ADDR)
+		return FALSE;
+
+	type = *(((u8_t *)ale_entry) + ALE_UCAST_ENTRY_TYPE) & ALE_UCAST_TYPE_MASK;
+
+	return (type != ALE_UCAST_TYPE_PERSISTANT) && (type != ALE_UCAST_TYPE_OUI);
+}
+
+/**
+ * Puts a shadow entry in its hash bucket, or in the free list if it is free
+ * @param  shadow  The ALE shadow
+ * @param  idx     Index of the entry
+ *
+ * @return None
+ */
+static void cpswif_ale_shadow_link(struct aleshadow *shadow, s32_t idx) {
+	s32_t hash = cpswif_ale_entry_hash(shadow->entry[idx]);
+
+	if (ALE_IDX_NONE == hash) {
+		shadow->next[idx] = shadow->free_head;
+		shadow->free_head = idx;
+	} else {
+		shadow->next[idx] = shadow->bucket[hash];
+		shadow->bucket[hash] = idx;
+	}
+}
+
+/**
+ * Takes a shadow entry out of its hash bucket or the free list
+ * @param  shadow  The ALE shadow
+ * @param  idx     Index of the entry
+ *
+ * @return None
+ */
+static void cpswif_ale_shadow_unlink(struct aleshadow *shadow, s32_t idx) {
+	s32_t hash = cpswif_ale_entry_hash(shadow->entry[idx]);
+	s16_t *link;
+
+	if (ALE_IDX_NONE == hash) {
+		link = &shadow->free_head;
+	} else {
+		link = &shadow->bucket[hash];
+	}
+
+	while (*link != idx) {
+		if (ALE_IDX_NONE == *link)
+			return;
+
+		link = &shadow->next[*link];
+	}
+
+	*link = shadow->next[idx];
+}
+
+/**
+ * Builds the ALE shadow of an instance and its index
+ * @param  cpswinst  The CPSW instance structure pointer
+ * @param  read      Read the entries from the ALE, else the ALE table has
+ *                   just been cleared
+ *
+ * @return None
+ */
+static void cpswif_ale_shadow_load(struct cpswinst *cpswinst, u32_t read) {
+	struct aleshadow *shadow = &cpswinst->ale;
+	s32_t idx;
+	u32_t cnt;
+
+	for (idx = 0; idx < ALE_HASH_SIZE; idx++) {
+		shadow->bucket[idx] = ALE_IDX_NONE;
+	}
+
+	shadow->free_head = ALE_IDX_NONE;
+
+	if (read) {
+		cpswinst->ale_stats.reloads++;
+	}
+
+	/* Backwards, so the free list hands out the lowest index first */
+	for (idx = MAX_ALE_ENTRIES - 1; idx >= 0; idx--) {
+		if (read) {
+			CPSWALETableEntryGet(cpswinst->ale_base, idx, shadow->entry[idx]);
+		} else {
+			for (cnt = 0; cnt < ALE_ENTRY_NUM_WORDS; cnt++) {
+				shadow->entry[idx][cnt] = 0;
+			}
+		}
+
+		cpswif_ale_shadow_link(shadow, idx);
+	}
+}
+
+/**
+ * Writes an entry of the ALE table and its shadow. Entries which did not
+ * change are not written, except ageable ones, which the ALE may have aged
+ * out behind the shadow.
+ * @param  cpswinst   The CPSW instance structure pointer
+ * @param  idx        Index of the entry
+ * @param  ale_entry  The ALE entry
+ *
+ * @return None
+ */
+static void cpswif_ale_entry_set(struct cpswinst *cpswinst, s32_t idx,
+		u32_t *ale_entry) {
+	struct aleshadow *shadow = &cpswinst->ale;
+	u32_t cnt;
+
+	for (cnt = 0; cnt < ALE_ENTRY_NUM_WORDS; cnt++) {
+		if (shadow->entry[idx][cnt] != ale_entry[cnt])
+			break;
+	}
+
+	if ((ALE_ENTRY_NUM_WORDS == cnt) && !cpswif_ale_entry_ageable(ale_entry))
+		return;
+
+	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_entry);
+
+	cpswif_ale_shadow_unlink(shadow, idx);
+
+	for (cnt = 0; cnt < ALE_ENTRY_NUM_WORDS; cnt++) {
+		shadow->entry[idx][cnt] = ale_entry[cnt];
+	}
+
+	cpswif_ale_shadow_link(shadow, idx);
+}
+
+/**
+ * Gives the index of the ALE entry which is free. The entry is read back
+ * from the ALE, which may have learned an address into it.
  * @param  cpswinst  The CPSW instance structure pointer
  *
  * @return index of the ALE entry which is free
  *         ERR_VAL if entry not found
  */
-static err_t cpswif_ale_entry_match_free(struct cpswinst *cpswinst) {
+static s32_t cpswif_ale_entry_match_free(struct cpswinst *cpswinst) {
+	struct aleshadow *shadow = &cpswinst->ale;
 	u32_t ale_entry[ALE_ENTRY_NUM_WORDS];
+	u32_t reloaded = FALSE;
+	u32_t cnt;
 	s32_t idx;
 
-	/* Check which ALE entry is free starting from 0th entry */
-	for (idx = 0; idx < MAX_ALE_ENTRIES; idx++) {
+	while (1) {
+		idx = shadow->free_head;
+
+		/* Entries the ALE aged out show up on a reload only */
+		if (ALE_IDX_NONE == idx) {
+			if (reloaded)
+				return ERR_VAL;
+
+			cpswif_ale_shadow_load(cpswinst, TRUE);
+			reloaded = TRUE;
+			continue;
+		}
+
 		CPSWALETableEntryGet(cpswinst->ale_base, idx, ale_entry);
 
-		/* Break if the table entry is free */
 		if (((*(((u8_t *) ale_entry) + ENTRY_TYPE_IDX)) & ENTRY_TYPE)
 				== ENTRY_FREE) {
 			return idx;
 		}
-	}
 
-	return ERR_VAL;
+		/* Learned, move it to its hash bucket */
+		shadow->free_head = shadow->next[idx];
+
+		for (cnt = 0; cnt < ALE_ENTRY_NUM_WORDS; cnt++) {
+			shadow->entry[idx][cnt] = ale_entry[cnt];
+		}
+
+		cpswif_ale_shadow_link(shadow, idx);
+	}
 }
 
-#ifdef CPSW_DUAL_MAC_MODE
 /**
  * Sets the VLAN and VLAN/UCAST entries in ALE table for Dual Mac mode
  * @param cpswinst   The CPSW instance structure pointer
@@ -344,7 +834,7 @@ static void cpswif_port_to_host_vlan_cfg(struct cpswinst *cpswinst,
 
 	idx = cpswif_ale_entry_match_free(cpswinst);
 
-	if (MAX_ALE_ENTRIES == idx) {
+	if (ERR_VAL == idx) {
 		return;
 	}
 
@@ -352,6 +842,15 @@ static void cpswif_port_to_host_vlan_cfg(struct cpswinst *cpswinst,
 	*(((u8_t *) ale_v_entry) + ALE_VLAN_ENTRY_MEMBER_LIST) = HOST_PORT_MASK
 			| SLAVE_PORT_MASK(port_num);
 
+	/**
+	 * Broadcast and multicast of the port VLAN go to the host only, the
+	 * other slave port is not a member.
+	 */
+	*(((u8_t *) ale_v_entry) + ALE_VLAN_ENTRY_MCAST_UNREG) = HOST_PORT_MASK
+			| SLAVE_PORT_MASK(port_num);
+	*(((u8_t *) ale_v_entry) + ALE_VLAN_ENTRY_MCAST_REG) = HOST_PORT_MASK
+			| SLAVE_PORT_MASK(port_num);
+
 	/**
 	 * Set the bit fields for entry type and VLAN ID. Set the port
 	 * number as VLAN ID. So only lsb 2 bits of VLAN_ID field will be used.
@@ -364,11 +863,11 @@ static void cpswif_port_to_host_vlan_cfg(struct cpswinst *cpswinst,
 			| SLAVE_PORT_MASK(port_num);
 
 	/* Set the VLAN entry in the ALE table */
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_v_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_v_entry);
 
 	idx = cpswif_ale_entry_match_free(cpswinst);
 
-	if (MAX_ALE_ENTRIES == idx) {
+	if (ERR_VAL == idx) {
 		return;
 	}
 
@@ -383,11 +882,9 @@ static void cpswif_port_to_host_vlan_cfg(struct cpswinst *cpswinst,
 	*(((u8_t *) ale_vu_entry) + ALE_VLANUCAST_ENTRY_ID_BIT0_BIT7) = port_num;
 
 	/* Set the VLAN/Unicast entry in the ALE table */
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_vu_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_vu_entry);
 }
 
-#else /* CPSW_DUAL_MAC_MODE */
-
 /**
  * Sets a unicast entry in the ALE table.
  * @param cpswinst   The CPSW instance structure pointer
@@ -413,8 +910,8 @@ cpswif_ale_unicastentry_set(struct cpswinst *cpswinst, u32_t port_num,
 
 	idx = cpswif_ale_entry_match_free(cpswinst);
 
-	if (idx < MAX_ALE_ENTRIES ) {
-		CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_entry);
+	if (ERR_VAL != idx) {
+		cpswif_ale_entry_set(cpswinst, idx, ale_entry);
 	}
 }
 
@@ -436,7 +933,7 @@ cpswif_ale_multicastentry_set(struct cpswinst *cpswinst, u32_t portmask,
 	u32_t ale_entry[ALE_ENTRY_NUM_WORDS] = {0, 0, 0};
 
 	idx = cpswif_ale_entry_match_free(cpswinst);
-	if (idx < MAX_ALE_ENTRIES ) {
+	if (ERR_VAL != idx) {
 		for (cnt = 0; cnt < ETHARP_HWADDR_LEN; cnt++) {
 			*(((u8_t *)ale_entry) + cnt) = eth_addr[ETHARP_HWADDR_LEN - cnt -1];
 		}
@@ -445,10 +942,9 @@ cpswif_ale_multicastentry_set(struct cpswinst *cpswinst, u32_t portmask,
 		*(((u8_t *)ale_entry) + ALE_MCAST_ENTRY_PORTMASK_SUP) |=
 		(portmask << ALE_MCAST_ENTRY_PORTMASK_SHIFT);
 
-		CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_entry);
+		cpswif_ale_entry_set(cpswinst, idx, ale_entry);
 	}
 }
-#endif /* CPSW_DUAL_MAC_MODE */
 
 #ifdef CPSW_SWITCH_CONFIG
 /**
@@ -489,34 +985,36 @@ check_valid_addr(u8_t *eth_addr, u32_t addr_type) {
 }
 
 /**
- * Gives the index of the ALE entry which is untouched ageable
+ * Gives an entry of the ALE table from the shadow
+ * @param  cpswinst   The CPSW instance structure pointer
+ * @param  idx        Index of the entry
+ * @param  ale_entry  Filled with the ALE entry
+ *
+ * @return None
+ */
+static void cpswif_ale_entry_get(struct cpswinst *cpswinst, s32_t idx,
+		u32_t *ale_entry) {
+	u32_t cnt;
+
+	for (cnt = 0; cnt < ALE_ENTRY_NUM_WORDS; cnt++) {
+		ale_entry[cnt] = cpswinst->ale.entry[idx][cnt];
+	}
+}
+
+/**
+ * Gives the index of the ALE entry which is untouched ageable, from the
+ * shadow
  * @param  cpswinst  The CPSW instance structure pointer
  *
  * @return index of the ALE entry which is free
  *         ERR_VAL if entry not found
  */
-static err_t
+static s32_t
 cpswif_ale_entry_match_ageable(struct cpswinst *cpswinst) {
-	u32_t ale_entry[ALE_ENTRY_NUM_WORDS];
-	u32_t type;
 	s32_t idx;
 
-	/* Check which ALE entry is free starting from 0th entry */
 	for (idx = 0; idx < MAX_ALE_ENTRIES; idx++) {
-		CPSWALETableEntryGet(cpswinst->ale_base, idx, ale_entry);
-
-		type = *(((u8_t *)ale_entry) + ENTRY_TYPE_IDX) & ENTRY_TYPE;
-
-		/* Goto next entry if the ale entry is not valid address */
-		if ((type != ALE_ENTRY_ADDR) && (type != ALE_ENTRY_VLAN_ADDR))
-		continue;
-
-		if (check_valid_addr((u8_t *)ale_entry, ADDR_TYPE_MULTICAST))
-		continue;
-
-		type = *(((u8_t *)ale_entry) + ALE_UCAST_ENTRY_TYPE) & ALE_UCAST_TYPE_MASK;
-
-		if ((type != ALE_UCAST_TYPE_PERSISTANT) && (type != ALE_UCAST_TYPE_OUI))
+		if (cpswif_ale_entry_ageable(cpswinst->ale.entry[idx]))
 		return idx;
 	}
 
@@ -566,44 +1064,86 @@ cpswif_rate_limit(struct cpswinst *cpswinst, u32_t enable, u32_t direction,
 }
 
 /**
- * Gives the index of the ALE entry which match address of VLAN
- * @param  cpswinst  The CPSW instance structure pointer
- * @param  eth_addr  Ethernet address
- * @param  vid       VLAN ID
+ * Looks up an address or VLAN in the hash index of the ALE shadow
+ * @param  shadow  The ALE shadow
+ * @param  addr    The address, last byte first as in the ALE entry,
+ *                 NULL for a VLAN
+ * @param  vid     VLAN ID
  *
- * @return index of the ALE entry which match address of VLAN
- *         ERR_VAL if entry not found
+ * @return index of the ALE entry
+ *         ALE_IDX_NONE if entry not found
  */
-static err_t
-cpswif_ale_entry_match_addr(struct cpswinst *cpswinst, u8_t *eth_addr,
-		u32_t vid) {
-	u32_t ale_entry[ALE_ENTRY_NUM_WORDS];
+static s32_t
+cpswif_ale_shadow_find(struct aleshadow *shadow, u8_t *addr, u32_t vid) {
+	u8_t *entry;
 	u32_t type, cnt;
 	s32_t idx;
 
-	/* Check which ALE entry is free starting from 0th entry */
-	for (idx = 0; idx < MAX_ALE_ENTRIES; idx++) {
-		CPSWALETableEntryGet(cpswinst->ale_base, idx, ale_entry);
-
-		type = *(((u8_t *)ale_entry) + ENTRY_TYPE_IDX) & ENTRY_TYPE;
+	for (idx = shadow->bucket[cpswif_ale_hash(addr, vid)];
+			idx != ALE_IDX_NONE; idx = shadow->next[idx]) {
+		entry = (u8_t *)shadow->entry[idx];
+		type = entry[ENTRY_TYPE_IDX] & ENTRY_TYPE;
 
-		/* Goto next entry if the ale entry is not valid address */
-		if ((type != ALE_ENTRY_ADDR) && (type != ALE_ENTRY_VLAN_ADDR))
+		if ((*(((u16_t *)entry) + ALE_VLAN_ENTRY_ID) & ALE_VLAN_ID_MASK) != vid)
 		continue;
 
-		if ((*(((u16_t *)ale_entry) + ALE_VLAN_ENTRY_ID) & ALE_VLAN_ID_MASK) != vid)
+		if (NULL == addr) {
+			if (ALE_ENTRY_VLAN == type)
+			return idx;
+
+			continue;
+		}
+
+		if (ALE_ENTRY_VLAN == type)
 		continue;
 
 		for (cnt = 0; cnt < ETHARP_HWADDR_LEN; cnt++) {
-			if (*(((u8_t *)ale_entry) + cnt) != eth_addr[ETHARP_HWADDR_LEN - cnt -1])
+			if (entry[cnt] != addr[cnt])
 			break;
-
-			if (ETHARP_HWADDR_LEN == (cnt + 1))
-			return idx;
 		}
+
+		if (ETHARP_HWADDR_LEN == cnt)
+		return idx;
+	}
+
+	return ALE_IDX_NONE;
+}
+
+/**
+ * Gives the index of the ALE entry which match address of VLAN. Unicast
+ * addresses the ALE learned after the last reload of the shadow are not
+ * in it, the shadow is reloaded before a unicast address is reported
+ * missing.
+ * @param  cpswinst  The CPSW instance structure pointer
+ * @param  eth_addr  Ethernet address
+ * @param  vid       VLAN ID
+ *
+ * @return index of the ALE entry which match address of VLAN
+ *         ERR_VAL if entry not found
+ */
+static s32_t
+cpswif_ale_entry_match_addr(struct cpswinst *cpswinst, u8_t *eth_addr,
+		u32_t vid) {
+	u8_t addr[ETHARP_HWADDR_LEN];
+	u32_t cnt;
+	s32_t idx;
+
+	for (cnt = 0; cnt < ETHARP_HWADDR_LEN; cnt++) {
+		addr[cnt] = eth_addr[ETHARP_HWADDR_LEN - cnt -1];
+	}
+
+	idx = cpswif_ale_shadow_find(&cpswinst->ale, addr, vid);
+
+	if ((ALE_IDX_NONE == idx) &&
+			((eth_addr[0] & MASK_MULTICAST_ADDR) != MASK_MULTICAST_ADDR)) {
+		cpswif_ale_shadow_load(cpswinst, TRUE);
+		idx = cpswif_ale_shadow_find(&cpswinst->ale, addr, vid);
 	}
 
+	if (ALE_IDX_NONE == idx)
 	return ERR_VAL;
+
+	return idx;
 }
 
 /**
@@ -614,27 +1154,16 @@ cpswif_ale_entry_match_addr(struct cpswinst *cpswinst, u8_t *eth_addr,
  * @return index of the ALE entry which match vlan
  *         ERR_VAL if entry not found
  */
-static err_t
+static s32_t
 cpswif_ale_entry_match_vlan(struct cpswinst *cpswinst, u32_t vid) {
-	u32_t ale_entry[ALE_ENTRY_NUM_WORDS];
-	u32_t type;
 	s32_t idx;
 
-	/* Check which ALE entry is free starting from 0th entry */
-	for (idx = 0; idx < MAX_ALE_ENTRIES; idx++) {
-		CPSWALETableEntryGet(cpswinst->ale_base, idx, ale_entry);
-
-		type = *(((u8_t *)ale_entry) + ENTRY_TYPE_IDX) & ENTRY_TYPE;
-
-		/* Goto next entry if the ale entry is not valid vlan */
-		if (type != ALE_ENTRY_VLAN)
-		continue;
-
-		if ((*(((u16_t *)ale_entry) + ALE_VLAN_ENTRY_ID) & ALE_VLAN_ID_MASK) == vid)
-		return idx;
-	}
+	idx = cpswif_ale_shadow_find(&cpswinst->ale, NULL, vid);
 
+	if (ALE_IDX_NONE == idx)
 	return ERR_VAL;
+
+	return idx;
 }
 
 /**
@@ -649,7 +1178,7 @@ cpswif_ale_entry_match_vlan(struct cpswinst *cpswinst, u32_t vid) {
  * @return index of the ALE entry added
  *         ERR_VAL if table entry is not free
  */
-static err_t
+static s32_t
 cpswif_ale_unicastentry_add(struct cpswinst *cpswinst, u32_t port_num,
 		u8_t *eth_addr, u32_t flags, u32_t ucast_type) {
 	volatile u32_t cnt;
@@ -677,7 +1206,7 @@ cpswif_ale_unicastentry_add(struct cpswinst *cpswinst, u32_t port_num,
 	(port_num << ALE_UCAST_ENTRY_PORT_SHIFT) |
 	(flags & ALE_UCAST_ENTRY_DLR_BLK_SEC_MASK);
 
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_entry);
 
 	return idx;
 }
@@ -690,7 +1219,7 @@ cpswif_ale_unicastentry_add(struct cpswinst *cpswinst, u32_t port_num,
  * @return index of the ALE entry added
  *         ERR_VAL if table entry is not free
  */
-static err_t
+static s32_t
 cpswif_ale_OUI_add(struct cpswinst *cpswinst, u8_t *eth_addr) {
 	volatile u32_t cnt;
 	volatile s32_t idx;
@@ -713,7 +1242,7 @@ cpswif_ale_OUI_add(struct cpswinst *cpswinst, u8_t *eth_addr) {
 
 	*(((u8_t *)ale_entry) + ALE_UCAST_ENTRY_TYPE) = ALE_ENTRY_ADDR | ALE_ENTRY_OUI;
 
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_entry);
 
 	return idx;
 }
@@ -727,7 +1256,7 @@ cpswif_ale_OUI_add(struct cpswinst *cpswinst, u8_t *eth_addr) {
  * @return index of the ALE entry deleted
  *         ERR_VAL if table entry is not present
  */
-static err_t
+static s32_t
 cpswif_ale_unicastentry_del(struct cpswinst *cpswinst, u32_t port_num,
 		u8_t *eth_addr) {
 	volatile s32_t idx;
@@ -740,7 +1269,7 @@ cpswif_ale_unicastentry_del(struct cpswinst *cpswinst, u32_t port_num,
 	if (ERR_VAL == idx)
 	return ERR_VAL;
 
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_entry);
 
 	return idx;
 }
@@ -756,7 +1285,7 @@ cpswif_ale_unicastentry_del(struct cpswinst *cpswinst, u32_t port_num,
  * @return index of the ALE entry added
  *         ERR_VAL if table entry is not free
  */
-static err_t
+static s32_t
 cpswif_ale_multicastentry_add(struct cpswinst *cpswinst, u32_t portmask,
 		u8_t *eth_addr, u32_t super, u32_t mcast_st) {
 	volatile s32_t idx;
@@ -769,7 +1298,7 @@ cpswif_ale_multicastentry_add(struct cpswinst *cpswinst, u32_t portmask,
 		idx = cpswif_ale_entry_match_free(cpswinst);
 	} else {
 		/* Get the entry in the ALE table */
-		CPSWALETableEntryGet(cpswinst->ale_base, idx, ale_entry);
+		cpswif_ale_entry_get(cpswinst, idx, ale_entry);
 	}
 
 	if (ERR_VAL == idx)
@@ -795,7 +1324,7 @@ cpswif_ale_multicastentry_add(struct cpswinst *cpswinst, u32_t portmask,
 	((super << ALE_MCAST_ENTRY_SUPER_SHIFT) &
 			ALE_MCAST_ENTRY_SUPER_MASK);
 
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_entry);
 
 	return idx;
 }
@@ -809,7 +1338,7 @@ cpswif_ale_multicastentry_add(struct cpswinst *cpswinst, u32_t portmask,
  * @return index of the ALE entry deleted
  *         ERR_VAL if table entry is not present
  */
-static err_t
+static s32_t
 cpswif_ale_multicastentry_del(struct cpswinst *cpswinst, u32_t portmask,
 		u8_t *eth_addr) {
 	volatile s32_t idx;
@@ -820,7 +1349,7 @@ cpswif_ale_multicastentry_del(struct cpswinst *cpswinst, u32_t portmask,
 	if (ERR_VAL == idx)
 	return ERR_VAL;
 
-	CPSWALETableEntryGet(cpswinst->ale_base, idx, ale_entry);
+	cpswif_ale_entry_get(cpswinst, idx, ale_entry);
 
 	if (portmask) {
 		*(((u8_t *)ale_entry) + ALE_MCAST_ENTRY_PORTMASK_SUP) &=
@@ -831,7 +1360,7 @@ cpswif_ale_multicastentry_del(struct cpswinst *cpswinst, u32_t portmask,
 		*(((u8_t *)ale_entry) + ALE_MCAST_ENTRY_TYPE_FWD_STATE) = ENTRY_FREE;
 	}
 
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_entry);
 
 	return idx;
 }
@@ -848,7 +1377,7 @@ cpswif_ale_multicastentry_del(struct cpswinst *cpswinst, u32_t portmask,
  * @return index of the ALE entry added
  *         ERR_VAL if table entry is not free
  */
-static err_t
+static s32_t
 cpswif_ale_vlan_add(struct cpswinst *cpswinst, u32_t vid, u32_t port_num,
 		u32_t untag, u32_t reg_mcast, u32_t unreg_mcast) {
 	s32_t idx;
@@ -860,7 +1389,7 @@ cpswif_ale_vlan_add(struct cpswinst *cpswinst, u32_t vid, u32_t port_num,
 		idx = cpswif_ale_entry_match_free(cpswinst);
 	} else {
 		/* Get the entry in the ALE table */
-		CPSWALETableEntryGet(cpswinst->ale_base, idx, ale_v_entry);
+		cpswif_ale_entry_get(cpswinst, idx, ale_v_entry);
 	}
 
 	if (ERR_VAL == idx)
@@ -883,7 +1412,7 @@ cpswif_ale_vlan_add(struct cpswinst *cpswinst, u32_t vid, u32_t port_num,
 	PORT_MASK & INDV_PORT_MASK(port_num);
 
 	/* Set the VLAN entry in the ALE table */
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_v_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_v_entry);
 
 	return idx;
 }
@@ -897,7 +1426,7 @@ cpswif_ale_vlan_add(struct cpswinst *cpswinst, u32_t vid, u32_t port_num,
  * @return index of the ALE entry deleted
  *         ERR_VAL if table entry is not present
  */
-static err_t
+static s32_t
 cpswif_ale_vlan_del(struct cpswinst *cpswinst, u32_t vid, u32_t port_num) {
 	s32_t idx;
 	u32_t mask;
@@ -908,7 +1437,7 @@ cpswif_ale_vlan_del(struct cpswinst *cpswinst, u32_t vid, u32_t port_num) {
 	if (ERR_VAL == idx)
 	return ERR_VAL;
 
-	CPSWALETableEntryGet(cpswinst->ale_base, idx, ale_v_entry);
+	cpswif_ale_entry_get(cpswinst, idx, ale_v_entry);
 
 	/* Set up the VLAN Entry */
 	mask = *(((u8_t *)ale_v_entry) + ALE_VLAN_ENTRY_MEMBER_LIST) | PORT_MASK;
@@ -926,7 +1455,7 @@ cpswif_ale_vlan_del(struct cpswinst *cpswinst, u32_t vid, u32_t port_num) {
 	}
 
 	/* Set the VLAN/Unicast entry in the ALE table */
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_v_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_v_entry);
 
 	return idx;
 }
@@ -944,7 +1473,7 @@ cpswif_ale_vlan_del(struct cpswinst *cpswinst, u32_t vid, u32_t port_num) {
  * @return index of the ALE entry added
  *         ERR_VAL if table entry is not free
  */
-static err_t
+static s32_t
 cpswif_ale_vlan_add_ucast(struct cpswinst *cpswinst, u32_t vid, u32_t port_num,
 		u8_t *eth_addr, u32_t flags, u32_t ucast_type) {
 	s32_t idx;
@@ -980,7 +1509,7 @@ cpswif_ale_vlan_add_ucast(struct cpswinst *cpswinst, u32_t vid, u32_t port_num,
 	(flags & ALE_UCAST_ENTRY_DLR_BLK_SEC_MASK);
 
 	/* Set the VLAN entry in the ALE table */
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_vu_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_vu_entry);
 
 	return idx;
 }
@@ -994,7 +1523,7 @@ cpswif_ale_vlan_add_ucast(struct cpswinst *cpswinst, u32_t vid, u32_t port_num,
  * @return index of the ALE entry deleted
  *         ERR_VAL if table entry is not present
  */
-static err_t
+static s32_t
 cpswif_ale_vlan_del_ucast(struct cpswinst *cpswinst, u32_t vid, u32_t port_num,
 		u8_t *eth_addr) {
 	volatile s32_t idx;
@@ -1007,7 +1536,7 @@ cpswif_ale_vlan_del_ucast(struct cpswinst *cpswinst, u32_t vid, u32_t port_num,
 	if (ERR_VAL == idx)
 	return ERR_VAL;
 
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_vu_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_vu_entry);
 
 	return idx;
 }
@@ -1024,7 +1553,7 @@ cpswif_ale_vlan_del_ucast(struct cpswinst *cpswinst, u32_t vid, u32_t port_num,
  * @return index of the ALE entry added
  *         ERR_VAL if table entry is not free
  */
-static err_t
+static s32_t
 cpswif_ale_vlan_add_mcast(struct cpswinst *cpswinst, u32_t vid, u32_t portmask,
 		u8_t *eth_addr, u32_t super, u32_t mcast_st) {
 	s32_t idx;
@@ -1037,7 +1566,7 @@ cpswif_ale_vlan_add_mcast(struct cpswinst *cpswinst, u32_t vid, u32_t portmask,
 		idx = cpswif_ale_entry_match_free(cpswinst);
 	} else {
 		/* Get the entry in the ALE table */
-		CPSWALETableEntryGet(cpswinst->ale_base, idx, ale_vm_entry);
+		cpswif_ale_entry_get(cpswinst, idx, ale_vm_entry);
 	}
 
 	if (ERR_VAL == idx)
@@ -1072,7 +1601,7 @@ cpswif_ale_vlan_add_mcast(struct cpswinst *cpswinst, u32_t vid, u32_t portmask,
 			ALE_MCAST_ENTRY_SUPER_MASK);
 
 	/* Set the VLAN entry in the ALE table */
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_vm_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_vm_entry);
 
 	return idx;
 }
@@ -1087,7 +1616,7 @@ cpswif_ale_vlan_add_mcast(struct cpswinst *cpswinst, u32_t vid, u32_t portmask,
  * @return index of the ALE entry deleted
  *         ERR_VAL if table entry is not present
  */
-static err_t
+static s32_t
 cpswif_ale_vlan_del_mcast(struct cpswinst *cpswinst, u32_t vid, u32_t portmask,
 		u8_t *eth_addr) {
 	volatile s32_t idx;
@@ -1098,7 +1627,7 @@ cpswif_ale_vlan_del_mcast(struct cpswinst *cpswinst, u32_t vid, u32_t portmask,
 	if (ERR_VAL == idx)
 	return ERR_VAL;
 
-	CPSWALETableEntryGet(cpswinst->ale_base, idx, ale_vm_entry);
+	cpswif_ale_entry_get(cpswinst, idx, ale_vm_entry);
 
 	if (portmask) {
 		*(((u8_t *)ale_vm_entry) + ALE_MCAST_ENTRY_PORTMASK_SUP) &=
@@ -1109,7 +1638,7 @@ cpswif_ale_vlan_del_mcast(struct cpswinst *cpswinst, u32_t vid, u32_t portmask,
 		*(((u8_t *)ale_vm_entry) + ALE_MCAST_ENTRY_TYPE_FWD_STATE) = ENTRY_FREE;
 	}
 
-	CPSWALETableEntrySet(cpswinst->ale_base, idx, ale_vm_entry);
+	cpswif_ale_entry_set(cpswinst, idx, ale_vm_entry);
 
 	return idx;
 }
@@ -1506,16 +2035,99 @@ static err_t cpswif_autoneg_config(u32_t inst_num, u32_t port_num) {
 	return linkstat;
 }
 
+#if LWIP_SUPPORT_CUSTOM_PBUF
+/**
+ * Custom pbuf free function of the receive buffers. Called by lwIP when the
+ * last reference is gone, from the main loop or from the RX path.
+ *
+ * @param p   the custom pbuf of a receive buffer
+ * @return None
+ */
+static void cpswif_rxbuf_free(struct pbuf *p) {
+	struct rxbuf *buf = (struct rxbuf *) p;
+	struct rxpool *pool = buf->pool;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	buf->next = pool->free_list;
+	pool->free_list = buf;
+	pool->free_num++;
+	SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Takes a buffer from the receive pool and wraps it into a custom pbuf of
+ * PBUF_LEN_MAX bytes.
+ *
+ * @param pool   the receive pool of the instance
+ * @return the pbuf, NULL if the pool is empty
+ */
+static struct pbuf *cpswif_rxbuf_get(struct rxpool *pool) {
+	struct rxbuf *buf;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	buf = pool->free_list;
+	if (buf != NULL) {
+		pool->free_list = buf->next;
+		pool->free_num--;
+
+		if (pool->free_num < pool->low_mark) {
+			pool->low_mark = pool->free_num;
+		}
+	}
+	SYS_ARCH_UNPROTECT(lev);
+
+	if (buf == NULL) {
+		return NULL;
+	}
+
+	buf->pc.custom_free_function = cpswif_rxbuf_free;
+
+	return pbuf_alloced_custom(PBUF_RAW, PBUF_LEN_MAX, PBUF_REF, &buf->pc,
+			buf->mem, CPSW_RX_BUF_SIZE);
+}
+
+/**
+ * Puts all receive buffers of an instance into its pool
+ *
+ * @param cpswinst   The CPSW instance structure pointer
+ * @return None
+ */
+static void cpswif_rxpool_init(struct cpswinst *cpswinst) {
+	u32_t inst_num = cpswinst - cpsw_inst_data;
+	struct rxpool *pool = &(cpswinst->rxpool);
+	struct rxbuf *buf;
+	u32_t cnt;
+
+	pool->free_list = NULL;
+	pool->free_num = 0;
+
+	for (cnt = 0; cnt < CPSW_RX_POOL_SIZE; cnt++) {
+		buf = &rx_bufs[inst_num][cnt];
+		buf->pool = pool;
+		buf->mem = rx_buf_mem[inst_num][cnt];
+		buf->next = pool->free_list;
+		pool->free_list = buf;
+		pool->free_num++;
+	}
+
+	pool->low_mark = pool->free_num;
+	pool->drops = 0;
+}
+#endif
+
 /**
  * This function allocates the rx buffer descriptors ring. The function
  * internally calls pbuf_alloc() and allocates the pbufs to the rx buffer
- * descriptors.
+ * descriptors. With LWIP_SUPPORT_CUSTOM_PBUF the pbufs come from the
+ * receive pool of the instance.
  *
  * @param   cpswinst   The CPSW instance structure pointer
+ * @param   rxch       The rx channel to refill
  * @return  None
  */
-static void cpswif_rxbd_alloc(struct cpswinst *cpswinst) {
-	struct rxch *rxch = &(cpswinst->rxch);
+static void cpswif_rxbd_alloc(struct cpswinst *cpswinst, struct rxch *rxch) {
 	struct pbuf *p;
 	volatile struct cpdma_rx_bd *curr_bd, *last_bd, *recv_tail, *recv_head;
 	u32_t saved_free_num;
@@ -1534,7 +2146,11 @@ static void cpswif_rxbd_alloc(struct cpswinst *cpswinst) {
 		 * Try to get a pbuf of max. length. This shall be cache line aligned if
 		 * cache is enabled.
 		 */
+#if LWIP_SUPPORT_CUSTOM_PBUF
+		p = cpswif_rxbuf_get(&(cpswinst->rxpool));
+#else
 		p = pbuf_alloc(PBUF_RAW, PBUF_LEN_MAX, PBUF_POOL);
+#endif
 
 		/**
 		 * Allocate bd's if p is not NULL. This allocation doesnt support
@@ -1542,18 +2158,26 @@ static void cpswif_rxbd_alloc(struct cpswinst *cpswinst) {
 		 */
 		if (p != NULL ) {
 #ifdef LWIP_CACHE_ENABLED
+#if LWIP_SUPPORT_CUSTOM_PBUF
+			/**
+			 * The buffer may have been written by lwIP. Drop those lines, an
+			 * eviction must not overwrite the received data.
+			 */
+			CacheDataInvalidateBuff((u32_t)(p->payload), CPSW_RX_BUF_SIZE);
+#else
 			/**
 			 * Clean the pbuf structure info. This is needed to prevent losing
 			 * pbuf structure info when we invalidate the pbuf on rx interrupt
 			 */
 			CacheDataCleanBuff((u32_t)(p), (u32_t)(SIZEOF_STRUCT_PBUF));
+#endif
 #endif
 			curr_bd->bufptr = (u32_t) (p->payload);
 			curr_bd->bufoff_len = p->len;
 			curr_bd->flags_pktlen = CPDMA_BUF_DESC_OWNER;
 
 			/* Save the pbuf */
-			curr_bd->pbuf = p;
+			rxch->pbuf[BD_SLOT(rxch, curr_bd)] = p;
 			last_bd = curr_bd;
 			curr_bd = curr_bd->next;
 			rxch->free_num--;
@@ -1562,6 +2186,11 @@ static void cpswif_rxbd_alloc(struct cpswinst *cpswinst) {
 		}
 	}
 
+	if (rxch->free_num) {
+		/* Out of pbufs, these bd's stay unarmed until the next call */
+		cpswinst->rx_stats.starved++;
+	}
+
 	if (saved_free_num == rxch->free_num) {
 		/* No bd's were allocated. Go back. */
 		return;
@@ -1577,7 +2206,7 @@ static void cpswif_rxbd_alloc(struct cpswinst *cpswinst) {
 		rxch->free_head = curr_bd;
 	} else {
 		CPSWCPDMARxHdrDescPtrWrite(cpswinst->cpdma_base, (u32_t) (recv_head),
-				0);
+				rxch->ch);
 	}
 
 	recv_tail->next = recv_head;
@@ -1592,7 +2221,7 @@ static void cpswif_rxbd_alloc(struct cpswinst *cpswinst) {
 	 */
 	if (recv_tail->flags_pktlen & CPDMA_BUF_DESC_EOQ) {
 		CPSWCPDMARxHdrDescPtrWrite(cpswinst->cpdma_base, (u32_t) (recv_head),
-				0);
+				rxch->ch);
 	}
 }
 
@@ -1601,31 +2230,50 @@ static void cpswif_rxbd_alloc(struct cpswinst *cpswinst) {
  * contained in the pbuf that is passed to the function. This pbuf might be
  * chained. That is, one pbuf can span more than one tx buffer descriptors
  *
+ * Only cpswif_tx_drain calls it, so the bd's from the free head on belong
+ * to this function until the packet is linked. Interrupts are masked only
+ * to take the bd's from free_num and to link the filled bd's to the chain
+ * of the DMA.
+ *
  * @param netif    the network interface state for this ethernetif
  * @param pbuf     the pbuf which is to be sent over EMAC
+ * @param txch     the tx channel of the class of the packet
  * @return status  ERR_OK, if transmit was successful
  *                 ERR_MEM, if no memory available
  */
-static err_t cpswif_transmit(struct netif *netif, struct pbuf *pbuf) {
+static err_t cpswif_transmit(struct netif *netif, struct pbuf *pbuf,
+		struct txch *txch) {
 	struct pbuf *q;
-	struct txch *txch;
 	volatile struct cpdma_tx_bd *curr_bd, *bd_to_send, *bd_end;
 	struct cpswportif *cpswif = netif->state;
 	u32_t inst_num = cpswif->inst_num;
 	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+	u32_t start = WatchCycleCountGet();
+	u32_t clen = pbuf_clen(pbuf);
+	struct cpswport *port = &cpswinst->port[cpswif->port_num - 1];
+	SYS_ARCH_DECL_PROTECT(lev);
 
-#ifdef CPSW_DUAL_MAC_MODE
-	u32_t port_num = cpswif->port_num;
-#endif
-
-	txch = &(cpswinst->txch);
+	/**
+	 * Do not send if there are no enough free bd's. The TX interrupt
+	 * increments free_num, take the bd's with interrupts masked.
+	 */
+	SYS_ARCH_PROTECT(lev);
 
-	/* Do not send if there are no enough free bd's */
-	if (pbuf_clen(pbuf) > txch->free_num) {
+	if (clen > txch->free_num) {
+		SYS_ARCH_UNPROTECT(lev);
 		return ERR_MEM;
 	}
 
-	/* Get the buffer descriptor which is free to transmit */
+	txch->free_num -= clen;
+
+	SYS_ARCH_UNPROTECT(lev);
+
+	/**
+	 * Get the buffer descriptor which is free to transmit. free_head moves
+	 * only when the packet is linked, until then the TX interrupt takes it
+	 * as the next packet to reclaim and stops there, as its SOP bd is owned
+	 * or has no SOP flag yet.
+	 */
 	curr_bd = txch->free_head;
 
 	bd_to_send = txch->free_head;
@@ -1636,10 +2284,10 @@ static err_t cpswif_transmit(struct netif *netif, struct pbuf *pbuf) {
 	/* Indicate the start of the packet */
 	curr_bd->flags_pktlen |= (CPDMA_BUF_DESC_SOP | CPDMA_BUF_DESC_OWNER);
 
-#ifdef CPSW_DUAL_MAC_MODE
-	/* Indicate to which port the packet has to be sent */
-	curr_bd->flags_pktlen |= CPDMA_BUF_DESC_TO_PORT(port_num);
-#endif
+	/* In dual MAC mode, indicate to which port the packet has to be sent */
+	if (CPSW_DUAL_MAC(inst_num)) {
+		curr_bd->flags_pktlen |= CPDMA_BUF_DESC_TO_PORT(cpswif->port_num);
+	}
 
 	/* Copy pbuf information into TX buffer descriptors */
 	for (q = pbuf; q != NULL ; q = q->next) {
@@ -1654,24 +2302,25 @@ static err_t cpswif_transmit(struct netif *netif, struct pbuf *pbuf) {
 		curr_bd->bufptr = (u32_t) (q->payload);
 		curr_bd->bufoff_len = (q->len) & CPDMA_BD_LEN_MASK;
 		bd_end = curr_bd;
-		curr_bd->pbuf = pbuf;
 		curr_bd = curr_bd->next;
-
-		/* Decrement free bds, since one is consumed */
-		txch->free_num--;
 	}
 
+	/* The pbuf is freed when the EOP bd is done */
+	txch->pbuf[BD_SLOT(txch, bd_end)] = pbuf;
+
 	/* Indicate the end of the packet */
 	bd_end->next = NULL;
 	bd_end->flags_pktlen |= CPDMA_BUF_DESC_EOP;
 	bd_end->flags_pktlen &= ~CPDMA_BUF_DESC_EOQ;
 
+	SYS_ARCH_PROTECT(lev);
+
 	txch->free_head = curr_bd;
 
 	/* For the first time, write the HDP with the filled bd */
 	if (txch->send_tail == NULL ) {
 		CPSWCPDMATxHdrDescPtrWrite(cpswinst->cpdma_base, (u32_t) (bd_to_send),
-				0);
+				txch->ch);
 	} else {
 		/**
 		 * Chain the bd's. If the DMA engine, already reached the end of the chain,
@@ -1683,15 +2332,188 @@ static err_t cpswif_transmit(struct netif *netif, struct pbuf *pbuf) {
 		if (curr_bd->flags_pktlen & CPDMA_BUF_DESC_EOQ) {
 			/* Write the Header Descriptor Pointer and start DMA */
 			CPSWCPDMATxHdrDescPtrWrite(cpswinst->cpdma_base,
-					(u32_t) (bd_to_send), 0);
+					(u32_t) (bd_to_send), txch->ch);
+
+			/* Restarted, the TX handler must not do it again */
+			curr_bd->flags_pktlen &= ~CPDMA_BUF_DESC_EOQ;
 		}
 	}
 
 	txch->send_tail = bd_end;
 
+	SYS_ARCH_UNPROTECT(lev);
+
+	cpswinst->tx_stats.frames++;
+	cpswinst->tx_stats.cycles += WatchCycleCountGet() - start;
+	port->stats.tx_frames++;
+	port->stats.tx_octets += pbuf->tot_len;
+
 	return ERR_OK;
 }
 
+/**
+ * Chooses the transmit class of a frame
+ *
+ * @param p       the frame, the first pbuf holds the ethernet header
+ * @return        CPSW_TXQ_CTRL, CPSW_TXQ_INTERACTIVE or CPSW_TXQ_BULK
+ */
+static u32_t cpswif_tx_class(struct pbuf *p) {
+	u8_t *frame = (u8_t *)(p->payload);
+	u32_t type, pri, ihl, port;
+
+	if (p->len < 24) {
+		return CPSW_TXQ_INTERACTIVE;
+	}
+
+	type = (frame[12] << 8) | frame[13];
+
+	/* Tagged frames keep the class of their VLAN priority */
+	if (type == ETHTYPE_VLAN) {
+		pri = frame[14] >> 5;
+
+		if (pri >= 6) {
+			return CPSW_TXQ_CTRL;
+		}
+
+		return (pri >= 4) ? CPSW_TXQ_INTERACTIVE : CPSW_TXQ_BULK;
+	}
+
+	if ((type == ETHTYPE_ARP) || (type == ETHTYPE_PTP)) {
+		return CPSW_TXQ_CTRL;
+	}
+
+	if (type == ETHTYPE_IP) {
+		switch (frame[23]) {
+		case IP_PROTO_ICMP:
+		case IP_PROTO_IGMP:
+			return CPSW_TXQ_CTRL;
+
+		case IP_PROTO_TCP:
+			return CPSW_TXQ_INTERACTIVE;
+
+		case IP_PROTO_UDP:
+			/* PTP over UDP, the destination port follows the IP header */
+			ihl = (frame[14] & 0x0F) << 2;
+
+			if (p->len >= (14 + ihl + 4)) {
+				port = (frame[14 + ihl + 2] << 8) | frame[14 + ihl + 3];
+
+				if ((port == PTP_EVENT_PORT) || (port == PTP_GENERAL_PORT)) {
+					return CPSW_TXQ_CTRL;
+				}
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	return (p->tot_len <= CPSW_TXQ_SMALL_LEN) ?
+			CPSW_TXQ_INTERACTIVE : CPSW_TXQ_BULK;
+}
+
+/**
+ * Adds a frame to the transmit queue of its class
+ *
+ * @param txq     the transmit queue
+ * @param netif   the interface to send the frame on
+ * @param p       the frame, referenced for the queue
+ * @param cls     the transmit class
+ * @return        1 if queued, 0 if the queue of the class is full
+ */
+static u32_t cpswif_txq_put(struct txq *txq, struct netif *netif,
+		struct pbuf *p, u32_t cls) {
+	struct txqent *ent;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+
+	if (txq->num[cls] == CPSW_TXQ_DEPTH) {
+		SYS_ARCH_UNPROTECT(lev);
+		return 0;
+	}
+
+	ent = &(txq->ent[cls][(txq->head[cls] + txq->num[cls]) % CPSW_TXQ_DEPTH]);
+	ent->p = p;
+	ent->netif = netif;
+	ent->clen = pbuf_clen(p);
+	txq->num[cls]++;
+
+	SYS_ARCH_UNPROTECT(lev);
+
+	return 1;
+}
+
+/**
+ * Checks if a queued frame fits into the ring of its class
+ *
+ * @param cpswinst  the instance
+ * @return        non-zero if cpswif_tx_drain can send a frame
+ */
+static u32_t cpswif_txq_ready(struct cpswinst *cpswinst) {
+	struct txq *txq = &(cpswinst->txq);
+	u32_t cls;
+
+	for (cls = 0; cls < CPSW_TXQ_CLASSES; cls++) {
+		if (txq->num[cls] && (txq->ent[cls][txq->head[cls]].clen
+				<= cpswinst->txch[cls].free_num)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Sends queued frames while the tx bd rings have room. Each class fills the
+ * ring of its own TX channel, so a full bulk ring does not hold back the
+ * other classes; the DMA picks the channel to send from.
+ * Only one drain fills the rings at a time, a drain which finds another one
+ * running (the TX interrupt or an output from an ISR which interrupted the
+ * main loop) leaves its frames to that one. The running drain checks the
+ * queue again after it has ended, in case bd's were freed meanwhile.
+ *
+ * @param cpswinst  the instance
+ * @return None
+ */
+static void cpswif_tx_drain(struct cpswinst *cpswinst) {
+	struct txq *txq = &(cpswinst->txq);
+	struct txqent *ent;
+	u32_t cls;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	do {
+		if (txq->busy) {
+			return;
+		}
+
+		txq->busy = 1;
+
+		for (cls = 0; cls < CPSW_TXQ_CLASSES; cls++) {
+			while (txq->num[cls]) {
+				ent = &(txq->ent[cls][txq->head[cls]]);
+
+				if (cpswif_transmit(ent->netif, ent->p, &(cpswinst->txch[cls]))
+						!= ERR_OK) {
+					/* The TX interrupt drains again when bd's are free */
+					cpswinst->tx_stats.ring_full++;
+					break;
+				}
+
+				cpswinst->tx_stats.class_frames[cls]++;
+
+				SYS_ARCH_PROTECT(lev);
+				txq->head[cls] = (txq->head[cls] + 1) % CPSW_TXQ_DEPTH;
+				txq->num[cls]--;
+				SYS_ARCH_UNPROTECT(lev);
+			}
+		}
+
+		txq->busy = 0;
+	} while (cpswif_txq_ready(cpswinst));
+}
+
 /**
  * This function will send a packet through the emac if the channel is
  * available. Otherwise, the packet will be queued in a pbuf queue.
@@ -1699,19 +2521,17 @@ static err_t cpswif_transmit(struct netif *netif, struct pbuf *pbuf) {
  * @param netif   The lwip network interface structure for this ethernetif
  * @param p       The MAC packet to send (e.g. IP packet including
  *                MAC addresses and type)
- * @return        ERR_OK if the packet could be sent
- *                an err_t value if the packet couldn't be sent
+ * @return        ERR_OK if the packet was sent or queued
+ *                ERR_MEM if the queue of its class is full
+ *                ERR_BUF if the packet has more pbufs than tx bd's
  *
  */
 static err_t cpswif_output(struct netif *netif, struct pbuf *p) {
-	err_t stat;
-	SYS_ARCH_DECL_PROTECT(lev);
-
-	/**
-	 * This entire function must run within a "critical section" to preserve
-	 * the integrity of the transmit pbuf queue.
-	 */
-	SYS_ARCH_PROTECT(lev);
+	struct cpswportif *cpswif = netif->state;
+	struct cpswinst *cpswinst = &cpsw_inst_data[cpswif->inst_num];
+	struct txq *txq = &(cpswinst->txq);
+	struct pbuf *q;
+	u32_t cls, queued = 0;
 
 	/**
 	 * Adjust the packet length if less than minimum required.
@@ -1719,28 +2539,48 @@ static err_t cpswif_output(struct netif *netif, struct pbuf *p) {
 	if (p->tot_len < MIN_PKT_LEN) {
 		p->tot_len = MIN_PKT_LEN;
 
-		while (p->next != NULL ) {
-			p->next->tot_len = p->tot_len - p->len;
-			p = p->next;
+		for (q = p; q->next != NULL; q = q->next) {
+			q->next->tot_len = q->tot_len - q->len;
 		}
 
 		/* Adjust the length of the last pbuf. (contents - don't care) */
-		p->len = p->tot_len;
+		q->len = q->tot_len;
+	}
+
+	/* Such a packet would block its queue forever, a class has its own ring */
+	if (pbuf_clen(p) > CPSW_TX_CH_BD_NUM) {
+		cpswinst->tx_stats.drop_chain++;
+		LINK_STATS_INC(link.drop);
+		return ERR_BUF;
 	}
 
+	cls = cpswif_tx_class(p);
+
 	/**
 	 * Bump the reference count on the pbuf to prevent it from being
 	 * freed till we are done with it.
 	 */
 	pbuf_ref(p);
 
-	/* call the actual transmit function */
-	stat = cpswif_transmit(netif, p);
+	if (!cpswif_txq_put(txq, netif, p, cls)) {
+		/* Backpressure, TCP keeps the segment and sends it again later */
+		pbuf_free(p);
+		cpswinst->tx_stats.drop_full[cls]++;
+		LINK_STATS_INC(link.drop);
+		return ERR_MEM;
+	}
+
+	for (cls = 0; cls < CPSW_TXQ_CLASSES; cls++) {
+		queued += txq->num[cls];
+	}
 
-	/* Return to prior interrupt state and return. */
-	SYS_ARCH_UNPROTECT(lev);
+	if (queued > cpswinst->tx_stats.max_queued) {
+		cpswinst->tx_stats.max_queued = queued;
+	}
 
-	return stat;
+	cpswif_tx_drain(cpswinst);
+
+	return ERR_OK;
 }
 
 /**
@@ -1804,13 +2644,10 @@ static err_t cpswif_phylink_config(struct cpswportif * cpswif,
  */
 static err_t cpswif_port_init(struct netif *netif) {
 	struct cpswportif *cpswif = (struct cpswportif*) (netif->state);
-	u32_t temp;
-	err_t err;
-
-#ifdef CPSW_DUAL_MAC_MODE
 	struct cpswinst *cpswinst = &cpsw_inst_data[cpswif->inst_num];
 	u32_t curr_port = cpswif->port_num;
-#endif
+	u32_t temp;
+	err_t err;
 
 	/* set MAC hardware address length */
 	netif->hwaddr_len = ETHARP_HWADDR_LEN;
@@ -1828,29 +2665,27 @@ static err_t cpswif_port_init(struct netif *netif) {
 	netif->flags =
 			NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
 
-#ifdef CPSW_DUAL_MAC_MODE
-	/* Set the ethernet address for the port */
-	CPSWPortSrcAddrSet(cpswinst->port[curr_port - 1].port_base,
-			(u8_t *) (&(cpswif->eth_addr)));
+	if (CPSW_DUAL_MAC(cpswif->inst_num)) {
+		/* Set the ethernet address for the port */
+		CPSWPortSrcAddrSet(cpswinst->port[curr_port - 1].port_base,
+				(u8_t *) (&(cpswif->eth_addr)));
 
-	/**
-	 * For Dual Mac mode, configure port0 and port1 for one VLAN ID;
-	 * port0 and port2 for a different VLAN ID. Here we choose the
-	 * port number as VLAN ID.
-	 */
-	CPSWPortVLANConfig(cpswinst->port[curr_port - 1].port_base, curr_port, 0,
-			0);
-
-	cpswif_port_to_host_vlan_cfg(cpswinst, curr_port,
-			(u8_t *) (&(cpswif->eth_addr)));
-
-	err = cpswif_phylink_config(cpswif, curr_port);
+		/**
+		 * For Dual Mac mode, configure port0 and port1 for one VLAN ID;
+		 * port0 and port2 for a different VLAN ID. Here we choose the
+		 * port number as VLAN ID.
+		 */
+		CPSWPortVLANConfig(cpswinst->port[curr_port - 1].port_base, curr_port,
+				0, 0);
 
-#else
-	err = cpswif_phylink_config(cpswif, 1);
-	err = err & (cpswif_phylink_config(cpswif, 2));
+		cpswif_port_to_host_vlan_cfg(cpswinst, curr_port,
+				(u8_t *) (&(cpswif->eth_addr)));
 
-#endif
+		err = cpswif_phylink_config(cpswif, curr_port);
+	} else {
+		err = cpswif_phylink_config(cpswif, 1);
+		err = err & (cpswif_phylink_config(cpswif, 2));
+	}
 
 	return err;
 }
@@ -1864,69 +2699,183 @@ static err_t cpswif_port_init(struct netif *netif) {
  * @return None
  */
 static void cpswif_cpdma_init(struct cpswinst *cpswinst) {
-	u32_t num_bd;
+	u32_t num_bd, cls, ch;
 	volatile struct cpdma_tx_bd *curr_txbd, *last_txbd;
 	volatile struct cpdma_rx_bd *curr_rxbd, *last_rxbd;
 	struct txch *txch;
 	struct rxch *rxch;
 
-	txch = &(cpswinst->txch);
+#if LWIP_SUPPORT_CUSTOM_PBUF
+	cpswif_rxpool_init(cpswinst);
+#endif
+
+	for (cls = 0; cls < CPSW_TXQ_CLASSES; cls++) {
+		txch = &(cpswinst->txch[cls]);
+		txch->ch = CPSW_TX_CHANNEL(cls);
 
-	/* Initialize the CPDMA memory. Only Channel 0 is supported */
-	txch->free_head = (volatile struct cpdma_tx_bd*) (cpswinst->cppi_ram_base);
-	txch->send_head = txch->free_head;
-	txch->send_tail = NULL;
+		/* The TX rings start at the beginning of the CPPI RAM */
+		txch->free_head = (volatile struct cpdma_tx_bd*) (cpswinst->cppi_ram_base
+				+ (cls * CPSW_TX_CH_BD_NUM * CPDMA_BD_SIZE));
+		txch->send_head = txch->free_head;
+		txch->send_tail = NULL;
+		txch->bd_base = txch->free_head;
 
-	/* Allocate half of the CPPI RAM for TX buffer descriptors */
-	num_bd = (SIZE_CPPI_RAM >> 1) / sizeof(cpdma_tx_bd);
+		num_bd = CPSW_TX_CH_BD_NUM;
 
-	/* All buffer descriptors are free to send */
-	txch->free_num = num_bd;
+		/* All buffer descriptors are free to send */
+		txch->free_num = num_bd;
 
-	curr_txbd = txch->free_head;
+		curr_txbd = txch->free_head;
 
-	/* Initialize all the TX buffer descriptors ring */
-	while (num_bd) {
-		curr_txbd->next = curr_txbd + 1;
-		curr_txbd->flags_pktlen = 0;
-		last_txbd = curr_txbd;
-		curr_txbd = curr_txbd->next;
-		num_bd--;
+		/* Initialize all the TX buffer descriptors ring */
+		while (num_bd) {
+			curr_txbd->next = curr_txbd + 1;
+			curr_txbd->flags_pktlen = 0;
+			last_txbd = curr_txbd;
+			curr_txbd = curr_txbd->next;
+			num_bd--;
+		}
+		last_txbd->next = txch->free_head;
 	}
-	last_txbd->next = txch->free_head;
 
-	/* Initialize the descriptors for the RX channel */
-	rxch = &(cpswinst->rxch);
-	rxch->free_head = (volatile struct cpdma_rx_bd*) (cpswinst->cppi_ram_base
-			+ (SIZE_CPPI_RAM >> 1));
+	for (ch = 0; ch < CPSW_RX_CH_NUM; ch++) {
+		/* Initialize the descriptors for the RX channel */
+		rxch = &(cpswinst->rxch[ch]);
+		rxch->ch = ch;
+
+		/* The RX rings follow on the next cache line */
+		rxch->free_head = (volatile struct cpdma_rx_bd*) (cpswinst->cppi_ram_base
+				+ CPSW_RX_BD_OFFSET + (ch * CPSW_RX_CH_BD_NUM * CPDMA_BD_SIZE));
+		rxch->bd_base = rxch->free_head;
+
+		num_bd = CPSW_RX_CH_BD_NUM;
+		rxch->free_num = num_bd;
+
+		curr_rxbd = rxch->free_head;
+
+		/* Create the rx ring of buffer descriptors */
+		while (num_bd) {
+			curr_rxbd->next = curr_rxbd + 1;
+			curr_rxbd->flags_pktlen = CPDMA_BUF_DESC_OWNER;
+			last_rxbd = curr_rxbd;
+			curr_rxbd = curr_rxbd->next;
+			num_bd--;
+		}
 
-	/* Allocate half of the CPPI RAM available for RX buffer dscriptors */
-	num_bd = (SIZE_CPPI_RAM >> 1) / sizeof(cpdma_rx_bd);
-	rxch->free_num = num_bd;
+		last_rxbd->next = rxch->free_head;
 
-	curr_rxbd = rxch->free_head;
+		/* We are going to receive starting from the free head */
+		rxch->recv_head = rxch->free_head;
+		rxch->recv_tail = last_rxbd;
 
-	/* Create the rx ring of buffer descriptors */
-	while (num_bd) {
-		curr_rxbd->next = curr_rxbd + 1;
-		curr_rxbd->flags_pktlen = CPDMA_BUF_DESC_OWNER;
-		last_rxbd = curr_rxbd;
-		curr_rxbd = curr_rxbd->next;
-		num_bd--;
+		cpswif_rxbd_alloc(cpswinst, rxch);
+
+		/* close the ring */
+		last_rxbd->next = NULL;
+
+		CPSWCPDMARxHdrDescPtrWrite(cpswinst->cpdma_base,
+				(u32_t) (rxch->recv_head), ch);
 	}
+}
 
-	last_rxbd->next = rxch->free_head;
+/**
+ * Limits an interrupts per ms value to the range of the wrapper
+ *
+ * @param per_ms     interrupts per ms, 0 for no pacing
+ * @return the value written to the IMAX register, 0 for no pacing
+ */
+static u32_t cpswif_pacing_clamp(u32_t per_ms) {
+	if (per_ms == 0) {
+		return 0;
+	}
 
-	/* We are going to receive starting from the free head */
-	rxch->recv_head = rxch->free_head;
-	rxch->recv_tail = last_rxbd;
-	cpswif_rxbd_alloc(cpswinst);
+	if (per_ms < CPSW_INT_PER_MS_MIN) {
+		return CPSW_INT_PER_MS_MIN;
+	}
 
-	/* close the ring */
-	last_rxbd->next = NULL;
+	if (per_ms > CPSW_INT_PER_MS_MAX) {
+		return CPSW_INT_PER_MS_MAX;
+	}
 
-	CPSWCPDMARxHdrDescPtrWrite(cpswinst->cpdma_base, (u32_t) (rxch->recv_head),
-			0);
+	return per_ms;
+}
+
+/**
+ * Writes the pacing state of an instance to the wrapper. Called from the RX
+ * interrupt (adaptive mode) and from the main loop, so the read-modify-write
+ * of INT_CONTROL runs with interrupts disabled.
+ *
+ * @param cpswinst   The CPSW instance structure pointer
+ * @return None
+ */
+static void cpswif_pacing_apply(struct cpswinst *cpswinst) {
+	struct pacing *pacing = &(cpswinst->pacing);
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	if (pacing->rx_per_ms) {
+		CPSWWrRxIntMaxSet(cpswinst->wrpr_base, 0, pacing->rx_per_ms);
+		CPSWWrIntPacingEnable(cpswinst->wrpr_base, CPSW_INT_PACING_C0_RX_PULSE);
+	} else {
+		CPSWWrIntPacingDisable(cpswinst->wrpr_base,
+				CPSW_INT_PACING_C0_RX_PULSE);
+	}
+
+	if (pacing->tx_per_ms) {
+		CPSWWrTxIntMaxSet(cpswinst->wrpr_base, 0, pacing->tx_per_ms);
+		CPSWWrIntPacingEnable(cpswinst->wrpr_base, CPSW_INT_PACING_C0_TX_PULSE);
+	} else {
+		CPSWWrIntPacingDisable(cpswinst->wrpr_base,
+				CPSW_INT_PACING_C0_TX_PULSE);
+	}
+
+	cpswinst->rx_stats.int_per_ms = pacing->rx_per_ms;
+	SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Adaptive pacing. Counts the received frames and, once per window,
+ * derives the RX interrupt limit from the frame rate. Runs in the RX path,
+ * so after an idle period the new limit is chosen by the first interrupt.
+ *
+ * @param cpswinst   The CPSW instance structure pointer
+ * @param frames     frames received since the last call
+ * @return None
+ */
+static void cpswif_pacing_update(struct cpswinst *cpswinst, u32_t frames) {
+	struct pacing *pacing = &(cpswinst->pacing);
+	u32_t now, us, rate, per_ms;
+
+	if (!pacing->adaptive) {
+		return;
+	}
+
+	pacing->win_frames += frames;
+
+	now = WatchCycleCountGet();
+	us = WatchCyclesToUs(now - pacing->win_start);
+
+	if (us < CPSW_PACING_WINDOW_US) {
+		return;
+	}
+
+	/* Frames per ms in the window */
+	rate = (pacing->win_frames * 1000) / us;
+
+	if (rate <= CPSW_PACING_IDLE_RATE) {
+		per_ms = 0;
+	} else {
+		per_ms = cpswif_pacing_clamp(rate / CPSW_PACING_BATCH);
+	}
+
+	pacing->win_start = now;
+	pacing->win_frames = 0;
+
+	if (per_ms != pacing->rx_per_ms) {
+		pacing->rx_per_ms = per_ms;
+		cpswif_pacing_apply(cpswinst);
+		cpswinst->rx_stats.pacing_changes++;
+	}
 }
 
 /**
@@ -1939,6 +2888,8 @@ static void cpswif_cpdma_init(struct cpswinst *cpswinst) {
 static void cpswif_inst_init(struct cpswportif *cpswif) {
 	u32_t inst_num = cpswif->inst_num;
 	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+	u8_t bcast_addr[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+	u32_t ch, rx_ch_map = 0;
 
 	/* Reset the different modules */
 	CPSWSSReset(cpswinst->ss_base);
@@ -1952,36 +2903,54 @@ static void cpswif_inst_init(struct cpswportif *cpswif) {
 	delay(1);
 
 	CPSWALEInit(cpswinst->ale_base);
+	cpswif_ale_shadow_load(cpswinst, FALSE);
 
 	/* Set the port 0, 1 and 2 states to FORWARD */
 	CPSWALEPortStateSet(cpswinst->ale_base, 0, CPSW_ALE_PORT_STATE_FWD);
 	CPSWALEPortStateSet(cpswinst->ale_base, 1, CPSW_ALE_PORT_STATE_FWD);
 	CPSWALEPortStateSet(cpswinst->ale_base, 2, CPSW_ALE_PORT_STATE_FWD);
 
-#ifdef CPSW_DUAL_MAC_MODE
-	/* For Dual Mac Mode, Configure for VLAN Aware Mode */
-	CPSWALEVLANAwareSet(cpswinst->ale_base);
-	CPSWHostPortDualMacModeSet(cpswinst->host_port_base);
+	if (CPSW_DUAL_MAC(inst_num)) {
+		/**
+		 * For Dual Mac Mode, Configure for VLAN Aware Mode. The ports and
+		 * their ALE entries are set up by cpswif_port_init.
+		 */
+		CPSWALEVLANAwareSet(cpswinst->ale_base);
+		CPSWHostPortDualMacModeSet(cpswinst->host_port_base);
+	} else {
+		/* For normal CPSW switch mode, set multicast entry. */
+		cpswif_ale_multicastentry_set(cpswinst,
+				PORT_0_MASK | PORT_1_MASK | PORT_2_MASK,
+				bcast_addr);
+		cpswif_ale_unicastentry_set(cpswinst, 0,
+				(u8_t *)(&(cpswif->eth_addr)));
+
+		/* Set the ethernet address for both the ports */
+		CPSWPortSrcAddrSet(cpswinst->port[0].port_base,
+				(u8_t *)(&(cpswif->eth_addr)));
+		CPSWPortSrcAddrSet(cpswinst->port[1].port_base,
+				(u8_t *)(&(cpswif->eth_addr)));
+	}
 
-#else  /*CPSW_DUAL_MAC_MODE */
-	/* For normal CPSW switch mode, set multicast entry. */
-	u8_t bcast_addr[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-	cpswif_ale_multicastentry_set(cpswinst,
-			PORT_0_MASK | PORT_1_MASK | PORT_2_MASK,
-			bcast_addr);
-	cpswif_ale_unicastentry_set(cpswinst, 0,
-			(u8_t *)(&(cpswif->eth_addr)));
+	/* Enable the statistics. Lets see in case we come across any issues */
+	CPSWStatisticsEnable(cpswinst->ss_base);
 
-	/* Set the ethernet address for both the ports */
-	CPSWPortSrcAddrSet(cpswinst->port[0].port_base,
-			(u8_t *)(&(cpswif->eth_addr)));
-	CPSWPortSrcAddrSet(cpswinst->port[1].port_base,
-			(u8_t *)(&(cpswif->eth_addr)));
+	/* Time base of the receive path counters */
+	WatchCycleCounterInit();
 
-#endif /*CPSW_DUAL_MAC_MODE */
+	/* Priority of the TX channels */
+	CPSWCPDMAConfig(cpswinst->cpdma_base, CPDMA_CFG(0,
+			CPDMA_CFG_NO_COPY_ERR_FRAMES, CPDMA_CFG_IDLE_COMMAND_NONE,
+			CPDMA_CFG_NOT_BLOCK_RX_OFF_LEN_WRITE, CPDMA_CFG_RX_OWN_0,
+			CPSW_TX_PRIO));
 
-	/* Enable the statistics. Lets see in case we come across any issues */
-	CPSWStatisticsEnable(cpswinst->ss_base);
+	/* RX channel of each switch priority of both slave ports */
+	for (ch = 0; ch < 4; ch++) {
+		rx_ch_map |= CPSW_RX_CH_MAP(1, ch, CPSW_RX_CHANNEL(ch))
+				| CPSW_RX_CH_MAP(2, ch, CPSW_RX_CHANNEL(ch));
+	}
+
+	CPSWHostPortRxChMapSet(cpswinst->host_port_base, rx_ch_map);
 
 	/* Initialize the buffer descriptors for CPDMA */
 	cpswif_cpdma_init(cpswinst);
@@ -1994,12 +2963,63 @@ static void cpswif_inst_init(struct cpswportif *cpswif) {
 	CPSWCPDMATxEnable(cpswinst->cpdma_base);
 	CPSWCPDMARxEnable(cpswinst->cpdma_base);
 
-	/* Enable the interrupts for channel 0 and for control core 0 */
-	CPSWCPDMATxIntEnable(cpswinst->cpdma_base, 0);
-	CPSWWrCoreIntEnable(cpswinst->wrpr_base, 0, 0, CPSW_CORE_INT_TX_PULSE);
+	/* Enable the interrupts for all channels and for control core 0 */
+	for (ch = 0; ch < CPSW_TXQ_CLASSES; ch++) {
+		CPSWCPDMATxIntEnable(cpswinst->cpdma_base, ch);
+		CPSWWrCoreIntEnable(cpswinst->wrpr_base, 0, ch, CPSW_CORE_INT_TX_PULSE);
+	}
+
+	for (ch = 0; ch < CPSW_RX_CH_NUM; ch++) {
+		CPSWCPDMARxIntEnable(cpswinst->cpdma_base, ch);
+		CPSWWrCoreIntEnable(cpswinst->wrpr_base, 0, ch, CPSW_CORE_INT_RX_PULSE);
+	}
+
+	/* Interrupt pacing counts in steps of 4us */
+	CPSWWrPrescaleSet(cpswinst->wrpr_base, CPSW_INT_PRESCALE);
+
+	cpswinst->pacing.rx_per_ms = cpswif_pacing_clamp(CPSW_INT_PACING_RX);
+	cpswinst->pacing.tx_per_ms = cpswif_pacing_clamp(CPSW_INT_PACING_TX);
+
+#ifdef CPSW_INT_PACING_ADAPTIVE
+	cpswinst->pacing.adaptive = 1;
+	cpswinst->pacing.win_start = WatchCycleCountGet();
+#endif
+
+	cpswif_pacing_apply(cpswinst);
+}
+
+/**
+ * Selects dual MAC mode for an instance. Each slave port is then a netif of
+ * its own with its own MAC and IP address, the ports are separated by their
+ * port VLAN. Otherwise both ports switch the traffic of one netif. Must be
+ * called before the first netif of the instance is initialized.
+ *
+ * @param inst_num   the instance number
+ * @param enable     non-zero for dual MAC mode, 0 for switch mode
+ * @return None
+ */
+void cpswif_dual_mac_set(u32_t inst_num, u32_t enable) {
+	if (enable) {
+		cpsw_dual_mac |= (1 << inst_num);
+	} else {
+		cpsw_dual_mac &= ~(1 << inst_num);
+	}
+}
+
+/**
+ * Gives the index of the netif of a slave port in the array of netifs. In
+ * switch mode, both ports share the netif of port 1.
+ *
+ * @param inst_num   the instance number
+ * @param port_num   the slave port number
+ * @return the index of the netif
+ */
+u32_t cpswif_if_num(u32_t inst_num, u32_t port_num) {
+	if (CPSW_DUAL_MAC(inst_num)) {
+		return (inst_num * MAX_SLAVEPORT_PER_INST) + port_num - 1;
+	}
 
-	CPSWCPDMARxIntEnable(cpswinst->cpdma_base, 0);
-	CPSWWrCoreIntEnable(cpswinst->wrpr_base, 0, 0, CPSW_CORE_INT_RX_PULSE);
+	return inst_num * MAX_SLAVEPORT_PER_INST;
 }
 
 /**
@@ -2029,12 +3049,7 @@ err_t cpswif_init(struct netif *netif) {
 	NETIF_INIT_SNMP(netif, snmp_ifType_ethernet_csmacd, 10000000);
 
 	/* let us use the interface number to identify netif */
-#ifdef CPSW_DUAL_MAC_MODE
-	netif->num = (u8_t) (((cpswif->inst_num * MAX_SLAVEPORT_PER_INST)
-			+ cpswif->port_num - 1) & 0xFF);
-#else
-	netif->num = (u8_t)(cpswif->inst_num);
-#endif
+	netif->num = (u8_t) (cpswif_if_num(inst_num, cpswif->port_num) & 0xFF);
 
 	/**
 	 * We directly use etharp_output() here to save a function call.
@@ -2063,26 +3078,38 @@ err_t cpswif_init(struct netif *netif) {
 }
 
 /**
- * Handler for Receive interrupt. Packet processing is done in this
- * interrupt handler itself.
+ * Counts the rx bd's of an instance which are not armed with a buffer
  *
- * @param inst_num   the instance for which interrupt was generated
+ * @param cpswinst   The CPSW instance structure pointer
+ * @return the number of unarmed bd's of all rx channels
+ */
+static u32_t cpswif_rx_unarmed(struct cpswinst *cpswinst) {
+	u32_t ch, num = 0;
+
+	for (ch = 0; ch < CPSW_RX_CH_NUM; ch++) {
+		num += cpswinst->rxch[ch].free_num;
+	}
+
+	return num;
+}
+
+/**
+ * Passes up to budget received frames of an rx channel to lwIP and gives
+ * their buffer descriptors back to the free list. The descriptors are not
+ * refilled here.
+ *
+ * @param inst_num   the instance to process
+ * @param rxch       the rx channel to process
  * @param netif_arr  the address of the array of netifs
- * @return none
+ * @param budget     maximum number of frames to process
+ * @return the number of frames processed
  */
-void cpswif_rx_inthandler(u32_t inst_num, struct netif * netif_arr) {
+static u32_t cpswif_rx_ch_process(u32_t inst_num, struct rxch *rxch,
+		struct netif * netif_arr, u32_t budget) {
 	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
-	struct rxch *rxch;
 	volatile struct cpdma_rx_bd *curr_bd;
 	volatile struct pbuf *pbuf;
-	u32_t tot_len, if_num;
-
-#ifdef CPSW_DUAL_MAC_MODE
-	u32_t from_port;
-#endif
-
-	/* Get the rx channel pointer */
-	rxch = &(cpswinst->rxch);
+	u32_t tot_len, from_port, frames = 0;
 
 	/* Get the bd which contains the earliest filled data */
 	curr_bd = rxch->recv_head;
@@ -2091,10 +3118,9 @@ void cpswif_rx_inthandler(u32_t inst_num, struct netif * netif_arr) {
 	 * Process the receive buffer descriptors. When the DMA completes
 	 * reception, OWNERSHIP flag will be cleared.
 	 */
-	while ((curr_bd->flags_pktlen & CPDMA_BUF_DESC_OWNER)
-			!= CPDMA_BUF_DESC_OWNER) {
+	while ((frames < budget) && ((curr_bd->flags_pktlen & CPDMA_BUF_DESC_OWNER)
+			!= CPDMA_BUF_DESC_OWNER)) {
 
-#ifdef CPSW_DUAL_MAC_MODE
 		/**
 		 * From which slave port the packet came from ?
 		 * We will use this to decide to which netif the packet
@@ -2102,19 +3128,26 @@ void cpswif_rx_inthandler(u32_t inst_num, struct netif * netif_arr) {
 		 */
 		from_port = ((curr_bd->flags_pktlen) & CPDMA_BUF_DESC_FROM_PORT)
 				>> CPDMA_BUF_DESC_FROM_PORT_SHIFT;
-#endif
+
+		if ((from_port - 1) >= MAX_SLAVEPORT_PER_INST) {
+			from_port = 1;
+		}
 
 		/* Get the total length of the packet */
 		tot_len = (curr_bd->flags_pktlen) & CPDMA_BD_PKTLEN_MASK;
 
 		/* Get the pbuf which is associated with the current bd */
-		pbuf = curr_bd->pbuf;
+		pbuf = rxch->pbuf[BD_SLOT(rxch, curr_bd)];
 #ifdef LWIP_CACHE_ENABLED
 		/**
 		 * Invalidate the cache lines of the pbuf including payload. Because
 		 * the memory contents got changed by DMA.
 		 */
+#if LWIP_SUPPORT_CUSTOM_PBUF
+		CacheDataInvalidateBuff((u32_t)(pbuf->payload), CPSW_RX_BUF_SIZE);
+#else
 		CacheDataInvalidateBuff((u32_t)pbuf, (PBUF_LEN_MAX + SIZEOF_STRUCT_PBUF));
+#endif
 #endif
 
 		/* Update the len and tot_len fields for the pbuf in the chain */
@@ -2125,27 +3158,38 @@ void cpswif_rx_inthandler(u32_t inst_num, struct netif * netif_arr) {
 
 		/* Adjust the link statistics */
 		LINK_STATS_INC(link.recv);
+		cpswinst->port[from_port - 1].stats.rx_frames++;
+		cpswinst->port[from_port - 1].stats.rx_octets += tot_len;
 
-#ifdef CPSW_DUAL_MAC_MODE
-		if_num = (inst_num * MAX_SLAVEPORT_PER_INST) + from_port - 1;
-#else
-		if_num = inst_num;
+#if LWIP_SUPPORT_CUSTOM_PBUF
+		/**
+		 * Every unarmed bd, this one included, needs a buffer of the pool.
+		 * If lwIP holds the spare buffers, the frame is dropped and its
+		 * buffer reused, so the ring never runs dry.
+		 */
+		if (cpswinst->rxpool.free_num < (cpswif_rx_unarmed(cpswinst) + 1)) {
+			pbuf_free((struct pbuf *) pbuf);
+			cpswinst->rxpool.drops++;
+			LINK_STATS_INC(link.drop);
+		} else
 #endif
-
 		/* Process the packet */
-		if (ethernet_input((struct pbuf *) pbuf, netif_arr + if_num) != ERR_OK) {
+		if (ethernet_input((struct pbuf *) pbuf,
+				netif_arr + cpswif_if_num(inst_num, from_port)) != ERR_OK) {
 			/* Adjust the link statistics */
 			LINK_STATS_INC(link.memerr);
 			LINK_STATS_INC(link.drop);
 		}
 
 		/* Acknowledge that this packet is processed */
-		CPSWCPDMARxCPWrite(cpswinst->cpdma_base, 0, (unsigned int) curr_bd);
+		CPSWCPDMARxCPWrite(cpswinst->cpdma_base, rxch->ch,
+				(unsigned int) curr_bd);
 
 		curr_bd = curr_bd->next;
 
 		/* One more buffer descriptor is free now */
 		rxch->free_num++;
+		frames++;
 
 		/**
 		 * If the DMA engine took the NULL pointer, we dont have any bd to
@@ -2158,44 +3202,336 @@ void cpswif_rx_inthandler(u32_t inst_num, struct netif * netif_arr) {
 		rxch->recv_head = curr_bd;
 	}
 
+	return frames;
+}
+
+/**
+ * Passes up to budget received frames to lwIP, the rx channels of higher
+ * priority first.
+ *
+ * @param inst_num   the instance to process
+ * @param netif_arr  the address of the array of netifs
+ * @param budget     maximum number of frames to process
+ * @return the number of frames processed
+ */
+static u32_t cpswif_rx_process(u32_t inst_num, struct netif * netif_arr,
+		u32_t budget) {
+	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+	u32_t ch = CPSW_RX_CH_NUM, frames = 0, done;
+
+	while (ch--) {
+		done = cpswif_rx_ch_process(inst_num, &(cpswinst->rxch[ch]), netif_arr,
+				budget - frames);
+		cpswinst->rx_stats.ch_frames[ch] += done;
+		frames += done;
+	}
+
+	return frames;
+}
+
+/**
+ * Refills the rx bd's of all rx channels
+ *
+ * @param cpswinst   The CPSW instance structure pointer
+ * @return None
+ */
+static void cpswif_rx_refill(struct cpswinst *cpswinst) {
+	u32_t ch;
+
+	for (ch = 0; ch < CPSW_RX_CH_NUM; ch++) {
+		if (cpswinst->rxch[ch].free_num) {
+			cpswif_rxbd_alloc(cpswinst, &(cpswinst->rxch[ch]));
+		}
+	}
+}
+
+/**
+ * Checks if an rx ring holds a received frame not processed yet
+ *
+ * @param cpswinst   The CPSW instance structure pointer
+ * @return non-zero if a frame is waiting
+ */
+static u32_t cpswif_rx_pending(struct cpswinst *cpswinst) {
+	u32_t ch;
+
+	for (ch = 0; ch < CPSW_RX_CH_NUM; ch++) {
+		if ((cpswinst->rxch[ch].recv_head->flags_pktlen & CPDMA_BUF_DESC_OWNER)
+				!= CPDMA_BUF_DESC_OWNER) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Updates the frame counters after a run of cpswif_rx_process
+ *
+ * @param cpswinst   The CPSW instance structure pointer
+ * @param frames     frames processed by the run
+ * @param start      cycle count at the start of the run
+ * @return None
+ */
+static void cpswif_rx_account(struct cpswinst *cpswinst, u32_t frames,
+		u32_t start) {
+	struct cpswif_rx_stats *st = &(cpswinst->rx_stats);
+	u32_t cycles = WatchCycleCountGet() - start;
+
+	st->frames += frames;
+	st->cycles += cycles;
+
+	cpswif_pacing_update(cpswinst, frames);
+
+	if (frames > st->max_burst) {
+		st->max_burst = frames;
+	}
+
+	if (cycles > st->max_cycles) {
+		st->max_cycles = cycles;
+	}
+}
+
+/**
+ * Handler for Receive interrupt. Without CPSW_RX_POLL_MODE all received
+ * packets are processed in this interrupt handler itself. With
+ * CPSW_RX_POLL_MODE the handler masks the RX interrupt and leaves the ring
+ * to cpswif_rx_poll.
+ *
+ * @param inst_num   the instance for which interrupt was generated
+ * @param netif_arr  the address of the array of netifs
+ * @return none
+ */
+void cpswif_rx_inthandler(u32_t inst_num, struct netif * netif_arr) {
+	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+
+#ifdef CPSW_RX_POLL_MODE
+	u32_t ch;
+#else
+	u32_t start = WatchCycleCountGet();
+#endif
+
+	cpswinst->rx_stats.irqs++;
+
+#ifdef CPSW_RX_POLL_MODE
+	/* No more RX interrupts until the rings are drained by the poll */
+	for (ch = 0; ch < CPSW_RX_CH_NUM; ch++) {
+		CPSWCPDMARxIntDisable(cpswinst->cpdma_base, ch);
+	}
+	cpswinst->rx_polling = 1;
+
+	CPSWCPDMAEndOfIntVectorWrite(cpswinst->cpdma_base, CPSW_EOI_RX_PULSE);
+#else
+	cpswif_rx_account(cpswinst,
+			cpswif_rx_process(inst_num, netif_arr, 0xFFFFFFFF), start);
+
 	CPSWCPDMAEndOfIntVectorWrite(cpswinst->cpdma_base, CPSW_EOI_RX_PULSE);
 
 	/* We got some bd's freed; Allocate them */
-	cpswif_rxbd_alloc(cpswinst);
+	cpswif_rx_refill(cpswinst);
+#endif
 }
 
 /**
- * Handler for CPSW Transmit interrupt
+ * Receive poll for CPSW_RX_POLL_MODE, to be called from the main loop.
+ * Processes up to CPSW_RX_BUDGET frames after an RX interrupt and unmasks
+ * the RX interrupt again once the ring is drained.
  *
- * @param netif the lwip network interface structure for this ethernetif
- * @return none
+ * @param inst_num   the instance to poll
+ * @param netif_arr  the address of the array of netifs
+ * @return the number of frames processed
  */
-void cpswif_tx_inthandler(u32_t inst_num) {
-	struct txch *txch;
+u32_t cpswif_rx_poll(u32_t inst_num, struct netif * netif_arr) {
 	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
-	volatile struct cpdma_tx_bd *curr_bd, *send_head;
-	volatile u32_t cnt = 0xFFFF;
+	u32_t start, frames, ch;
 
-	txch = &(cpswinst->txch);
+	if (!cpswinst->rx_polling) {
+		return 0;
+	}
 
-	send_head = txch->send_head;
+	start = WatchCycleCountGet();
+	frames = cpswif_rx_process(inst_num, netif_arr, CPSW_RX_BUDGET);
 
-	curr_bd = send_head;
+	/* We got some bd's freed; Allocate them */
+	cpswif_rx_refill(cpswinst);
 
-	/* Check for correct start of packet */
-	while ((curr_bd->flags_pktlen) & CPDMA_BUF_DESC_SOP) {
+	cpswif_rx_account(cpswinst, frames, start);
+	cpswinst->rx_stats.polls++;
 
-		/* Make sure that the transmission is over */
-		while (((curr_bd->flags_pktlen & CPDMA_BUF_DESC_OWNER)
-				== CPDMA_BUF_DESC_OWNER) && ((--cnt) != 0))
-			;
+	if (cpswif_rx_pending(cpswinst)) {
+		/* Budget used up, the rest waits for the next poll */
+		cpswinst->rx_stats.budget_hits++;
+		return frames;
+	}
 
-		/* If CPDMA failed to transmit, give it a chance once more */
-		if (0 == cnt) {
-			CPSWCPDMATxHdrDescPtrWrite(cpswinst->cpdma_base, (u32_t) (curr_bd),
-					0);
-			return;
-		}
+	cpswinst->rx_polling = 0;
+
+	for (ch = 0; ch < CPSW_RX_CH_NUM; ch++) {
+		CPSWCPDMARxIntEnable(cpswinst->cpdma_base, ch);
+	}
+
+	/* A frame completed meanwhile raises the interrupt again */
+	CPSWCPDMAEndOfIntVectorWrite(cpswinst->cpdma_base, CPSW_EOI_RX_PULSE);
+
+	return frames;
+}
+
+/**
+ * Gets the receive path counters of an instance
+ *
+ * @param inst_num   the instance number
+ * @param stats      filled with the counters
+ * @return None
+ */
+void cpswif_rx_stats_get(u32_t inst_num, struct cpswif_rx_stats *stats) {
+	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+
+	*stats = cpswinst->rx_stats;
+
+#if LWIP_SUPPORT_CUSTOM_PBUF
+	stats->pool_free = cpswinst->rxpool.free_num;
+	stats->pool_low = cpswinst->rxpool.low_mark;
+	stats->pool_drops = cpswinst->rxpool.drops;
+#endif
+}
+
+/**
+ * Restarts the largest burst and the longest ISR/poll of the receive path
+ * counters, so they cover a measurement only
+ *
+ * @param inst_num   the instance number
+ * @return None
+ */
+void cpswif_rx_stats_max_reset(u32_t inst_num) {
+	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	cpswinst->rx_stats.max_burst = 0;
+	cpswinst->rx_stats.max_cycles = 0;
+	SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Gets the ALE table counters of an instance
+ *
+ * @param inst_num   the instance number
+ * @param stats      filled with the counters
+ * @return None
+ */
+void cpswif_ale_stats_get(u32_t inst_num, struct cpswif_ale_stats *stats) {
+	*stats = cpsw_inst_data[inst_num].ale_stats;
+}
+
+/**
+ * Gets the transmit path counters of an instance
+ *
+ * @param inst_num   the instance number
+ * @param stats      filled with the counters
+ * @return None
+ */
+void cpswif_tx_stats_get(u32_t inst_num, struct cpswif_tx_stats *stats) {
+	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+	u32_t cls;
+
+	*stats = cpswinst->tx_stats;
+
+	stats->queued = 0;
+
+	for (cls = 0; cls < CPSW_TXQ_CLASSES; cls++) {
+		stats->queued += cpswinst->txq.num[cls];
+	}
+}
+
+/**
+ * Gets the counters of a slave port. The frames are counted from the buffer
+ * descriptors, the hw_ counters are read from the statistics of the CPSW,
+ * which sums up the host and both slave ports.
+ *
+ * @param inst_num   the instance number
+ * @param port_num   the slave port number, 1..MAX_SLAVEPORT_PER_INST
+ * @param stats      filled with the counters, all 0 for an invalid port
+ * @return None
+ */
+void cpswif_port_stats_get(u32_t inst_num, u32_t port_num,
+		struct cpswif_port_stats *stats) {
+	static const struct cpswif_port_stats none;
+	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+
+	if ((port_num < 1) || (port_num > MAX_SLAVEPORT_PER_INST)) {
+		*stats = none;
+		return;
+	}
+
+	*stats = cpswinst->port[port_num - 1].stats;
+
+	stats->hw_rx_frames = CPSWStatisticsGet(cpswinst->stat_base,
+			CPSW_STAT_RX_GOOD_FRAMES);
+	stats->hw_rx_octets = CPSWStatisticsGet(cpswinst->stat_base,
+			CPSW_STAT_RX_OCTETS);
+	stats->hw_tx_frames = CPSWStatisticsGet(cpswinst->stat_base,
+			CPSW_STAT_TX_GOOD_FRAMES);
+	stats->hw_tx_octets = CPSWStatisticsGet(cpswinst->stat_base,
+			CPSW_STAT_TX_OCTETS);
+}
+
+/**
+ * Sets fixed interrupt pacing for an instance and ends the adaptive mode.
+ * The values are clamped to the range of the wrapper.
+ *
+ * @param inst_num   the instance number
+ * @param rx_per_ms  RX interrupts per ms, 0 for an interrupt per packet
+ * @param tx_per_ms  TX interrupts per ms, 0 for an interrupt per packet
+ * @return None
+ */
+void cpswif_int_pacing_set(u32_t inst_num, u32_t rx_per_ms, u32_t tx_per_ms) {
+	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+
+	cpswinst->pacing.adaptive = 0;
+	cpswinst->pacing.rx_per_ms = cpswif_pacing_clamp(rx_per_ms);
+	cpswinst->pacing.tx_per_ms = cpswif_pacing_clamp(tx_per_ms);
+
+	cpswif_pacing_apply(cpswinst);
+}
+
+/**
+ * Starts or ends the adaptive RX interrupt pacing of an instance. The TX
+ * limit keeps its value.
+ *
+ * @param inst_num   the instance number
+ * @param enable     non-zero to let the RX path choose the RX limit
+ * @return None
+ */
+void cpswif_int_pacing_adaptive(u32_t inst_num, u32_t enable) {
+	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+
+	cpswinst->pacing.win_start = WatchCycleCountGet();
+	cpswinst->pacing.win_frames = 0;
+	cpswinst->pacing.adaptive = enable;
+}
+
+/**
+ * Reclaims the packets of a tx channel which the DMA is done with, that is
+ * up to the first SOP bd still owned by the DMA, and acknowledges them with
+ * one completion pointer write. Never waits for the DMA.
+ *
+ * @param cpswinst   the instance
+ * @param txch       the tx channel
+ * @return the number of packets reclaimed
+ */
+static u32_t cpswif_tx_reclaim(struct cpswinst *cpswinst, struct txch *txch) {
+	volatile struct cpdma_tx_bd *curr_bd, *last_bd = NULL;
+	u32_t done = 0;
+
+	curr_bd = txch->send_head;
+
+	/**
+	 * The DMA clears the OWNER flag of the SOP bd when the packet is sent.
+	 * Stop at the first packet which is not done yet.
+	 */
+	while (((curr_bd->flags_pktlen) & CPDMA_BUF_DESC_SOP)
+			&& !((curr_bd->flags_pktlen) & CPDMA_BUF_DESC_OWNER)) {
+
+		curr_bd->flags_pktlen &= ~(CPDMA_BUF_DESC_SOP);
 
 		/* One buffer descriptor is free now */
 		txch->free_num++;
@@ -2208,14 +3544,19 @@ void cpswif_tx_inthandler(u32_t inst_num) {
 			/* As this bd is not the end, its free now */
 			txch->free_num++;
 
-			if (txch->free_num == (SIZE_CPPI_RAM >> 1) / sizeof(cpdma_tx_bd)) {
+			if (txch->free_num == CPSW_TX_CH_BD_NUM) {
 				break;
 			}
 		}
 
-		send_head->flags_pktlen &= ~(CPDMA_BUF_DESC_SOP);
 		curr_bd->flags_pktlen &= ~(CPDMA_BUF_DESC_EOP);
 
+		pbuf_free(txch->pbuf[BD_SLOT(txch, curr_bd)]);
+		LINK_STATS_INC(link.xmit);
+		done++;
+
+		last_bd = curr_bd;
+
 		/**
 		 * If there are no more data transmitted, the next interrupt
 		 * shall happen with the pbuf associated with the free_head
@@ -2226,19 +3567,67 @@ void cpswif_tx_inthandler(u32_t inst_num) {
 			txch->send_head = curr_bd->next;
 		}
 
-		/* Acknowledge CPSW and free the corresponding pbuf */
-		CPSWCPDMATxCPWrite(cpswinst->cpdma_base, 0, (u32_t) curr_bd);
+		curr_bd = txch->send_head;
+	}
 
-		pbuf_free((struct pbuf *) curr_bd->pbuf);
+	if (last_bd != NULL) {
+		/* Acknowledge all reclaimed packets at once */
+		CPSWCPDMATxCPWrite(cpswinst->cpdma_base, txch->ch, (u32_t) last_bd);
 
-		LINK_STATS_INC(link.xmit);
+		/**
+		 * EOQ is still set if the DMA took the NULL pointer after
+		 * cpswif_transmit chained the next packet and checked the flag.
+		 * That packet would never be sent, restart the DMA with it.
+		 */
+		if ((last_bd->flags_pktlen & CPDMA_BUF_DESC_EOQ)
+				&& (last_bd->next != NULL)
+				&& (txch->send_head->flags_pktlen & CPDMA_BUF_DESC_OWNER)) {
+			CPSWCPDMATxHdrDescPtrWrite(cpswinst->cpdma_base,
+					(u32_t) (txch->send_head), txch->ch);
+			cpswinst->tx_stats.restarts++;
+		}
+	}
+
+	return done;
+}
+
+/**
+ * Handler for CPSW Transmit interrupt. Reclaims the sent packets of all tx
+ * channels and refills the rings from the transmit queue.
+ *
+ * @param inst_num   the instance for which interrupt was generated
+ * @return none
+ */
+void cpswif_tx_inthandler(u32_t inst_num) {
+	struct cpswinst *cpswinst = &cpsw_inst_data[inst_num];
+	u32_t start = WatchCycleCountGet();
+	u32_t cycles, cls, done = 0;
 
-		send_head = txch->send_head;
-		curr_bd = send_head;
+	for (cls = 0; cls < CPSW_TXQ_CLASSES; cls++) {
+		done += cpswif_tx_reclaim(cpswinst, &(cpswinst->txch[cls]));
 	}
 
 	CPSWCPDMAEndOfIntVectorWrite(cpswinst->cpdma_base, CPSW_EOI_TX_PULSE);
-	cpswif_rxbd_alloc(cpswinst);
+
+	/* Refill the rings from the transmit queue */
+	if (done) {
+		cpswif_tx_drain(cpswinst);
+	}
+
+	cycles = WatchCycleCountGet() - start;
+
+	cpswinst->tx_stats.irqs++;
+	cpswinst->tx_stats.completed += done;
+	cpswinst->tx_stats.isr_cycles += cycles;
+
+	if (cycles > cpswinst->tx_stats.isr_max_cycles) {
+		cpswinst->tx_stats.isr_max_cycles = cycles;
+	}
+
+#if !defined(CPSW_RX_POLL_MODE) && !LWIP_SUPPORT_CUSTOM_PBUF
+	/* Retry rx bd's which were left unarmed for lack of pbufs */
+	cpswif_rx_refill(cpswinst);
+#endif
 }
 
 /**
@@ -2283,6 +3672,52 @@ static u32_t check_valid(u32_t value, u32_t min, u32_t max) {
 		return FALSE;
 }
 
+#ifdef CPSW_SWITCH_CONFIG
+/**
+ * Counts an ALE add, lookup or delete and the CPU cycles it took
+ * @param  cpswinst  The CPSW instance structure pointer
+ * @param  cmd       The switch configuration command
+ * @param  start     cycle count at the start of the command
+ *
+ * @return  None
+ */
+static void cpswif_ale_account(struct cpswinst *cpswinst, u32_t cmd,
+		u32_t start) {
+	u32_t cycles = WatchCycleCountGet() - start;
+	struct cpswif_ale_op *op;
+
+	switch (cmd) {
+	case CONFIG_SWITCH_ADD_MULTICAST:
+	case CONFIG_SWITCH_ADD_UNICAST:
+	case CONFIG_SWITCH_ADD_OUI:
+	case CONFIG_SWITCH_ADD_VLAN:
+		op = &cpswinst->ale_stats.add;
+		break;
+
+	case CONFIG_SWITCH_FIND_ADDR:
+	case CONFIG_SWITCH_FIND_VLAN:
+		op = &cpswinst->ale_stats.lookup;
+		break;
+
+	case CONFIG_SWITCH_DEL_MULTICAST:
+	case CONFIG_SWITCH_DEL_UNICAST:
+	case CONFIG_SWITCH_DEL_VLAN:
+		op = &cpswinst->ale_stats.del;
+		break;
+
+	default:
+		return;
+	}
+
+	op->count++;
+	op->cycles += cycles;
+
+	if (cycles > op->max_cycles) {
+		op->max_cycles = cycles;
+	}
+}
+#endif /* CPSW_SWITCH_CONFIG */
+
 /*
  * Executes following CPSW Configutarions
  * Switch Configuration (CPSW_SWITCH_CONFIG has to be defined)
@@ -2317,6 +3752,7 @@ void cpsw_switch_configuration(struct cpsw_config *cpsw_config) {
 	struct cpsw_phy_param *cpsw_phy_param = cpsw_config->phy_param;
 #ifdef CPSW_SWITCH_CONFIG
 	struct cpsw_switch_param *cpsw_switch_param = cpsw_config->switch_param;
+	u32_t start = WatchCycleCountGet();
 	s32_t ret;
 #endif /* CPSW_SWITCH_CONFIG */
 
@@ -2652,6 +4088,7 @@ void cpsw_switch_configuration(struct cpsw_config *cpsw_config) {
 	case CONFIG_SWITCH_AGEOUT:
 	{
 		CPSWALEAgeOut(cpswinst->ale_base);
+		cpswif_ale_shadow_load(cpswinst, TRUE);
 		cpsw_config->ret = ERR_PASS;
 		break;
 	}
@@ -2895,4 +4332,8 @@ void cpsw_switch_configuration(struct cpsw_config *cpsw_config) {
 		cpsw_config->ret = ERR_INVAL;
 		break;
 	}
+
+#ifdef CPSW_SWITCH_CONFIG
+	cpswif_ale_account(cpswinst, cpsw_config->cmd, start);
+#endif /* CPSW_SWITCH_CONFIG */
 }
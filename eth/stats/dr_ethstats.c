@@ -0,0 +1,337 @@
+/*
+ * Driver: dr_ethstats.c
+ * Part of BRO Project, 2014 <<https://github.com/BRO-FHV>>
+ *
+ * Created on: 19.10.2014
+ * Description:
+ * Samples the ethernet counters on a timer and serves the deltas over UDP
+ */
+
+#include "lwip/udp.h"
+#include "lwip/stats.h"
+#include "dr_ethstats.h"
+#include <string.h>
+#include <stdio.h>
+#include "interrupt/dr_interrupt.h"
+#include "timer/dr_timer.h"
+#include "eth/cpsw/dr_cpsw.h"
+#include "eth/lwip/ports/cpsw/include/netif/cpswif.h"
+
+#define USE_TIMER		Timer_TIMER5
+#define TEXT_MAX		1400
+#define RECORD_LEN		16
+#define HEADER_LEN		16
+
+/* Statistics register of each hardware counter, in the order of EthStatsCounter */
+static const uint32_t hwReg[] = {
+	CPSW_STAT_RX_GOOD_FRAMES, CPSW_STAT_RX_BCAST_FRAMES,
+	CPSW_STAT_RX_MCAST_FRAMES, CPSW_STAT_RX_PAUSE_FRAMES,
+	CPSW_STAT_RX_CRC_ERRORS, CPSW_STAT_RX_ALIGN_CODE_ERRORS,
+	CPSW_STAT_RX_OVERSIZED_FRAMES, CPSW_STAT_RX_JABBER_FRAMES,
+	CPSW_STAT_RX_UNDERSIZED_FRAMES, CPSW_STAT_RX_FRAGMENTS,
+	CPSW_STAT_RX_OCTETS, CPSW_STAT_TX_GOOD_FRAMES,
+	CPSW_STAT_TX_BCAST_FRAMES, CPSW_STAT_TX_MCAST_FRAMES,
+	CPSW_STAT_TX_PAUSE_FRAMES, CPSW_STAT_TX_DEFERRED_FRAMES,
+	CPSW_STAT_TX_COLLISION_FRAMES, CPSW_STAT_TX_SINGLE_COLL_FRAMES,
+	CPSW_STAT_TX_MULT_COLL_FRAMES, CPSW_STAT_TX_EXCESSIVE_COLLISIONS,
+	CPSW_STAT_TX_LATE_COLLISIONS, CPSW_STAT_TX_UNDERRUN,
+	CPSW_STAT_TX_CARRIER_SENSE_ERRORS, CPSW_STAT_TX_OCTETS,
+	CPSW_STAT_FRAMES_64, CPSW_STAT_FRAMES_65_127,
+	CPSW_STAT_FRAMES_128_255, CPSW_STAT_FRAMES_256_511,
+	CPSW_STAT_FRAMES_512_1023, CPSW_STAT_FRAMES_1024_UP,
+	CPSW_STAT_NET_OCTETS, CPSW_STAT_RX_SOF_OVERRUNS,
+	CPSW_STAT_RX_MOF_OVERRUNS, CPSW_STAT_RX_DMA_OVERRUNS
+};
+
+#define HW_NUM			(sizeof(hwReg) / sizeof(hwReg[0]))
+
+/* Names for the text response, in the order of EthStatsCounter */
+static const char *names[ETHSTATS_NUM] = {
+	"rx_good", "rx_bcast", "rx_mcast", "rx_pause", "rx_crc_err",
+	"rx_align_err", "rx_oversized", "rx_jabber", "rx_undersized",
+	"rx_fragments", "rx_octets", "tx_good", "tx_bcast", "tx_mcast",
+	"tx_pause", "tx_deferred", "tx_collision", "tx_single_coll",
+	"tx_mult_coll", "tx_excessive_coll", "tx_late_coll", "tx_underrun",
+	"tx_carrier_err", "tx_octets", "frames_64", "frames_65_127",
+	"frames_128_255", "frames_256_511", "frames_512_1023",
+	"frames_1024_up", "net_octets", "rx_sof_overruns", "rx_mof_overruns",
+	"rx_dma_overruns",
+	"drv_rx_irqs", "drv_rx_frames", "drv_rx_coalesced", "drv_rx_budget_hits",
+	"drv_rx_starved", "drv_rx_pool_drops",
+	"drv_tx_frames", "drv_tx_irqs", "drv_tx_completed", "drv_tx_coalesced",
+	"drv_tx_ring_full", "drv_tx_err_mem", "drv_tx_drop_chain",
+	"p1_rx_frames", "p1_rx_octets", "p1_tx_frames", "p1_tx_octets",
+	"p2_rx_frames", "p2_rx_octets", "p2_tx_frames", "p2_tx_octets",
+	"link_xmit", "link_recv", "link_drop", "link_memerr"
+};
+
+/* The timer builds the next snapshot from the last one; readers copy the
+ * last one with interrupts disabled, see EthStatsGet */
+static EthStatsSnapshot snapshots[2];
+static volatile uint32_t current;
+static uint32_t prev[ETHSTATS_NUM];
+static uint32_t samplePeriodMs;
+static struct udp_pcb *pcb;
+
+/*
+ * Reads all counters. Derived counters are left 0, see EthStatsTick.
+ */
+static void EthStatsSample(uint32_t raw[]) {
+	struct cpswif_rx_stats rx;
+	struct cpswif_tx_stats tx;
+	struct cpswif_port_stats port;
+	uint32_t i;
+
+	memset(raw, 0, ETHSTATS_NUM * sizeof(uint32_t));
+
+	for (i = 0; i < HW_NUM; i++) {
+		raw[i] = CPSWStatisticsGet(CPSW0_STAT_REGS, hwReg[i]);
+	}
+
+	cpswif_rx_stats_get(0, &rx);
+	raw[ETHSTATS_DRV_RX_IRQS] = rx.irqs;
+	raw[ETHSTATS_DRV_RX_FRAMES] = rx.frames;
+	raw[ETHSTATS_DRV_RX_BUDGET_HITS] = rx.budget_hits;
+	raw[ETHSTATS_DRV_RX_STARVED] = rx.starved;
+	raw[ETHSTATS_DRV_RX_POOL_DROPS] = rx.pool_drops;
+
+	cpswif_tx_stats_get(0, &tx);
+	raw[ETHSTATS_DRV_TX_FRAMES] = tx.frames;
+	raw[ETHSTATS_DRV_TX_IRQS] = tx.irqs;
+	raw[ETHSTATS_DRV_TX_COMPLETED] = tx.completed;
+	raw[ETHSTATS_DRV_TX_RING_FULL] = tx.ring_full;
+	raw[ETHSTATS_DRV_TX_DROP_CHAIN] = tx.drop_chain;
+
+	for (i = 0; i < CPSW_TXQ_CLASSES; i++) {
+		raw[ETHSTATS_DRV_TX_ERR_MEM] += tx.drop_full[i];
+	}
+
+	cpswif_port_stats_get(0, 1, &port);
+	raw[ETHSTATS_P1_RX_FRAMES] = port.rx_frames;
+	raw[ETHSTATS_P1_RX_OCTETS] = port.rx_octets;
+	raw[ETHSTATS_P1_TX_FRAMES] = port.tx_frames;
+	raw[ETHSTATS_P1_TX_OCTETS] = port.tx_octets;
+
+	cpswif_port_stats_get(0, 2, &port);
+	raw[ETHSTATS_P2_RX_FRAMES] = port.rx_frames;
+	raw[ETHSTATS_P2_RX_OCTETS] = port.rx_octets;
+	raw[ETHSTATS_P2_TX_FRAMES] = port.tx_frames;
+	raw[ETHSTATS_P2_TX_OCTETS] = port.tx_octets;
+
+#if LINK_STATS
+	raw[ETHSTATS_LINK_XMIT] = lwip_stats.link.xmit;
+	raw[ETHSTATS_LINK_RECV] = lwip_stats.link.recv;
+	raw[ETHSTATS_LINK_DROP] = lwip_stats.link.drop;
+	raw[ETHSTATS_LINK_MEMERR] = lwip_stats.link.memerr;
+#endif
+}
+
+/*
+ * Difference of two deltas, 0 if negative
+ */
+static uint32_t EthStatsExcess(uint32_t a, uint32_t b) {
+	return a > b ? a - b : 0;
+}
+
+/*
+ * Timer routine: computes the deltas, rates and totals of the period
+ */
+static void EthStatsTick() {
+	EthStatsSnapshot *last = &snapshots[current];
+	EthStatsSnapshot *next = &snapshots[current ^ 1];
+	uint32_t raw[ETHSTATS_NUM];
+	uint32_t i, delta;
+
+	EthStatsSample(raw);
+
+	for (i = 0; i < ETHSTATS_NUM; i++) {
+		// Unsigned difference, right across one wrap of the counter
+		delta = raw[i] - prev[i];
+
+#if LINK_STATS
+		if (i >= ETHSTATS_LINK_XMIT) {
+			delta = (STAT_COUNTER) delta;
+		}
+#endif
+		next->delta[i] = delta;
+		prev[i] = raw[i];
+	}
+
+	next->delta[ETHSTATS_DRV_RX_COALESCED] = EthStatsExcess(
+			next->delta[ETHSTATS_DRV_RX_FRAMES], next->delta[ETHSTATS_DRV_RX_IRQS]);
+	next->delta[ETHSTATS_DRV_TX_COALESCED] = EthStatsExcess(
+			next->delta[ETHSTATS_DRV_TX_COMPLETED], next->delta[ETHSTATS_DRV_TX_IRQS]);
+
+	for (i = 0; i < ETHSTATS_NUM; i++) {
+		next->total[i] = last->total[i] + next->delta[i];
+		next->rate[i] = (uint32_t) (((uint64_t) next->delta[i] * 1000) / samplePeriodMs);
+	}
+
+	next->period = last->period + 1;
+	next->periodMs = samplePeriodMs;
+
+	current ^= 1;
+}
+
+static void EthStatsPut32(uint8_t *buf, uint32_t value) {
+	buf[0] = (uint8_t) value;
+	buf[1] = (uint8_t) (value >> 8);
+	buf[2] = (uint8_t) (value >> 16);
+	buf[3] = (uint8_t) (value >> 24);
+}
+
+/*
+ * Binary response, see dr_ethstats.h
+ */
+static struct pbuf *EthStatsBinary(const EthStatsSnapshot *snap) {
+	struct pbuf *p;
+	uint8_t *buf;
+	uint32_t i;
+
+	p = pbuf_alloc(PBUF_TRANSPORT, HEADER_LEN + ETHSTATS_NUM * RECORD_LEN, PBUF_RAM);
+
+	if (NULL == p) {
+		return NULL;
+	}
+
+	buf = (uint8_t*) p->payload;
+
+	EthStatsPut32(buf, ETHSTATS_MAGIC);
+	EthStatsPut32(buf + 4, ETHSTATS_VERSION | (ETHSTATS_NUM << 16));
+	EthStatsPut32(buf + 8, snap->period);
+	EthStatsPut32(buf + 12, snap->periodMs);
+	buf += HEADER_LEN;
+
+	for (i = 0; i < ETHSTATS_NUM; i++, buf += RECORD_LEN) {
+		EthStatsPut32(buf, (uint32_t) snap->total[i]);
+		EthStatsPut32(buf + 4, (uint32_t) (snap->total[i] >> 32));
+		EthStatsPut32(buf + 8, snap->delta[i]);
+		EthStatsPut32(buf + 12, snap->rate[i]);
+	}
+
+	return p;
+}
+
+/*
+ * Text response: one line "name total delta rate" per counter which is not 0
+ */
+static struct pbuf *EthStatsText(const EthStatsSnapshot *snap) {
+	static char text[TEXT_MAX];
+	struct pbuf *p;
+	uint32_t i, len;
+	int n;
+
+	len = snprintf(text, TEXT_MAX, "period %" PRIu32 " %" PRIu32 " ms\n",
+			snap->period, snap->periodMs);
+
+	for (i = 0; i < ETHSTATS_NUM; i++) {
+		if (0 == snap->total[i]) {
+			continue;
+		}
+
+		n = snprintf(text + len, TEXT_MAX - len,
+				"%s %llu %" PRIu32 " %" PRIu32 "\n", names[i],
+				(unsigned long long) snap->total[i], snap->delta[i], snap->rate[i]);
+
+		// Stop before a line that does not fit
+		if (n < 0 || len + n >= TEXT_MAX) {
+			break;
+		}
+		len += n;
+	}
+
+	p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+
+	if (NULL != p) {
+		memcpy(p->payload, text, len);
+	}
+
+	return p;
+}
+
+/*
+ * Any packet is a request, the answer goes back to the sender
+ */
+static void EthStatsRecv(void *arg, struct udp_pcb *pcb, struct pbuf *p, struct ip_addr *addr, u16_t port) {
+	static EthStatsSnapshot snap;
+	struct pbuf *reply;
+
+	if (p == NULL) {
+		return;
+	}
+
+	// Format a private copy, the timer may run several times meanwhile
+	EthStatsGet(&snap);
+
+	if (p->len > 0 && 't' == *((char*) p->payload)) {
+		reply = EthStatsText(&snap);
+	} else {
+		reply = EthStatsBinary(&snap);
+	}
+
+	pbuf_free(p);
+
+	if (NULL != reply) {
+		udp_sendto(pcb, reply, addr, port);
+		pbuf_free(reply);
+	}
+}
+
+/**
+ * \brief   Start sampling the ethernet counters and answer requests on
+ * 			ETHSTATS_PORT. Call it after the ethernet is configured.
+ *
+ * \param   periodMs	Sampling period in ms (1 - ETHSTATS_MAX_PERIOD)
+ *
+ * \return	TRUE if sampling runs, FALSE if no UDP pcb was left or TIMER5
+ * 			is already in use
+ *
+ **/
+int32_t EthStatsStart(uint32_t periodMs) {
+	if (periodMs < 1) {
+		periodMs = 1;
+	} else if (periodMs > ETHSTATS_MAX_PERIOD) {
+		periodMs = ETHSTATS_MAX_PERIOD;
+	}
+
+	samplePeriodMs = periodMs;
+	memset(snapshots, 0, sizeof(snapshots));
+	current = 0;
+	EthStatsSample(prev);
+
+	pcb = udp_new();
+
+	if (NULL == pcb) {
+		return FALSE;
+	}
+
+	if (ERR_OK != udp_bind(pcb, IP_ADDR_ANY, ETHSTATS_PORT)
+			|| !TimerConfiguration(USE_TIMER, periodMs, EthStatsTick)) {
+		udp_remove(pcb);
+		pcb = NULL;
+		return FALSE;
+	}
+
+	udp_recv(pcb, EthStatsRecv, NULL);
+
+	return TimerEnable(USE_TIMER);
+}
+
+/**
+ * \brief   Get the counters of the last period.
+ *
+ * \param   snapshot	Filled with the deltas, rates and totals
+ *
+ **/
+void EthStatsGet(EthStatsSnapshot *snapshot) {
+	uint32_t irqStatus;
+
+	irqStatus = IntMasterStatusGet();
+	IntMasterIRQDisable();
+
+	*snapshot = snapshots[current];
+
+	if (0 == (irqStatus & 0x80)) {
+		IntMasterIRQEnable();
+	}
+}
@@ -0,0 +1,121 @@
+/*
+ * Driver: dr_ethstats.h
+ * Part of BRO Project, 2014 <<https://github.com/BRO-FHV>>
+ *
+ * Created on: 19.10.2014
+ * Description:
+ * Ethernet statistics: samples the CPSW hardware counters, the driver
+ * counters and the lwIP link counters on a timer. Every period gives the
+ * delta and the rate per second of each counter, and totals that do not
+ * wrap.
+ *
+ * Any UDP packet to port 4000 is answered with the last period, in text
+ * if it starts with 't' (counters that are still 0 are left out), in
+ * binary otherwise. Binary, all fields little endian:
+ *   uint32_t magic ('CPST'), uint16_t version, uint16_t count,
+ *   uint32_t period number, uint32_t period in ms,
+ *   then count times: uint64_t total, uint32_t delta, uint32_t rate
+ * in the order of EthStatsCounter.
+ *
+ * The hardware counters are 32 bit: at 1 Gbit/s the octet counters wrap
+ * in 34 s. The lwIP counters are 16 bit unless LWIP_STATS_LARGE. Each
+ * counter may wrap at most once per period, keep the period short.
+ *
+ * Uses TIMER5!
+ */
+
+#ifndef DR_ETHSTATS_H_
+#define DR_ETHSTATS_H_
+
+#include <inttypes.h>
+
+#define ETHSTATS_PORT			4000
+#define ETHSTATS_MAGIC			0x54535043	/* "CPST" */
+#define ETHSTATS_VERSION		1
+#define ETHSTATS_MAX_PERIOD		10000
+
+typedef enum {
+	/* CPSW hardware statistics, host and slave ports together */
+	ETHSTATS_RX_GOOD_FRAMES,
+	ETHSTATS_RX_BCAST_FRAMES,
+	ETHSTATS_RX_MCAST_FRAMES,
+	ETHSTATS_RX_PAUSE_FRAMES,
+	ETHSTATS_RX_CRC_ERRORS,
+	ETHSTATS_RX_ALIGN_CODE_ERRORS,
+	ETHSTATS_RX_OVERSIZED_FRAMES,
+	ETHSTATS_RX_JABBER_FRAMES,
+	ETHSTATS_RX_UNDERSIZED_FRAMES,
+	ETHSTATS_RX_FRAGMENTS,
+	ETHSTATS_RX_OCTETS,
+	ETHSTATS_TX_GOOD_FRAMES,
+	ETHSTATS_TX_BCAST_FRAMES,
+	ETHSTATS_TX_MCAST_FRAMES,
+	ETHSTATS_TX_PAUSE_FRAMES,
+	ETHSTATS_TX_DEFERRED_FRAMES,
+	ETHSTATS_TX_COLLISION_FRAMES,
+	ETHSTATS_TX_SINGLE_COLL_FRAMES,
+	ETHSTATS_TX_MULT_COLL_FRAMES,
+	ETHSTATS_TX_EXCESSIVE_COLLISIONS,
+	ETHSTATS_TX_LATE_COLLISIONS,
+	ETHSTATS_TX_UNDERRUN,
+	ETHSTATS_TX_CARRIER_SENSE_ERRORS,
+	ETHSTATS_TX_OCTETS,
+	ETHSTATS_FRAMES_64,
+	ETHSTATS_FRAMES_65_127,
+	ETHSTATS_FRAMES_128_255,
+	ETHSTATS_FRAMES_256_511,
+	ETHSTATS_FRAMES_512_1023,
+	ETHSTATS_FRAMES_1024_UP,
+	ETHSTATS_NET_OCTETS,
+	ETHSTATS_RX_SOF_OVERRUNS,
+	ETHSTATS_RX_MOF_OVERRUNS,
+	ETHSTATS_RX_DMA_OVERRUNS,
+
+	/* Driver: receive path */
+	ETHSTATS_DRV_RX_IRQS,
+	ETHSTATS_DRV_RX_FRAMES,
+	ETHSTATS_DRV_RX_COALESCED,		/* frames that needed no interrupt of their own */
+	ETHSTATS_DRV_RX_BUDGET_HITS,
+	ETHSTATS_DRV_RX_STARVED,		/* refills that left rx bd's unarmed */
+	ETHSTATS_DRV_RX_POOL_DROPS,
+
+	/* Driver: transmit path */
+	ETHSTATS_DRV_TX_FRAMES,
+	ETHSTATS_DRV_TX_IRQS,
+	ETHSTATS_DRV_TX_COMPLETED,
+	ETHSTATS_DRV_TX_COALESCED,		/* frames reclaimed without an interrupt of their own */
+	ETHSTATS_DRV_TX_RING_FULL,
+	ETHSTATS_DRV_TX_ERR_MEM,		/* frames dropped on a full transmit queue */
+	ETHSTATS_DRV_TX_DROP_CHAIN,
+
+	/* Driver: slave ports */
+	ETHSTATS_P1_RX_FRAMES,
+	ETHSTATS_P1_RX_OCTETS,
+	ETHSTATS_P1_TX_FRAMES,
+	ETHSTATS_P1_TX_OCTETS,
+	ETHSTATS_P2_RX_FRAMES,
+	ETHSTATS_P2_RX_OCTETS,
+	ETHSTATS_P2_TX_FRAMES,
+	ETHSTATS_P2_TX_OCTETS,
+
+	/* lwIP link statistics, 0 without LINK_STATS */
+	ETHSTATS_LINK_XMIT,
+	ETHSTATS_LINK_RECV,
+	ETHSTATS_LINK_DROP,
+	ETHSTATS_LINK_MEMERR,
+
+	ETHSTATS_NUM
+} EthStatsCounter;
+
+typedef struct {
+	uint32_t period;				/* number of the period, 0 before the first */
+	uint32_t periodMs;
+	uint64_t total[ETHSTATS_NUM];	/* since EthStatsStart */
+	uint32_t delta[ETHSTATS_NUM];	/* in the last period */
+	uint32_t rate[ETHSTATS_NUM];	/* per second in the last period */
+} EthStatsSnapshot;
+
+int32_t EthStatsStart(uint32_t periodMs);
+void EthStatsGet(EthStatsSnapshot *snapshot);
+
+#endif /* DR_ETHSTATS_H_ */
@@ -22,6 +22,9 @@
 #include "cpu/hw_cpu.h"
 #include "thirdParty/fatfs/src/ff.h"
 #include "elf/dr_elfloader.h"
+#include "dr_sd_blk.h"
+#include "../watch/dr_watch.h"
+#include "dr_sd.h"
 
 /******************************************************************************
 **                      INTERNAL MACRO DEFINITIONS
@@ -86,9 +89,6 @@ extern void HSMMCSDFsMount(unsigned int driveNum, void *ptr);
 extern unsigned int HSMMCSDFsProcessCmdLine(void);
 //extern int Cmd_help(int argc, char *argv[]);
 
-/* EDMA callback function array */
-static void (*cb_Fxn[EDMA3_NUM_TCC]) (unsigned int tcc, unsigned int status);
-
 /******************************************************************************
 **                      VARIABLE DEFINITIONS
 *******************************************************************************/
@@ -269,156 +269,23 @@ static void HSMMCSDXferSetup(mmcsdCtrlInfo *ctrl, unsigned char rwFlag, void *pt
 /*
 ** This function is used as a callback from EDMA3 Completion Handler.
 */
-static void callback(unsigned int tccNum, unsigned int status)
-{
-    callbackOccured = 1;
-    EDMA3DisableTransfer(EDMA_INST_BASE, tccNum, EDMA3_TRIG_MODE_EVENT);
-}
-
-static void Edma3CompletionIsr(void)
+static void callback(unsigned int tccNum, unsigned int status, void *ctx)
 {
-    volatile unsigned int pendingIrqs;
-    volatile unsigned int isIPR = 0;
-
-    unsigned int indexl;
-    unsigned int Cnt = 0;
-
-    indexl = 1;
-
-    isIPR = EDMA3GetIntrStatus(EDMA_INST_BASE);
-
-    if(isIPR)
+    if (SdBlkActive())
     {
-        while ((Cnt < EDMA3CC_COMPL_HANDLER_RETRY_COUNT)&& (indexl != 0u))
-        {
-            indexl = 0u;
-            pendingIrqs = EDMA3GetIntrStatus(EDMA_INST_BASE);
-
-            while (pendingIrqs)
-            {
-                if((pendingIrqs & 1u) == TRUE)
-                {
-                    /**
-                    * If the user has not given any callback function
-                    * while requesting the TCC, its TCC specific bit
-                    * in the IPR register will NOT be cleared.
-                    */
-                    /* here write to ICR to clear the corresponding IPR bits */
-
-                    EDMA3ClrIntr(EDMA_INST_BASE, indexl);
-
-                    if (cb_Fxn[indexl] != NULL)
-                    {
-                        (*cb_Fxn[indexl])(indexl, EDMA3_XFER_COMPLETE);
-                    }
-                }
-                ++indexl;
-                pendingIrqs >>= 1u;
-            }
-            Cnt++;
-        }
+        /* Transfer belongs to the asynchronous block queue */
+        SdBlkDmaEvent(tccNum, status == EDMA3_XFER_COMPLETE);
+        return;
     }
-}
-
-static void Edma3CCErrorIsr(void)
-{
-    volatile unsigned int pendingIrqs;
-    volatile unsigned int evtqueNum = 0;  /* Event Queue Num */
-    volatile unsigned int isIPRH = 0;
-    volatile unsigned int isIPR = 0;
-    volatile unsigned int Cnt = 0u;
-    volatile unsigned int index;
 
-    pendingIrqs = 0u;
-    index = 1u;
-
-    isIPR  = EDMA3GetIntrStatus(EDMA_INST_BASE);
-    isIPRH = EDMA3IntrStatusHighGet(EDMA_INST_BASE);
-
-    if((isIPR | isIPRH ) || (EDMA3QdmaGetErrIntrStatus(EDMA_INST_BASE) != 0)
-        || (EDMA3GetCCErrStatus(EDMA_INST_BASE) != 0))
+    if (status != EDMA3_XFER_COMPLETE)
     {
-        /* Loop for EDMA3CC_ERR_HANDLER_RETRY_COUNT number of time,
-         * breaks when no pending interrupt is found
-         */
-        while ((Cnt < EDMA3CC_ERR_HANDLER_RETRY_COUNT)
-                    && (index != 0u))
-        {
-            index = 0u;
-
-            if(isIPR)
-            {
-                   pendingIrqs = EDMA3GetErrIntrStatus(EDMA_INST_BASE);
-            }
-            else
-            {
-                   pendingIrqs = EDMA3ErrIntrHighStatusGet(EDMA_INST_BASE);
-            }
-
-            while (pendingIrqs)
-            {
-                   /*Process all the pending interrupts*/
-                   if(TRUE == (pendingIrqs & 1u))
-                   {
-                      /* Write to EMCR to clear the corresponding EMR bits.
-                       */
-                        /*Clear any SER*/
-
-                        if(isIPR)
-                        {
-                             EDMA3ClrMissEvt(EDMA_INST_BASE, index);
-                        }
-                        else
-                        {
-                             EDMA3ClrMissEvt(EDMA_INST_BASE, index + 32);
-                        }
-                   }
-                   ++index;
-                   pendingIrqs >>= 1u;
-            }
-            index = 0u;
-            pendingIrqs = EDMA3QdmaGetErrIntrStatus(EDMA_INST_BASE);
-            while (pendingIrqs)
-            {
-                /*Process all the pending interrupts*/
-                if(TRUE == (pendingIrqs & 1u))
-                {
-                    /* Here write to QEMCR to clear the corresponding QEMR bits*/
-                    /*Clear any QSER*/
-                    EDMA3QdmaClrMissEvt(EDMA_INST_BASE, index);
-                }
-                ++index;
-                pendingIrqs >>= 1u;
-            }
-            index = 0u;
-
-
-            pendingIrqs = EDMA3GetCCErrStatus(EDMA_INST_BASE);
-            if (pendingIrqs != 0u)
-            {
-            /* Process all the pending CC error interrupts. */
-            /* Queue threshold error for different event queues.*/
-            for (evtqueNum = 0u; evtqueNum < SOC_EDMA3_NUM_EVQUE; evtqueNum++)
-                {
-                if((pendingIrqs & (1u << evtqueNum)) != 0u)
-                {
-                        /* Clear the error interrupt. */
-                        EDMA3ClrCCErr(EDMA_INST_BASE, (1u << evtqueNum));
-                    }
-                }
-
-            /* Transfer completion code error. */
-            if ((pendingIrqs & (1 << EDMA3CC_CCERR_TCCERR_SHIFT)) != 0u)
-            {
-                EDMA3ClrCCErr(EDMA_INST_BASE,
-                                      (0x01u << EDMA3CC_CCERR_TCCERR_SHIFT));
-            }
-                ++index;
-            }
-            Cnt++;
-        }
+        /* Missed event or TCC error, let the transfer time out */
+        return;
     }
 
+    callbackOccured = 1;
+    EDMA3DisableTransfer(EDMA_INST_BASE, tccNum, EDMA3_TRIG_MODE_EVENT);
 }
 
 static void HSMMCSDIsr(void)
@@ -429,6 +296,13 @@ static void HSMMCSDIsr(void)
 
     HSMMCSDIntrStatusClear(ctrlInfo.memBase, status);
 
+    if (SdBlkActive())
+    {
+        /* Completion is driven by the asynchronous block queue */
+        SdBlkCtrlEvent(status);
+        return;
+    }
+
     if (status & HS_MMCSD_STAT_CMDCOMP)
     {
         cmdCompFlag = 1;
@@ -447,6 +321,12 @@ static void HSMMCSDIsr(void)
         {
             dataTimeout = 1;
         }
+
+        /* A failed Auto CMD12 leaves the card in transfer state */
+        if (status & HS_MMCSD_STAT_ACMD12ERR)
+        {
+            dataTimeout = 1;
+        }
     }
 
     if (status & HS_MMCSD_STAT_TRNFCOMP)
@@ -461,23 +341,8 @@ static void HSMMCSDIsr(void)
 */
 static void EDMA3AINTCConfigure(void)
 {
-    /* Registering EDMA3 Channel Controller transfer completion interrupt.  */
-	IntRegister(EDMA_COMPLTN_INT_NUM, Edma3CompletionIsr);
-
-    /* Setting the priority for EDMA3CC completion interrupt in AINTC. */
-	// IntPrioritySet(EDMA_COMPLTN_INT_NUM, 0, AINTC_HOSTINT_ROUTE_IRQ);
-
-    /* Registering EDMA3 Channel Controller Error Interrupt. */
-    IntRegister(EDMA_ERROR_INT_NUM, Edma3CCErrorIsr);
-
-    /* Setting the priority for EDMA3CC Error interrupt in AINTC. */
-    // IntPrioritySet(EDMA_ERROR_INT_NUM, 0, AINTC_HOSTINT_ROUTE_IRQ);
-
-    /* Enabling the EDMA3CC completion interrupt in AINTC. */
-    IntHandlerEnable(EDMA_COMPLTN_INT_NUM);
-
-    /* Enabling the EDMA3CC Error interrupt in AINTC. */
-    IntHandlerEnable(EDMA_ERROR_INT_NUM);
+    /* Registering the shared EDMA3CC completion and error handlers. */
+    EDMA3IntrSetup(EDMA_INST_BASE);
 
     /* Registering HSMMC Interrupt handler */
     IntRegister(MMCSD_INT_NUM, HSMMCSDIsr);
@@ -502,6 +367,9 @@ static void EDMA3Initialize(void)
     /* Initialization of EDMA3 */
     EDMA3Init(EDMA_INST_BASE, EVT_QUEUE_NUM);
 
+    /* Queue priorities and watermarks of the DMA client classes */
+    EDMA3QosConfig(EDMA_INST_BASE, NULL);
+
     /* Configuring the AINTC to receive EDMA3 interrupts. */
     EDMA3AINTCConfigure();
 }
@@ -512,20 +380,20 @@ static void HSMMCSDEdmaInit(void)
     EDMA3Initialize();
 
     /* Request DMA Channel and TCC for MMCSD Transmit*/
-    EDMA3RequestChannel(EDMA_INST_BASE, EDMA3_CHANNEL_TYPE_DMA,
-                        MMCSD_TX_EDMA_CHAN, MMCSD_TX_EDMA_CHAN,
-                        EVT_QUEUE_NUM);
+    EDMA3QosRequestChannel(EDMA_INST_BASE, EDMA3_CHANNEL_TYPE_DMA,
+                           MMCSD_TX_EDMA_CHAN, MMCSD_TX_EDMA_CHAN,
+                           EDMA3_QOS_CLASS_BULK);
 
     /* Registering Callback Function for TX*/
-    cb_Fxn[MMCSD_TX_EDMA_CHAN] = &callback;
+    EDMA3RegisterCallback(MMCSD_TX_EDMA_CHAN, callback, NULL);
 
     /* Request DMA Channel and TCC for MMCSD Receive */
-    EDMA3RequestChannel(EDMA_INST_BASE, EDMA3_CHANNEL_TYPE_DMA,
-                        MMCSD_RX_EDMA_CHAN, MMCSD_RX_EDMA_CHAN,
-                        EVT_QUEUE_NUM);
+    EDMA3QosRequestChannel(EDMA_INST_BASE, EDMA3_CHANNEL_TYPE_DMA,
+                           MMCSD_RX_EDMA_CHAN, MMCSD_RX_EDMA_CHAN,
+                           EDMA3_QOS_CLASS_BULK);
 
     /* Registering Callback Function for RX*/
-    cb_Fxn[MMCSD_RX_EDMA_CHAN] = &callback;
+    EDMA3RegisterCallback(MMCSD_RX_EDMA_CHAN, callback, NULL);
 }
 
 /*
@@ -545,11 +413,14 @@ static void HSMMCSDControllerSetup(void)
     ctrlInfo.cmdSend = HSMMCSDCmdSend;
     ctrlInfo.busWidthConfig = HSMMCSDBusWidthConfig;
     ctrlInfo.busFreqConfig = HSMMCSDBusFreqConfig;
+    ctrlInfo.highSpeedConfig = HSMMCSDHighSpeedConfig;
     ctrlInfo.intrMask = (HS_MMCSD_INTR_CMDCOMP | HS_MMCSD_INTR_CMDTIMEOUT |
-                            HS_MMCSD_INTR_DATATIMEOUT | HS_MMCSD_INTR_TRNFCOMP);
+                            HS_MMCSD_INTR_DATATIMEOUT | HS_MMCSD_INTR_TRNFCOMP |
+                            HS_MMCSD_INTR_ACMD12ERR);
     ctrlInfo.intrEnable = HSMMCSDIntEnable;
     ctrlInfo.busWidth = (SD_BUS_WIDTH_1BIT | SD_BUS_WIDTH_4BIT);
     ctrlInfo.highspeed = 1;
+    ctrlInfo.autoCmd12 = 1;
     ctrlInfo.ocr = (SD_OCR_VDD_3P0_3P1 | SD_OCR_VDD_3P1_3P2);
     ctrlInfo.card = &sdCard;
     ctrlInfo.ipClk = HSMMCSD_IN_FREQ;
@@ -557,6 +428,12 @@ static void HSMMCSDControllerSetup(void)
     ctrlInfo.cdPinNum = HSMMCSD_CARD_DETECT_PINNUM;
     sdCard.ctrl = &ctrlInfo;
 
+    SdBlkInit(&ctrlInfo, EDMA_INST_BASE, MMCSD_RX_EDMA_CHAN,
+              MMCSD_TX_EDMA_CHAN);
+
+    /* Time base of SdThroughputMeasure */
+    WatchCycleCounterInit();
+
     callbackOccured = 0;
     xferCompFlag = 0;
     dataTimeout = 0;
@@ -639,19 +516,22 @@ int startFileSystem(void)
     }
 }
 
-/* Defines size of the buffers that hold temporary data. */
-#define DATA_BUF_SIZE   64 * (2 * 512)
-static char g_cDataBuf[DATA_BUF_SIZE];
+/* Largest f_read of getElfFile, a multiple of the sector size below 64k */
+#define ELF_READ_CHUNK   (127 * 512)
 
 /**
  * Opens and reads file content
+ *
+ * The file is read straight into dataBuf, whole sectors are transferred
+ * by DMA without a bounce buffer, only a partial last sector is copied.
  */
 void  getElfFile(uint8_t * dataBuf,DWORD size ,const char * path){
 
 	FIL  fos;
 	FRESULT result;
 	WORD  read=0;
-	unsigned int totalRead = 0;
+	WORD  chunk;
+	DWORD totalRead = 0;
 
 
 	result = f_open(&fos, path,FA_READ);
@@ -661,26 +541,26 @@ void  getElfFile(uint8_t * dataBuf,DWORD size ,const char * path){
 		return;
 	}
 
-	/*result = f_stat(path, &fi);
-
-		if(result != FR_OK){
-			printf("FS: File could not be opened! FRESULT: %d", result);
-			return 0;
-		}
-*/  do
+	while(totalRead < size)
 	{
-		totalRead += read;
+		chunk = (size - totalRead > ELF_READ_CHUNK) ?
+				ELF_READ_CHUNK : (WORD) (size - totalRead);
 		read = 0;
-		result = f_read(&fos,g_cDataBuf, 65535 ,&read);
-
+		result = f_read(&fos, dataBuf + totalRead, chunk, &read);
 
 		if(result != FR_OK){
 			printf("FS: File could not be read! FRESULT: %d\n", result);
+			f_close(&fos);
 			return;
 		}
-		memcpy(dataBuf + totalRead, g_cDataBuf, read);
+
+		if(0 == read){
+			/* End of file */
+			break;
+		}
+
+		totalRead += read;
 	}
-	 while(totalRead+read < size);
 
 	result = f_close(&fos);
 
@@ -691,4 +571,64 @@ void  getElfFile(uint8_t * dataBuf,DWORD size ,const char * path){
     }
 }
 
+/**
+ * \brief Reports the bus width and clock negotiated with the card
+ *
+ * The values are read back from the controller, so the clock is the one
+ * really on the bus (e.g. 48MHz for a 50MHz high speed request with the
+ * 96MHz reference clock).
+ *
+ * \param info		filled with the bus parameters
+ */
+void SdBusInfoGet(SdBusInfo *info)
+{
+    info->cardType = sdCard.cardType;
+    info->highSpeed = (HWREG(ctrlInfo.memBase + MMCHS_HCTL) & MMCHS_HCTL_HSPE) ? 1 : 0;
+    info->clockHz = HSMMCSDBusFreqGet(ctrlInfo.memBase, ctrlInfo.ipClk);
+
+    switch (HSMMCSDBusWidthGet(ctrlInfo.memBase))
+    {
+        case HS_MMCSD_BUS_WIDTH_8BIT:
+            info->busWidth = 8;
+            break;
+        case HS_MMCSD_BUS_WIDTH_4BIT:
+            info->busWidth = 4;
+            break;
+        default:
+            info->busWidth = 1;
+            break;
+    }
+}
+
+/**
+ * \brief Measures the sequential read throughput of the mounted card
+ *
+ * \param lba		first block
+ * \param nblks		number of blocks to read
+ * \param buf		buffer of nblks * 512 bytes
+ *
+ * \return throughput in kB/s, 0 if the read failed
+ */
+uint32_t SdThroughputMeasure(uint32_t lba, uint32_t nblks, uint8_t *buf)
+{
+    uint32_t cycles;
+    uint32_t us;
+
+    cycles = WatchCycleCountGet();
+
+    if (0 == MMCSDReadCmdSend(&ctrlInfo, buf, lba, nblks))
+    {
+        return 0;
+    }
 
+    cycles = WatchCycleCountGet() - cycles;
+    us = WatchCyclesToUs(cycles);
+
+    if (0 == us)
+    {
+        us = 1;
+    }
+
+    return (uint32_t) (((uint64_t) nblks * HSMMCSD_BLK_SIZE * 1000000) /
+                       ((uint64_t) us * 1024));
+}
@@ -12,9 +12,20 @@
 #ifndef DR_SD_H_
 #define DR_SD_H_
 
+/* Negotiated bus parameters of the mounted card */
+typedef struct {
+	uint32_t cardType;		/* MMCSD_CARD_SD or MMCSD_CARD_MMC */
+	uint32_t busWidth;		/* 1, 4 or 8 data lines */
+	uint32_t clockHz;		/* card clock as programmed in the controller */
+	uint32_t highSpeed;		/* 1 if the card was switched to high speed */
+} SdBusInfo;
+
 int startFileSystem(void);
 void  getElfFile(uint8_t * dataBuf,DWORD size ,const char * path);
 
+void SdBusInfoGet(SdBusInfo *info);
+uint32_t SdThroughputMeasure(uint32_t lba, uint32_t nblks, uint8_t *buf);
+
 #endif /* DR_SD_H_ */
 
 
@@ -0,0 +1,337 @@
+/*
+ * Driver: dr_sd_blk.c
+ * Part of BRO Project, 2014 <<https://github.com/BRO-FHV>>
+ *
+ * Created on: 19.10.2014
+ * Description:
+ * Implementation of the asynchronous block I/O queue. The queue is a
+ * singly linked list of caller owned requests, only the request at the
+ * head is on the bus. A request larger than MMCSD_MAX_XFER_BLKS is
+ * processed in several chunks.
+ *
+ * A chunk is finished when both the controller reported transfer complete
+ * (which includes the Auto CMD12) and the EDMA channel completed.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <basic.h>
+#include "soc_AM335x.h"
+#include "toSort/hs_mmcsd.h"
+#include "toSort/mmcsd_proto.h"
+#include "../interrupt/dr_interrupt.h"
+#include "../watch/dr_watch.h"
+#include "../edma/edma.h"
+#include "dr_sd_blk.h"
+
+#define SD_BLK_SIZE				512
+#define SD_BLK_BENCH_MAX_DEPTH	8
+
+static mmcsdCtrlInfo *blkCtrl;
+
+/* EDMA channels of the controller, blkDmaChan is the one on the bus */
+static uint32_t blkEdmaBase;
+static uint32_t blkRxChan;
+static uint32_t blkTxChan;
+static volatile uint32_t blkDmaChan;
+
+static SdBlkReq *volatile blkHead;
+static SdBlkReq *blkTail;
+
+/* Progress of the chunk on the bus */
+static volatile uint32_t blkChunk;
+static volatile uint32_t blkXferDone;
+static volatile uint32_t blkDmaDone;
+
+static void SdBlkStart(void);
+static void SdBlkChunkDone(uint32_t ok);
+
+/**
+ * \brief Binds the queue to a controller, must be called once before use
+ *
+ * \param ctrl		initialized controller
+ * \param edmaBase	base address of the EDMA3 channel controller
+ * \param rxChan		EDMA channel (and tcc) of the controller receive event
+ * \param txChan		EDMA channel (and tcc) of the controller transmit event
+ */
+void SdBlkInit(mmcsdCtrlInfo *ctrl, uint32_t edmaBase, uint32_t rxChan,
+		uint32_t txChan) {
+	blkCtrl = ctrl;
+	blkEdmaBase = edmaBase;
+	blkRxChan = rxChan;
+	blkTxChan = txChan;
+	blkHead = NULL;
+	blkTail = NULL;
+
+	/* Time base of SdBlkBench */
+	WatchCycleCounterInit();
+}
+
+/**
+ * \brief Appends a request to the queue and starts it if the bus is idle
+ *
+ * \param req		request, must stay valid until status is not PENDING
+ *
+ * \return TRUE if queued, FALSE if the request is invalid
+ */
+int32_t SdBlkSubmit(SdBlkReq *req) {
+	uint32_t irqStatus;
+
+	if (NULL == blkCtrl || NULL == req || 0 == req->count || NULL == req->buf) {
+		return FALSE;
+	}
+
+	req->status = SD_BLK_STATUS_PENDING;
+	req->done = 0;
+	req->next = NULL;
+
+	irqStatus = IntMasterStatusGet();
+	IntMasterIRQDisable();
+
+	if (NULL == blkHead) {
+		blkHead = req;
+		blkTail = req;
+		SdBlkStart();
+	} else {
+		blkTail->next = req;
+		blkTail = req;
+	}
+
+	if (0 == (irqStatus & 0x80)) {
+		IntMasterIRQEnable();
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief Returns 1 if no request is queued or in flight
+ */
+uint32_t SdBlkIdle(void) {
+	return (NULL == blkHead) ? 1 : 0;
+}
+
+/**
+ * \brief Returns 1 if controller events belong to the queue
+ */
+uint32_t SdBlkActive(void) {
+	return (NULL != blkHead) ? 1 : 0;
+}
+
+/*
+ * Puts the next chunk of the head request on the bus. The data command is
+ * written without waiting for command complete, errors are reported by
+ * SdBlkCtrlEvent.
+ */
+static void SdBlkStart(void) {
+	SdBlkReq *req = blkHead;
+	mmcsdCardInfo *card = blkCtrl->card;
+	uint32_t block = req->lba + req->done;
+	uint32_t remain = req->count - req->done;
+	uint32_t address;
+	uint32_t cmdIdx;
+	uint32_t cmd;
+	uint8_t *ptr = (uint8_t *) req->buf + (req->done * SD_BLK_SIZE);
+
+	blkChunk = (remain > MMCSD_MAX_XFER_BLKS) ? MMCSD_MAX_XFER_BLKS : remain;
+	blkXferDone = 0;
+	blkDmaDone = 0;
+	blkDmaChan = (SD_BLK_READ == req->dir) ? blkRxChan : blkTxChan;
+
+	address = card->highCap ? block : block * card->blkLen;
+
+	if (SD_BLK_READ == req->dir) {
+		cmdIdx = (blkChunk > 1) ? SD_CMD(18) : SD_CMD(17);
+	} else {
+		cmdIdx = (blkChunk > 1) ? SD_CMD(25) : SD_CMD(24);
+	}
+
+	cmd = HS_MMCSD_CMD(cmdIdx, HS_MMCSD_CMD_TYPE_NORMAL, HS_MMCSD_48BITS_RESPONSE,
+			(SD_BLK_READ == req->dir) ? HS_MMCSD_CMD_DIR_READ : HS_MMCSD_CMD_DIR_WRITE);
+
+	if (blkChunk > 1) {
+		cmd |= MMCHS_CMD_ACEN;
+	}
+
+	blkCtrl->xferSetup(blkCtrl, req->dir, ptr, SD_BLK_SIZE, blkChunk);
+
+	HSMMCSDIntrStatusClear(blkCtrl->memBase, HS_MMCSD_STAT_TRNFCOMP);
+	HSMMCSDDataTimeoutSet(blkCtrl->memBase, HS_MMCSD_DATA_TIMEOUT(27));
+
+	HSMMCSDCommandSend(blkCtrl->memBase, cmd, address, (void *) 1, blkChunk,
+			blkCtrl->dmaEnable);
+}
+
+/*
+ * Finishes the chunk on the bus, completes the head request if it was the
+ * last chunk or failed and starts the next chunk or request.
+ */
+static void SdBlkChunkDone(uint32_t ok) {
+	SdBlkReq *req = blkHead;
+
+	blkCtrl->dmaEnable = 0;
+
+	if (ok) {
+		req->done += blkChunk;
+	} else {
+		/**
+		 * Stop the channel of the failed chunk and drop its pending
+		 * events, a late completion must not finish the next chunk.
+		 */
+		EDMA3DisableTransfer(blkEdmaBase, blkDmaChan, EDMA3_TRIG_MODE_EVENT);
+		EDMA3ClrEvt(blkEdmaBase, blkDmaChan);
+		EDMA3ClrIntr(blkEdmaBase, blkDmaChan);
+
+		/* Bring the controller back into a defined state */
+		HSMMCSDLinesReset(blkCtrl->memBase,
+				HS_MMCSD_DATALINE_RESET | HS_MMCSD_CMDLINE_RESET);
+	}
+
+	if (ok && req->done < req->count) {
+		SdBlkStart();
+		return;
+	}
+
+	blkHead = req->next;
+	if (NULL == blkHead) {
+		blkTail = NULL;
+	}
+
+	req->status = ok ? SD_BLK_STATUS_OK : SD_BLK_STATUS_ERROR;
+
+	if (NULL != req->callback) {
+		req->callback(req);
+	}
+
+	if (NULL != blkHead) {
+		SdBlkStart();
+	}
+}
+
+/**
+ * \brief Controller interrupt hook, called by the MMC/SD ISR while active
+ *
+ * \param status		MMCHS_STAT value of the interrupt
+ */
+void SdBlkCtrlEvent(uint32_t status) {
+	if (NULL == blkHead) {
+		return;
+	}
+
+	if (status & (HS_MMCSD_STAT_ERR | HS_MMCSD_STAT_ACMD12ERR)) {
+		SdBlkChunkDone(0);
+		return;
+	}
+
+	if (status & HS_MMCSD_STAT_TRNFCOMP) {
+		blkXferDone = 1;
+
+		if (blkDmaDone) {
+			SdBlkChunkDone(1);
+		}
+	}
+}
+
+/**
+ * \brief EDMA completion hook, called by the EDMA callback while active
+ *
+ * TCC errors are reported to the callbacks of all channels, events of the
+ * channel which is not on the bus are ignored.
+ *
+ * \param tcc		channel of the callback
+ * \param ok		0 if the EDMA reported an error for the channel
+ */
+void SdBlkDmaEvent(uint32_t tcc, uint32_t ok) {
+	if (NULL == blkHead || tcc != blkDmaChan) {
+		return;
+	}
+
+	if (!ok) {
+		SdBlkChunkDone(0);
+		return;
+	}
+
+	EDMA3DisableTransfer(blkEdmaBase, blkDmaChan, EDMA3_TRIG_MODE_EVENT);
+	blkDmaDone = 1;
+
+	if (blkXferDone) {
+		SdBlkChunkDone(1);
+	}
+}
+
+/**
+ * \brief Measures sequential read throughput at a given queue depth
+ *
+ * Reads numReq requests of blksPerReq blocks starting at lba with at most
+ * depth requests queued. While waiting the CPU spins in an idle loop whose
+ * iterations are counted; comparing depth 1 with higher depths shows both
+ * the throughput gain and the CPU time which can be used for other work.
+ *
+ * \param lba			first block
+ * \param blksPerReq	blocks per request
+ * \param numReq		number of requests
+ * \param depth			queue depth (1 - 8)
+ * \param buf			buffer of depth * blksPerReq * 512 bytes
+ * \param result		measured values
+ *
+ * \return TRUE on success, FALSE on invalid parameters or a failed read
+ */
+int32_t SdBlkBench(uint32_t lba, uint32_t blksPerReq, uint32_t numReq,
+		uint32_t depth, uint8_t *buf, SdBlkBenchResult *result) {
+	static SdBlkReq reqs[SD_BLK_BENCH_MAX_DEPTH];
+	uint32_t submitted = 0;
+	uint32_t completed = 0;
+	uint32_t stamp;
+	uint32_t i;
+	int32_t retVal = TRUE;
+
+	if (0 == depth || depth > SD_BLK_BENCH_MAX_DEPTH || 0 == blksPerReq
+			|| 0 == numReq || NULL == buf || NULL == result || !SdBlkIdle()) {
+		return FALSE;
+	}
+
+	result->idleLoops = 0;
+	stamp = WatchCycleCountGet();
+
+	for (i = 0; i < depth && submitted < numReq; i++, submitted++) {
+		reqs[i].lba = lba + submitted * blksPerReq;
+		reqs[i].count = blksPerReq;
+		reqs[i].buf = buf + i * blksPerReq * SD_BLK_SIZE;
+		reqs[i].dir = SD_BLK_READ;
+		reqs[i].callback = NULL;
+		SdBlkSubmit(&reqs[i]);
+	}
+
+	while (completed < numReq) {
+		for (i = 0; i < depth; i++) {
+			if (SD_BLK_STATUS_PENDING == reqs[i].status || 0 == reqs[i].count) {
+				continue;
+			}
+
+			if (SD_BLK_STATUS_ERROR == reqs[i].status) {
+				retVal = FALSE;
+			}
+
+			completed++;
+
+			if (submitted < numReq) {
+				reqs[i].lba = lba + submitted * blksPerReq;
+				SdBlkSubmit(&reqs[i]);
+				submitted++;
+			} else {
+				reqs[i].count = 0;
+			}
+		}
+
+		result->idleLoops++;
+	}
+
+	result->cycles = WatchCycleCountGet() - stamp;
+	result->bytes = numReq * blksPerReq * SD_BLK_SIZE;
+
+	for (i = 0; i < depth; i++) {
+		reqs[i].count = 0;
+	}
+
+	return retVal;
+}
@@ -0,0 +1,76 @@
+/*
+ * Driver: dr_sd_blk.h
+ * Part of BRO Project, 2014 <<https://github.com/BRO-FHV>>
+ *
+ * Created on: 19.10.2014
+ * Description:
+ * Asynchronous block I/O queue in front of the MMC/SD controller.
+ *
+ * Requests are submitted with SdBlkSubmit and processed in order. Every
+ * request is a single CMD17/18 or CMD24/25 per 65535 blocks terminated by
+ * Auto CMD12, completion is signalled by the controller interrupt and the
+ * EDMA callback and the next request is started from interrupt context.
+ * The callback of a request is called in interrupt context as well.
+ *
+ * NOTE: The synchronous MMCSDReadCmdSend/MMCSDWriteCmdSend must not be
+ * used while requests are queued (see SdBlkIdle).
+ */
+
+#ifndef DR_SD_BLK_H_
+#define DR_SD_BLK_H_
+
+#include <inttypes.h>
+#include "toSort/mmcsd_proto.h"
+
+#define SD_BLK_READ				1
+#define SD_BLK_WRITE			0
+
+/* Request status */
+#define SD_BLK_STATUS_OK		0
+#define SD_BLK_STATUS_PENDING	1
+#define SD_BLK_STATUS_ERROR		2
+
+struct SdBlkReq;
+
+typedef void (*SdBlkCallback)(struct SdBlkReq *req);
+
+typedef struct SdBlkReq {
+	uint32_t lba;
+	uint32_t count;
+	void *buf;
+	uint8_t dir;
+
+	SdBlkCallback callback;
+	void *ctx;
+
+	/* Set by the driver */
+	volatile uint32_t status;
+	uint32_t done;
+	struct SdBlkReq *next;
+} SdBlkReq;
+
+/* Result of SdBlkBench, times in CPU cycles */
+typedef struct {
+	uint32_t cycles;
+	uint32_t bytes;
+	/* Iterations of the idle loop, i.e. CPU time left while waiting */
+	uint32_t idleLoops;
+} SdBlkBenchResult;
+
+void SdBlkInit(mmcsdCtrlInfo *ctrl, uint32_t edmaBase, uint32_t rxChan,
+		uint32_t txChan);
+
+int32_t SdBlkSubmit(SdBlkReq *req);
+
+uint32_t SdBlkIdle(void);
+
+uint32_t SdBlkActive(void);
+
+void SdBlkCtrlEvent(uint32_t status);
+
+void SdBlkDmaEvent(uint32_t tcc, uint32_t ok);
+
+int32_t SdBlkBench(uint32_t lba, uint32_t blksPerReq, uint32_t numReq,
+		uint32_t depth, uint8_t *buf, SdBlkBenchResult *result);
+
+#endif /* DR_SD_BLK_H_ */
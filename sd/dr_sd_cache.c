@@ -0,0 +1,362 @@
+/*
+ * Driver: dr_sd_cache.c
+ * Part of BRO Project, 2014 <<https://github.com/BRO-FHV>>
+ *
+ * Created on: 19.10.2014
+ * Description:
+ * Implementation of the sector cache. Every line holds one sector, the set
+ * of a sector is its lowest bits so a sequential run spreads over all sets.
+ * LRU uses an access stamp per line, the oldest line of a set is replaced.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <basic.h>
+#include "dr_sd_cache.h"
+
+#define SD_CACHE_LINES			(SD_CACHE_SETS * SD_CACHE_WAYS)
+#define SD_CACHE_SET(sector)	((sector) & (SD_CACHE_SETS - 1))
+
+/* Sequential misses before read ahead starts */
+#define SD_CACHE_SEQ_THRESHOLD	2
+
+typedef struct {
+	uint32_t sector;
+	uint32_t stamp;
+	uint8_t valid;
+	uint8_t dirty;
+} SdCacheLine;
+
+/* Lines and buffers are DMA targets */
+#pragma DATA_ALIGN(cacheData, 128)
+static uint8_t cacheData[SD_CACHE_LINES][SD_CACHE_SECTOR_SIZE];
+#pragma DATA_ALIGN(raBuf, 128)
+static uint8_t raBuf[SD_CACHE_RA_MAX * SD_CACHE_SECTOR_SIZE];
+
+static SdCacheLine cacheLines[SD_CACHE_LINES];
+static SdCacheStats cacheStats;
+
+static SdCacheIo cacheIo;
+static void *cacheCtx;
+static uint32_t cachePolicy;
+static uint32_t cacheStamp;
+
+static uint32_t raSectors;
+static uint32_t seqNext;
+static uint32_t seqCount;
+
+static int32_t SdCacheLookup(uint32_t sector);
+static int32_t SdCacheAlloc(uint32_t sector);
+static int32_t SdCacheLineFlush(uint32_t line);
+
+/**
+ * \brief Initializes the cache, all lines are invalid afterwards
+ *
+ * \param io			block device access
+ * \param ctx			passed to io
+ * \param policy		SD_CACHE_WRITE_THROUGH or SD_CACHE_WRITE_BACK
+ */
+void SdCacheInit(SdCacheIo io, void *ctx, uint32_t policy) {
+	cacheIo = io;
+	cacheCtx = ctx;
+	cachePolicy = policy;
+	raSectors = 0;
+	seqNext = 0;
+	seqCount = 0;
+
+	SdCacheInvalidate();
+	SdCacheStatsReset();
+}
+
+/**
+ * \brief Sets the number of sectors read on a sequential miss
+ *
+ * \param sectors		usually the cluster size, 0 or 1 disables read ahead,
+ * 						limited to SD_CACHE_RA_MAX
+ */
+void SdCacheReadAheadSet(uint32_t sectors) {
+	raSectors = (sectors > SD_CACHE_RA_MAX) ? SD_CACHE_RA_MAX : sectors;
+}
+
+/*
+ * Returns the line holding sector or -1 on a miss.
+ */
+static int32_t SdCacheLookup(uint32_t sector) {
+	uint32_t line = SD_CACHE_SET(sector) * SD_CACHE_WAYS;
+	uint32_t way;
+
+	for (way = 0; way < SD_CACHE_WAYS; way++, line++) {
+		if (cacheLines[line].valid && cacheLines[line].sector == sector) {
+			cacheLines[line].stamp = ++cacheStamp;
+			return line;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Writes a dirty line back to the device.
+ */
+static int32_t SdCacheLineFlush(uint32_t line) {
+	if (!cacheLines[line].valid || !cacheLines[line].dirty) {
+		return TRUE;
+	}
+
+	if (!cacheIo(cacheCtx, cacheData[line], cacheLines[line].sector, 1, 1)) {
+		return FALSE;
+	}
+
+	cacheLines[line].dirty = 0;
+	cacheStats.writeBacks++;
+
+	return TRUE;
+}
+
+/*
+ * Replaces the least recently used line of the set of sector. The returned
+ * line is assigned to sector but not valid yet, -1 if the write back of the
+ * victim failed.
+ */
+static int32_t SdCacheAlloc(uint32_t sector) {
+	uint32_t line = SD_CACHE_SET(sector) * SD_CACHE_WAYS;
+	uint32_t victim = line;
+	uint32_t way;
+
+	for (way = 0; way < SD_CACHE_WAYS; way++, line++) {
+		if (!cacheLines[line].valid) {
+			victim = line;
+			break;
+		}
+
+		if (cacheLines[line].stamp < cacheLines[victim].stamp) {
+			victim = line;
+		}
+	}
+
+	if (!SdCacheLineFlush(victim)) {
+		return -1;
+	}
+
+	cacheLines[victim].valid = 0;
+	cacheLines[victim].sector = sector;
+	cacheLines[victim].stamp = ++cacheStamp;
+
+	return victim;
+}
+
+/*
+ * Reads raCount sectors starting at sector with one command and fills the
+ * lines of all sectors not cached yet. The first sector is copied to buf.
+ */
+static int32_t SdCacheReadAhead(uint8_t *buf, uint32_t sector, uint32_t raCount) {
+	int32_t line;
+	uint32_t i;
+
+	if (!cacheIo(cacheCtx, raBuf, sector, raCount, 0)) {
+		return FALSE;
+	}
+
+	for (i = 0; i < raCount; i++) {
+		if (SdCacheLookup(sector + i) >= 0) {
+			/* Cached data is the same or newer (dirty) */
+			continue;
+		}
+
+		line = SdCacheAlloc(sector + i);
+
+		if (line < 0) {
+			return FALSE;
+		}
+
+		memcpy(cacheData[line], raBuf + i * SD_CACHE_SECTOR_SIZE,
+				SD_CACHE_SECTOR_SIZE);
+		cacheLines[line].valid = 1;
+		cacheLines[line].dirty = 0;
+	}
+
+	cacheStats.readAheads++;
+	cacheStats.raSectors += raCount - 1;
+
+	/* The first sector was a miss, a dirty copy can not exist */
+	memcpy(buf, raBuf, SD_CACHE_SECTOR_SIZE);
+
+	return TRUE;
+}
+
+/**
+ * \brief Reads sectors through the cache
+ *
+ * \param buf			destination
+ * \param sector		first sector
+ * \param count			number of sectors
+ *
+ * \return TRUE on success, FALSE if the device failed
+ */
+int32_t SdCacheRead(uint8_t *buf, uint32_t sector, uint32_t count) {
+	int32_t line;
+	uint32_t i;
+
+	if (count > 1) {
+		cacheStats.bypassed += count;
+
+		if (!cacheIo(cacheCtx, buf, sector, count, 0)) {
+			return FALSE;
+		}
+
+		/* Dirty lines are newer than the device */
+		for (i = 0; i < count; i++) {
+			line = SdCacheLookup(sector + i);
+
+			if (line >= 0 && cacheLines[line].dirty) {
+				memcpy(buf + i * SD_CACHE_SECTOR_SIZE, cacheData[line],
+						SD_CACHE_SECTOR_SIZE);
+			}
+		}
+
+		seqNext = sector + count;
+		return TRUE;
+	}
+
+	cacheStats.reads++;
+
+	seqCount = (sector == seqNext) ? seqCount + 1 : 0;
+	seqNext = sector + 1;
+
+	line = SdCacheLookup(sector);
+
+	if (line >= 0) {
+		cacheStats.hits++;
+		memcpy(buf, cacheData[line], SD_CACHE_SECTOR_SIZE);
+		return TRUE;
+	}
+
+	cacheStats.misses++;
+
+	if (raSectors > 1 && seqCount >= SD_CACHE_SEQ_THRESHOLD) {
+		if (SdCacheReadAhead(buf, sector, raSectors)) {
+			return TRUE;
+		}
+		/* Fall back to a single sector, e.g. read ahead beyond the end */
+	}
+
+	line = SdCacheAlloc(sector);
+
+	if (line < 0) {
+		return FALSE;
+	}
+
+	if (!cacheIo(cacheCtx, cacheData[line], sector, 1, 0)) {
+		return FALSE;
+	}
+
+	cacheLines[line].valid = 1;
+	cacheLines[line].dirty = 0;
+
+	memcpy(buf, cacheData[line], SD_CACHE_SECTOR_SIZE);
+
+	return TRUE;
+}
+
+/**
+ * \brief Writes sectors through the cache
+ *
+ * With write back a single sector is only written to its line, it reaches
+ * the device on replacement or SdCacheFlush.
+ *
+ * \param buf			source
+ * \param sector		first sector
+ * \param count			number of sectors
+ *
+ * \return TRUE on success, FALSE if the device failed
+ */
+int32_t SdCacheWrite(const uint8_t *buf, uint32_t sector, uint32_t count) {
+	int32_t line;
+	uint32_t i;
+
+	cacheStats.writes += count;
+
+	if (1 == count && SD_CACHE_WRITE_BACK == cachePolicy) {
+		line = SdCacheLookup(sector);
+
+		if (line < 0) {
+			line = SdCacheAlloc(sector);
+
+			if (line < 0) {
+				return FALSE;
+			}
+		}
+
+		memcpy(cacheData[line], buf, SD_CACHE_SECTOR_SIZE);
+		cacheLines[line].valid = 1;
+		cacheLines[line].dirty = 1;
+
+		return TRUE;
+	}
+
+	if (!cacheIo(cacheCtx, (uint8_t *) buf, sector, count, 1)) {
+		return FALSE;
+	}
+
+	/* Keep cached copies up to date, single sectors are allocated */
+	for (i = 0; i < count; i++) {
+		line = SdCacheLookup(sector + i);
+
+		if (line < 0 && 1 == count) {
+			line = SdCacheAlloc(sector);
+		}
+
+		if (line >= 0) {
+			memcpy(cacheData[line], buf + i * SD_CACHE_SECTOR_SIZE,
+					SD_CACHE_SECTOR_SIZE);
+			cacheLines[line].valid = 1;
+			cacheLines[line].dirty = 0;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief Writes all dirty lines to the device
+ *
+ * \return TRUE on success, FALSE if the device failed
+ */
+int32_t SdCacheFlush(void) {
+	int32_t retVal = TRUE;
+	uint32_t line;
+
+	for (line = 0; line < SD_CACHE_LINES; line++) {
+		if (!SdCacheLineFlush(line)) {
+			retVal = FALSE;
+		}
+	}
+
+	return retVal;
+}
+
+/**
+ * \brief Drops all lines without writing them back, e.g. on card change
+ */
+void SdCacheInvalidate(void) {
+	memset(cacheLines, 0, sizeof(cacheLines));
+	cacheStamp = 0;
+}
+
+/**
+ * \brief Returns the statistics including hit rate and saved bytes
+ */
+void SdCacheStatsGet(SdCacheStats *stats) {
+	*stats = cacheStats;
+
+	stats->hitRate = (0 == cacheStats.reads) ? 0 :
+			(uint32_t) (((uint64_t) cacheStats.hits * 100) / cacheStats.reads);
+	stats->bytesSaved = cacheStats.hits * SD_CACHE_SECTOR_SIZE;
+}
+
+/**
+ * \brief Clears the statistics
+ */
+void SdCacheStatsReset(void) {
+	memset(&cacheStats, 0, sizeof(cacheStats));
+}
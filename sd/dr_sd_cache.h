@@ -0,0 +1,86 @@
+/*
+ * Driver: dr_sd_cache.h
+ * Part of BRO Project, 2014 <<https://github.com/BRO-FHV>>
+ *
+ * Created on: 19.10.2014
+ * Description:
+ * N-way set associative sector cache between FatFs (disk_read/disk_write)
+ * and the block device.
+ *
+ * Single sector requests (FAT, directory and file buffer sectors) are
+ * served from the cache, a line is replaced by LRU within its set. A miss
+ * which continues a sequential run reads ahead up to a cluster with one
+ * multi block command. Multi sector requests bypass the cache, cached
+ * lines of the range are kept coherent.
+ *
+ * The device is accessed through a SdCacheIo function only, so the cache
+ * does not depend on the MMC/SD driver and can run against a RAM disk.
+ */
+
+#ifndef DR_SD_CACHE_H_
+#define DR_SD_CACHE_H_
+
+#include <inttypes.h>
+
+/* Geometry, SD_CACHE_SETS must be a power of two */
+#ifndef SD_CACHE_SETS
+#define SD_CACHE_SETS			16
+#endif
+#ifndef SD_CACHE_WAYS
+#define SD_CACHE_WAYS			4
+#endif
+
+/* Upper limit of sectors read ahead, the read ahead buffer has this size */
+#ifndef SD_CACHE_RA_MAX
+#define SD_CACHE_RA_MAX			16
+#endif
+
+#define SD_CACHE_SECTOR_SIZE	512
+
+/* Write policy */
+#define SD_CACHE_WRITE_THROUGH	0
+#define SD_CACHE_WRITE_BACK		1
+
+#ifndef SD_CACHE_POLICY
+#define SD_CACHE_POLICY			SD_CACHE_WRITE_THROUGH
+#endif
+
+/*
+ * Block device access, returns TRUE on success.
+ * write is 1 for writes, buf is then only read.
+ */
+typedef int32_t (*SdCacheIo)(void *ctx, uint8_t *buf, uint32_t sector,
+		uint32_t count, uint32_t write);
+
+typedef struct {
+	uint32_t reads;			/* sectors requested by single sector reads */
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t readAheads;	/* read ahead commands */
+	uint32_t raSectors;		/* sectors prefetched */
+	uint32_t writes;		/* sectors written by the file system */
+	uint32_t writeBacks;	/* dirty lines written to the device */
+	uint32_t bypassed;		/* sectors of multi sector requests */
+
+	/* Derived by SdCacheStatsGet */
+	uint32_t hitRate;		/* in percent */
+	uint32_t bytesSaved;	/* device reads avoided by hits */
+} SdCacheStats;
+
+void SdCacheInit(SdCacheIo io, void *ctx, uint32_t policy);
+
+void SdCacheReadAheadSet(uint32_t sectors);
+
+int32_t SdCacheRead(uint8_t *buf, uint32_t sector, uint32_t count);
+
+int32_t SdCacheWrite(const uint8_t *buf, uint32_t sector, uint32_t count);
+
+int32_t SdCacheFlush(void);
+
+void SdCacheInvalidate(void);
+
+void SdCacheStatsGet(SdCacheStats *stats);
+
+void SdCacheStatsReset(void);
+
+#endif /* DR_SD_CACHE_H_ */
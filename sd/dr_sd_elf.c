@@ -0,0 +1,384 @@
+/*
+ * Driver: dr_sd_elf.c
+ * Part of BRO Project, 2014 <<https://github.com/BRO-FHV>>
+ *
+ * Created on: 19.10.2014
+ * Description:
+ * Implementation of the streaming ELF loader. A segment is read with
+ * f_read directly at its destination, FatFs transfers whole sectors into
+ * the caller buffer without copying and reads a contiguous cluster run with
+ * one command when the file has an extent map. Only a partial first and
+ * last sector of a segment go through the file buffer, so the DMA never
+ * writes a cache line the CPU shares with memory outside of the segment.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <basic.h>
+#include "soc_AM335x.h"
+#include "cache.h"
+#include "../edma/edma.h"
+#include "../watch/dr_watch.h"
+#include "thirdParty/fatfs/src/ff.h"
+#include "dr_sd_elf.h"
+
+#define SD_ELF_SECTOR			512
+
+/* Largest f_read, a multiple of the sector size below 64k */
+#define SD_ELF_READ_CHUNK		(127 * SD_ELF_SECTOR)
+
+/* f_read below a sector, FatFs copies it through the file buffer */
+#define SD_ELF_CPU_CHUNK		(SD_ELF_SECTOR / 2)
+
+/* D-cache line of the Cortex-A8 */
+#define SD_ELF_CACHE_LINE		64
+
+#define SD_ELF_CLASS32			1
+#define SD_ELF_DATA2LSB			1
+#define SD_ELF_EXEC				2
+#define SD_ELF_MACHINE_ARM		40
+#define SD_ELF_PT_LOAD			1
+
+#define SD_ELF_CRC_POLY			0xEDB88320
+
+typedef struct {
+	uint8_t ident[16];
+	uint16_t type;
+	uint16_t machine;
+	uint32_t version;
+	uint32_t entry;
+	uint32_t phoff;
+	uint32_t shoff;
+	uint32_t flags;
+	uint16_t ehsize;
+	uint16_t phentsize;
+	uint16_t phnum;
+	uint16_t shentsize;
+	uint16_t shnum;
+	uint16_t shstrndx;
+} SdElfEhdr;
+
+typedef struct {
+	uint32_t type;
+	uint32_t offset;
+	uint32_t vaddr;
+	uint32_t paddr;
+	uint32_t filesz;
+	uint32_t memsz;
+	uint32_t flags;
+	uint32_t align;
+} SdElfPhdr;
+
+static FIL elfFile;
+static SdElfPhdr elfPhdrs[SD_ELF_MAX_PHDRS];
+static FEXTENT elfExtents[SD_ELF_MAX_EXTENTS];
+
+static uint32_t crcTable[256];
+static uint32_t crcTableValid;
+
+static int32_t SdElfRead(uint32_t offset, uint8_t *buf, uint32_t len,
+		uint32_t chunkMax, uint32_t *crc);
+static int32_t SdElfSegmentRead(const SdElfPhdr *ph, uint8_t *dst,
+		uint32_t *crc);
+static int32_t SdElfSegmentClear(uint8_t *dst, uint32_t len);
+static uint32_t SdElfSplit(uint32_t addr, uint32_t len, uint32_t align,
+		uint32_t *tail);
+static int32_t SdElfInRam(uint32_t addr, uint32_t len);
+static int32_t SdElfHeaderCheck(const SdElfEhdr *ehdr);
+
+/**
+ * \brief Loads the PT_LOAD segments of an ELF image to their addresses
+ *
+ * The segments are loaded to their physical addresses (p_paddr), which must
+ * lie in the DDR or the OCMC RAM, nothing checks that the memory is free.
+ * The D-cache lines of the segments are cleaned and invalidated before the
+ * DMA and cleaned again after all CPU writes. The DMA only writes whole
+ * lines, the partial lines at both ends of the file data and of the .bss are
+ * written by the CPU. The I-cache is invalidated after loading, so the image
+ * can be started at info->entry right away.
+ *
+ * \param path			file name
+ * \param flags			SD_ELF_VERIFY_CRC or 0
+ * \param crc			expected CRC-32 of the segment data, see SdElfCrc
+ * \param info			filled with entry point, sizes and the CRC
+ *
+ * \return TRUE on success, FALSE if the file could not be read, is no ARM
+ * executable, a segment lies outside RAM or the CRC does not match
+ */
+int32_t SdElfLoad(const char *path, uint32_t flags, uint32_t crc,
+		SdElfInfo *info) {
+	SdElfEhdr ehdr;
+	SdElfPhdr *ph;
+	uint8_t *dst;
+	uint32_t stamp;
+	uint32_t i;
+	FRESULT result;
+	int32_t retVal = FALSE;
+
+	memset(info, 0, sizeof(*info));
+
+	WatchCycleCounterInit();
+	stamp = WatchCycleCountGet();
+
+	result = f_open(&elfFile, path, FA_READ);
+
+	if (FR_OK != result) {
+		printf("ELF: File could not be opened! FRESULT: %d\n", result);
+		return FALSE;
+	}
+
+	/* Fast seeks between segments, without the map it is only slower */
+	f_extmap(&elfFile, elfExtents, SD_ELF_MAX_EXTENTS);
+
+	if (!SdElfRead(0, (uint8_t *) &ehdr, sizeof(ehdr), SD_ELF_READ_CHUNK,
+			NULL)
+			|| !SdElfHeaderCheck(&ehdr)) {
+		printf("ELF: %s is no ARM executable\n", path);
+		goto close;
+	}
+
+	if (!SdElfRead(ehdr.phoff, (uint8_t *) elfPhdrs,
+			ehdr.phnum * sizeof(SdElfPhdr), SD_ELF_READ_CHUNK, NULL)) {
+		printf("ELF: Program headers could not be read\n");
+		goto close;
+	}
+
+	info->entry = ehdr.entry;
+	info->crc = 0xFFFFFFFF;
+
+	for (i = 0; i < ehdr.phnum; i++) {
+		ph = &elfPhdrs[i];
+
+		if (SD_ELF_PT_LOAD != ph->type || 0 == ph->memsz) {
+			continue;
+		}
+
+		if (ph->filesz > ph->memsz) {
+			printf("ELF: Segment %u is larger in the file\n", i);
+			goto close;
+		}
+
+		if (!SdElfInRam(ph->paddr, ph->memsz)) {
+			printf("ELF: Segment %u at 0x%08x is outside RAM\n", i, ph->paddr);
+			goto close;
+		}
+
+		dst = (uint8_t *) ph->paddr;
+
+		CacheDataCleanInvalidateBuff((uint32_t) dst, ph->memsz);
+
+		if (ph->filesz && !SdElfSegmentRead(ph, dst, &info->crc)) {
+			printf("ELF: Segment %u could not be read\n", i);
+			goto close;
+		}
+
+		if (ph->memsz > ph->filesz
+				&& !SdElfSegmentClear(dst + ph->filesz,
+						ph->memsz - ph->filesz)) {
+			printf("ELF: Segment %u could not be cleared\n", i);
+			goto close;
+		}
+
+		/* Partial sectors were copied by the CPU, the I-side reads memory */
+		CacheDataCleanBuff((uint32_t) dst, ph->memsz);
+
+		info->segments++;
+		info->fileBytes += ph->filesz;
+		info->zeroBytes += ph->memsz - ph->filesz;
+	}
+
+	CacheInstInvalidateAll();
+
+	info->crc ^= 0xFFFFFFFF;
+
+	if ((flags & SD_ELF_VERIFY_CRC) && info->crc != crc) {
+		printf("ELF: CRC mismatch, 0x%08x expected 0x%08x\n", info->crc, crc);
+		goto close;
+	}
+
+	retVal = TRUE;
+
+	close:
+	f_close(&elfFile);
+
+	info->cycles = WatchCycleCountGet() - stamp;
+
+	return retVal;
+}
+
+/**
+ * \brief Updates a CRC-32 (IEEE 802.3) with a buffer
+ *
+ * Start with 0xFFFFFFFF and invert the result, SdElfLoad computes the CRC
+ * over the file data of all PT_LOAD segments in program header order.
+ *
+ * \param crc			running CRC
+ * \param buf			data
+ * \param len			number of bytes
+ *
+ * \return updated CRC
+ */
+uint32_t SdElfCrc(uint32_t crc, const uint8_t *buf, uint32_t len) {
+	uint32_t i, j, c;
+
+	if (!crcTableValid) {
+		for (i = 0; i < 256; i++) {
+			c = i;
+
+			for (j = 0; j < 8; j++) {
+				c = (c & 1) ? (c >> 1) ^ SD_ELF_CRC_POLY : c >> 1;
+			}
+
+			crcTable[i] = c;
+		}
+
+		crcTableValid = 1;
+	}
+
+	while (len--) {
+		crc = crcTable[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+/*
+ * Reads the file data of a segment to dst. Whole sectors go to the segment
+ * by DMA, the bytes before the first and after the last sector boundary of
+ * dst are copied by the CPU through the file buffer: their cache lines may
+ * hold memory outside of the segment. A segment whose file offset is not
+ * aligned like its address would get sectors at unaligned addresses, it is
+ * copied by the CPU completely.
+ */
+static int32_t SdElfSegmentRead(const SdElfPhdr *ph, uint8_t *dst,
+		uint32_t *crc) {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t chunk = SD_ELF_READ_CHUNK;
+
+	head = SdElfSplit((uint32_t) dst, ph->filesz, SD_ELF_SECTOR, &tail);
+
+	if ((ph->offset ^ ph->paddr) & (SD_ELF_SECTOR - 1)) {
+		chunk = SD_ELF_CPU_CHUNK;
+	}
+
+	return SdElfRead(ph->offset, dst, head, SD_ELF_CPU_CHUNK, crc)
+			&& SdElfRead(ph->offset + head, dst + head,
+					ph->filesz - head - tail, chunk, crc)
+			&& SdElfRead(ph->offset + ph->filesz - tail,
+					dst + ph->filesz - tail, tail, SD_ELF_CPU_CHUNK, crc);
+}
+
+/*
+ * Clears the .bss part of a segment, the EDMA fill writes the whole cache
+ * lines, the CPU the partial lines at both ends.
+ */
+static int32_t SdElfSegmentClear(uint8_t *dst, uint32_t len) {
+	uint32_t head;
+	uint32_t tail;
+
+	head = SdElfSplit((uint32_t) dst, len, SD_ELF_CACHE_LINE, &tail);
+
+	memset(dst, 0, head);
+	memset(dst + len - tail, 0, tail);
+
+	if (len == head + tail) {
+		return TRUE;
+	}
+
+	return EDMA3MemFill(SOC_EDMA30CC_0_REGS, SD_ELF_EDMA_CHAN,
+			EDMA3_QOS_CLASS_BULK, dst + head, 0, len - head - tail);
+}
+
+/*
+ * Splits len bytes at addr at the first and the last multiple of align
+ * inside, returns the bytes before the first and sets tail to the bytes
+ * after the last one. Without a multiple inside all bytes are head.
+ */
+static uint32_t SdElfSplit(uint32_t addr, uint32_t len, uint32_t align,
+		uint32_t *tail) {
+	uint32_t head = (align - (addr & (align - 1))) & (align - 1);
+
+	if (head >= len) {
+		*tail = 0;
+		return len;
+	}
+
+	*tail = (addr + len) & (align - 1);
+
+	return head;
+}
+
+/*
+ * Accepts len bytes at addr if they lie completely in the DDR or in the
+ * OCMC RAM, without overflowing the address.
+ */
+static int32_t SdElfInRam(uint32_t addr, uint32_t len) {
+	if (addr >= SD_ELF_DDR_START && addr - SD_ELF_DDR_START < SD_ELF_DDR_SIZE
+			&& len <= SD_ELF_DDR_SIZE - (addr - SD_ELF_DDR_START)) {
+		return TRUE;
+	}
+
+	if (addr >= SD_ELF_OCMC_START && addr - SD_ELF_OCMC_START < SD_ELF_OCMC_SIZE
+			&& len <= SD_ELF_OCMC_SIZE - (addr - SD_ELF_OCMC_START)) {
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Reads len bytes at offset of the file to buf in f_read calls of at most
+ * chunkMax bytes, updates crc with every chunk if crc is not NULL.
+ */
+static int32_t SdElfRead(uint32_t offset, uint8_t *buf, uint32_t len,
+		uint32_t chunkMax, uint32_t *crc) {
+	WORD chunk;
+	WORD read;
+
+	if (FR_OK != f_lseek(&elfFile, offset) || elfFile.fptr != offset) {
+		return FALSE;
+	}
+
+	while (len) {
+		chunk = (len > chunkMax) ? (WORD) chunkMax : (WORD) len;
+
+		if (FR_OK != f_read(&elfFile, buf, chunk, &read) || read != chunk) {
+			return FALSE;
+		}
+
+		if (NULL != crc) {
+			*crc = SdElfCrc(*crc, buf, chunk);
+		}
+
+		buf += chunk;
+		len -= chunk;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Accepts 32 bit little endian ARM executables whose program headers fit
+ * into elfPhdrs.
+ */
+static int32_t SdElfHeaderCheck(const SdElfEhdr *ehdr) {
+	if (0x7F != ehdr->ident[0] || 'E' != ehdr->ident[1]
+			|| 'L' != ehdr->ident[2] || 'F' != ehdr->ident[3]) {
+		return FALSE;
+	}
+
+	if (SD_ELF_CLASS32 != ehdr->ident[4] || SD_ELF_DATA2LSB != ehdr->ident[5]
+			|| SD_ELF_EXEC != ehdr->type
+			|| SD_ELF_MACHINE_ARM != ehdr->machine) {
+		return FALSE;
+	}
+
+	if (sizeof(SdElfPhdr) != ehdr->phentsize || 0 == ehdr->phnum
+			|| ehdr->phnum > SD_ELF_MAX_PHDRS) {
+		return FALSE;
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,74 @@
+/*
+ * Driver: dr_sd_elf.h
+ * Part of BRO Project, 2014 <<https://github.com/BRO-FHV>>
+ *
+ * Created on: 19.10.2014
+ * Description:
+ * Streaming ELF loader on FatFs.
+ *
+ * Only the ELF header and the program headers are read into RAM. Every
+ * PT_LOAD segment is read from the file straight to its physical address,
+ * whole sectors go from the card to the segment by DMA with multi block
+ * reads, and the .bss part (p_memsz beyond p_filesz) is cleared by an EDMA
+ * fill. A CRC-32 over the loaded file data can be verified on the way.
+ */
+
+#ifndef DR_SD_ELF_H_
+#define DR_SD_ELF_H_
+
+#include <inttypes.h>
+
+/* Upper limit of program headers of an image */
+#ifndef SD_ELF_MAX_PHDRS
+#define SD_ELF_MAX_PHDRS		16
+#endif
+
+/* Entries of the cluster extent map, a more fragmented file is loaded without */
+#ifndef SD_ELF_MAX_EXTENTS
+#define SD_ELF_MAX_EXTENTS		32
+#endif
+
+/*
+ * Manually triggered EDMA channel used to clear .bss. The loader owns it only
+ * while SdElfLoad runs: EDMA3MemFill requests it with EDMA3RequestChannel for
+ * each fill and frees it afterwards, and fails if another client registered
+ * a callback on it. edma_event.h maps no peripheral event to channel 20 and
+ * no other driver of the project uses it; override it if that changes.
+ */
+#ifndef SD_ELF_EDMA_CHAN
+#define SD_ELF_EDMA_CHAN		20
+#endif
+
+/*
+ * RAM a segment may be loaded to: the DDR the MMU setup of dr_sd.c maps and
+ * the 64k of OCMC RAM. Segments reaching outside both are rejected.
+ */
+#ifndef SD_ELF_DDR_START
+#define SD_ELF_DDR_START		0x80000000
+#define SD_ELF_DDR_SIZE			0x20000000
+#endif
+
+#ifndef SD_ELF_OCMC_START
+#define SD_ELF_OCMC_START		0x40300000
+#define SD_ELF_OCMC_SIZE		0x10000
+#endif
+
+/* Flags of SdElfLoad */
+#define SD_ELF_VERIFY_CRC		0x1		/* compare the CRC with the expected one */
+
+/* Result of SdElfLoad */
+typedef struct {
+	uint32_t entry;			/* e_entry of the image */
+	uint32_t segments;		/* PT_LOAD segments loaded */
+	uint32_t fileBytes;		/* bytes read into segments */
+	uint32_t zeroBytes;		/* .bss bytes cleared */
+	uint32_t crc;			/* CRC-32 of the segment data in header order */
+	uint32_t cycles;		/* time of the load in CPU cycles */
+} SdElfInfo;
+
+int32_t SdElfLoad(const char *path, uint32_t flags, uint32_t crc,
+		SdElfInfo *info);
+
+uint32_t SdElfCrc(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#endif /* DR_SD_ELF_H_ */
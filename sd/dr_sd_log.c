@@ -0,0 +1,287 @@
+/*
+ * Driver: dr_sd_log.c
+ * Part of BRO Project, 2014 <<https://github.com/BRO-FHV>>
+ *
+ * Created on: 19.10.2014
+ * Description:
+ * Implementation of the log appender. The active buffer of an empty start
+ * takes only the bytes up to the next sector boundary beyond its size, so
+ * all following buffers reach FatFs sector aligned and go straight from the
+ * buffer to the card without a copy through the file buffer.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <basic.h>
+#include "cache.h"
+#include "../watch/dr_watch.h"
+#include "thirdParty/fatfs/src/ff.h"
+#include "dr_sd_log.h"
+
+#define SD_LOG_SECTOR_SIZE		512
+
+/* Largest f_write, a multiple of the sector size below 64k */
+#define SD_LOG_WRITE_CHUNK		(127 * SD_LOG_SECTOR_SIZE)
+
+static int32_t SdLogDrain(SdLog *log, uint32_t idx);
+
+/**
+ * \brief Opens a log file
+ *
+ * \param log			log object, on a cache line boundary
+ * \param path			file name
+ * \param buf			buffer, DMA source so cache line aligned
+ * \param size			size of buf, at least one sector per buffer
+ * \param flags			SD_LOG_APPEND, SD_LOG_DOUBLE_BUFFER or 0
+ *
+ * \return TRUE on success, FALSE if the file could not be opened
+ */
+int32_t SdLogOpen(SdLog *log, const char *path, uint8_t *buf, uint32_t size,
+		uint32_t flags) {
+	BYTE mode;
+	FRESULT result;
+
+	memset(log, 0, sizeof(*log));
+
+	/* Time base of maxFlushCycles */
+	WatchCycleCounterInit();
+
+	if (flags & SD_LOG_DOUBLE_BUFFER) {
+		size /= 2;
+	}
+
+	size &= ~(SD_LOG_SECTOR_SIZE - 1);
+
+	if (0 == size) {
+		printf("LOG: Buffer is smaller than a sector\n");
+		return FALSE;
+	}
+
+	log->buf[0] = buf;
+	log->buf[1] = (flags & SD_LOG_DOUBLE_BUFFER) ? buf + size : NULL;
+	log->size = size;
+	log->flags = flags;
+
+	mode = FA_WRITE
+			| ((flags & SD_LOG_APPEND) ? FA_OPEN_ALWAYS : FA_CREATE_ALWAYS);
+	result = f_open(&log->file, path, mode);
+
+	if (FR_OK != result) {
+		printf("LOG: File could not be opened! FRESULT: %d\n", result);
+		return FALSE;
+	}
+
+	if ((flags & SD_LOG_APPEND)
+			&& FR_OK != f_lseek(&log->file, log->file.fsize)) {
+		printf("LOG: End of %s could not be reached\n", path);
+		f_close(&log->file);
+		return FALSE;
+	}
+
+	log->offset = log->file.fptr;
+	log->allocEnd = log->file.fptr;
+
+	return TRUE;
+}
+
+/**
+ * \brief Appends data to the log
+ *
+ * A single buffer is written as soon as it is full. With double buffering a
+ * full buffer is only queued for SdLogService. If both buffers are full the
+ * rest of the data is dropped and counted as overrun.
+ *
+ * \param log			log object
+ * \param data			data to append
+ * \param len			number of bytes
+ *
+ * \return TRUE on success, FALSE on an overrun or a write error
+ */
+int32_t SdLogWrite(SdLog *log, const void *data, uint32_t len) {
+	const uint8_t *src = data;
+	uint32_t idx;
+	uint32_t n;
+
+	while (len) {
+		idx = log->active;
+
+		if (log->full[idx]) {
+			log->stats.overruns++;
+			log->stats.dropped += len;
+			return FALSE;
+		}
+
+		if (0 == log->fill[idx]) {
+			/* End the buffer on a sector boundary of the file */
+			log->cap = log->size - (log->offset & (SD_LOG_SECTOR_SIZE - 1));
+		}
+
+		n = log->cap - log->fill[idx];
+
+		if (n > len) {
+			n = len;
+		}
+
+		memcpy(log->buf[idx] + log->fill[idx], src, n);
+		log->fill[idx] += n;
+		log->offset += n;
+		src += n;
+		len -= n;
+
+		if (log->fill[idx] < log->cap) {
+			continue;
+		}
+
+		if (log->flags & SD_LOG_DOUBLE_BUFFER) {
+			log->full[idx] = 1;
+			log->active = idx ^ 1;
+		} else if (!SdLogDrain(log, idx)) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief Writes the queued buffers of a double buffered log
+ *
+ * Call from the main loop, SdLogWrite may run in an interrupt meanwhile.
+ *
+ * \param log			log object
+ *
+ * \return TRUE on success, FALSE on a write error
+ */
+int32_t SdLogService(SdLog *log) {
+	while (log->full[log->drain]) {
+		if (!SdLogDrain(log, log->drain)) {
+			return FALSE;
+		}
+
+		log->drain ^= 1;
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief Writes all buffered data and updates the directory entry
+ *
+ * SdLogWrite must not run concurrently.
+ *
+ * \param log			log object
+ *
+ * \return TRUE on success, FALSE on a write error
+ */
+int32_t SdLogFlush(SdLog *log) {
+	if (!SdLogService(log)) {
+		return FALSE;
+	}
+
+	if (log->fill[log->active] && !SdLogDrain(log, log->active)) {
+		return FALSE;
+	}
+
+	return (FR_OK == f_sync(&log->file)) ? TRUE : FALSE;
+}
+
+/**
+ * \brief Flushes the log, releases the clusters allocated ahead and closes
+ * the file
+ *
+ * \param log			log object
+ *
+ * \return TRUE on success, FALSE on a write error
+ */
+int32_t SdLogClose(SdLog *log) {
+	int32_t retVal = SdLogFlush(log);
+
+	if (FR_OK != f_truncate(&log->file)) {
+		retVal = FALSE;
+	}
+
+	if (FR_OK != f_close(&log->file)) {
+		retVal = FALSE;
+	}
+
+	return retVal;
+}
+
+/**
+ * \brief Returns the statistics of the log
+ */
+void SdLogStatsGet(const SdLog *log, SdLogStats *stats) {
+	*stats = log->stats;
+}
+
+/*
+ * Writes buffer idx to the file, allocates the next clusters ahead first
+ * when the buffer goes beyond the allocated ones.
+ */
+static int32_t SdLogDrain(SdLog *log, uint32_t idx) {
+	const uint8_t *src = log->buf[idx];
+	uint32_t len = log->fill[idx];
+	uint32_t stamp;
+	uint32_t cycles;
+	uint32_t chunks;
+	FRESULT result;
+	WORD chunk;
+	WORD written;
+
+	stamp = WatchCycleCountGet();
+
+	if (log->file.fptr + len > log->allocEnd) {
+		log->stats.preallocs++;
+		result = f_prealloc(&log->file, SD_LOG_PREALLOC_BUFS * log->size);
+
+		if (FR_OK == result) {
+			log->allocEnd = log->file.fptr + SD_LOG_PREALLOC_BUFS * log->size;
+		} else {
+			/* Tried again on the next drain, FatFs allocates while writing */
+			log->stats.preallocFails++;
+
+			if (FR_RW_ERROR == result) {
+				printf("LOG: Allocation failed! FRESULT: %d\n", result);
+				return FALSE;
+			}
+		}
+	}
+
+	CacheDataCleanBuff((uint32_t) src, len);
+
+	while (len) {
+		/* Equal chunks, a 64k buffer goes as 2 x 64 sectors, not 127 + 1 */
+		chunks = (len + SD_LOG_WRITE_CHUNK - 1) / SD_LOG_WRITE_CHUNK;
+		chunk = (WORD) (((len / chunks) + SD_LOG_SECTOR_SIZE - 1)
+				& ~(SD_LOG_SECTOR_SIZE - 1));
+
+		if (chunk > len) {
+			chunk = (WORD) len;
+		}
+
+		result = f_write(&log->file, src, chunk, &written);
+
+		if (FR_OK != result || written != chunk) {
+			printf("LOG: Write failed! FRESULT: %d\n", result);
+			return FALSE;
+		}
+
+		src += chunk;
+		len -= chunk;
+	}
+
+	cycles = WatchCycleCountGet() - stamp;
+
+	if (cycles > log->stats.maxFlushCycles) {
+		log->stats.maxFlushCycles = cycles;
+	}
+
+	log->stats.bytes += log->fill[idx];
+	log->stats.flushes++;
+
+	log->fill[idx] = 0;
+	log->full[idx] = 0;
+
+	return TRUE;
+}
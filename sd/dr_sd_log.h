@@ -0,0 +1,77 @@
+/*
+ * Driver: dr_sd_log.h
+ * Part of BRO Project, 2014 <<https://github.com/BRO-FHV>>
+ *
+ * Created on: 19.10.2014
+ * Description:
+ * Write coalescing appender for log and capture files on FatFs.
+ *
+ * Records are copied into a large RAM buffer, a full buffer is written with
+ * f_write as a whole. Clusters are allocated ahead in contiguous runs with
+ * f_prealloc, so FatFs writes a buffer with one multi block command per run
+ * instead of one command per sector or cluster. After the first flush every
+ * flush starts on a sector boundary.
+ *
+ * With SD_LOG_DOUBLE_BUFFER the buffer is split into two halves. A full half
+ * is only queued, SdLogService writes it from the main loop while the
+ * producer fills the other half.
+ */
+
+#ifndef DR_SD_LOG_H_
+#define DR_SD_LOG_H_
+
+#include <inttypes.h>
+#include "thirdParty/fatfs/src/ff.h"
+
+/* Buffers allocated ahead of the file end with f_prealloc */
+#ifndef SD_LOG_PREALLOC_BUFS
+#define SD_LOG_PREALLOC_BUFS	4
+#endif
+
+/* Flags of SdLogOpen */
+#define SD_LOG_APPEND			0x1		/* keep the file and append to it */
+#define SD_LOG_DOUBLE_BUFFER	0x2		/* split the buffer, write from SdLogService */
+
+typedef struct {
+	uint32_t bytes;			/* bytes written to the file */
+	uint32_t flushes;		/* buffers written */
+	uint32_t preallocs;		/* f_prealloc calls */
+	uint32_t preallocFails;	/* f_prealloc calls which failed */
+	uint32_t overruns;		/* SdLogWrite calls which found no free buffer */
+	uint32_t dropped;		/* bytes lost by overruns */
+	uint32_t maxFlushCycles;	/* longest buffer write in CPU cycles */
+} SdLogStats;
+
+/*
+ * Log file, the FIL is the first member and its sector buffer is a DMA
+ * target, so an SdLog must be placed on a cache line boundary.
+ */
+typedef struct {
+	FIL file;
+	uint8_t *buf[2];
+	uint32_t size;			/* bytes per buffer, a multiple of the sector size */
+	uint32_t fill[2];
+	volatile uint32_t full[2];
+	uint32_t active;		/* buffer filled by SdLogWrite */
+	uint32_t drain;			/* next buffer written by SdLogService */
+	uint32_t cap;			/* bytes the active buffer takes */
+	uint32_t offset;		/* file size including buffered data */
+	uint32_t allocEnd;		/* file offset up to which clusters are allocated */
+	uint32_t flags;
+	SdLogStats stats;
+} SdLog;
+
+int32_t SdLogOpen(SdLog *log, const char *path, uint8_t *buf, uint32_t size,
+		uint32_t flags);
+
+int32_t SdLogWrite(SdLog *log, const void *data, uint32_t len);
+
+int32_t SdLogService(SdLog *log);
+
+int32_t SdLogFlush(SdLog *log);
+
+int32_t SdLogClose(SdLog *log);
+
+void SdLogStatsGet(const SdLog *log, SdLogStats *stats);
+
+#endif /* DR_SD_LOG_H_ */
@@ -0,0 +1,9 @@
+/* Host stand-in for basic.h of the BRO project, used by ../../../dr_sd_cache.c */
+
+#ifndef BASIC_H_
+#define BASIC_H_
+
+#define TRUE	1
+#define FALSE	0
+
+#endif /* BASIC_H_ */
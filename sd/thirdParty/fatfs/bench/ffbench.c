@@ -0,0 +1,525 @@
+/*-----------------------------------------------------------------------*/
+/* FatFs benchmark on a host                                             */
+/*-----------------------------------------------------------------------*/
+/* Runs FatFs on a RAM disk or on a card image on a Linux host and reports
+/  the time and the disk commands of every test, so a file system change
+/  can be measured without the target. Build in sd/thirdParty/fatfs:
+/
+/    gcc -O2 -D_USE_MKFS=1 -Isrc -Ibench -I../.. -o ffbench bench/ffbench.c \
+/        src/ff.c src/diskio.c src/diskio_ram.c src/diskio_img.c \
+/        ../../dr_sd_cache.c
+/
+/  ffbench [-i image] [-f] [-m disk MB] [-c cluster sectors] [-s file MB]
+/          [-b buffer bytes] [-n files] [-r random reads] [-a appends]
+/          [-d deep directory entries] [-o hot opens] [-k cache policy]
+/
+/  Without -i a RAM disk is formatted. An image is used as it is, -f
+/  formats it (a new image of -m MB is created if it does not exist).
+/  -k puts the sector cache of the card driver (dr_sd_cache) between FatFs
+/  and the disk, 0 writes through, 1 writes back. The disk columns then
+/  count the requests to the cache, its statistics and the commands that
+/  reach the disk are printed below every test.
+/  Times are wall clock, the disk column is the time spent in the backend.
+/  The random sequence is fixed, so two runs access the same offsets. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ff.h"
+#include "diskio.h"
+#include "dr_sd_cache.h"
+
+
+#if _MULTI_PARTITION
+const PARTITION Drives[_DRIVES] = {{0, 0}, {0, 1}};
+#endif
+
+static FATFS Fs;
+static FIL File, File2;
+static DIR Dir;
+static FILINFO Finfo;
+static BYTE *Buff;
+
+static DISKIO_RAM Ram;
+static DISKIO_IMG Img;
+
+static const DISKIO_OPS *Dev;	/* Disk below the sector cache (NULL: no cache) */
+static DWORD DevReads, DevReadSects, DevWrites, DevWriteSects;
+
+static DWORD Seed = 1;
+static double Start;
+
+
+
+DWORD get_fattime (void)
+{
+	return ((2014UL-1980) << 25) | (10UL << 21) | (19UL << 16);
+}
+
+
+static double now_us (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+static DWORD host_clock (void)	/* Time base of the disk counters in us */
+{
+	return (DWORD)now_us();
+}
+
+
+static DWORD rnd (void)			/* Fixed pseudo random sequence */
+{
+	Seed = Seed * 1103515245 + 12345;
+	return Seed >> 8;
+}
+
+
+static void check (FRESULT res, const char *what)
+{
+	if (res != FR_OK) {
+		printf("%s failed, FRESULT %d\n", what, res);
+		exit(1);
+	}
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Sector cache between FatFs and the disk                               */
+/*-----------------------------------------------------------------------*/
+
+static int32_t cache_io (void *ctx, uint8_t *buf, uint32_t sector, uint32_t count, uint32_t write)
+{
+	if (write) {
+		DevWrites++;
+		DevWriteSects += count;
+		return Dev->write(ctx, buf, sector, (BYTE)count) == RES_OK;
+	}
+	DevReads++;
+	DevReadSects += count;
+	return Dev->read(ctx, buf, sector, (BYTE)count) == RES_OK;
+}
+
+
+static DSTATUS cached_initialize (void *ctx)
+{
+	return Dev->initialize(ctx);
+}
+
+
+static DSTATUS cached_status (void *ctx)
+{
+	return Dev->status(ctx);
+}
+
+
+static DRESULT cached_read (void *ctx, BYTE *buff, DWORD sector, BYTE count)
+{
+	SdCacheReadAheadSet(Fs.sects_clust);	/* As the card driver does */
+	return SdCacheRead(buff, sector, count) ? RES_OK : RES_ERROR;
+}
+
+
+static DRESULT cached_write (void *ctx, const BYTE *buff, DWORD sector, BYTE count)
+{
+	return SdCacheWrite(buff, sector, count) ? RES_OK : RES_ERROR;
+}
+
+
+static DRESULT cached_ioctl (void *ctx, BYTE ctrl, void *buff)
+{
+	if (ctrl == CTRL_SYNC && !SdCacheFlush()) return RES_ERROR;
+	return Dev->ioctl(ctx, ctrl, buff);
+}
+
+
+static const DISKIO_OPS diskio_cached = {
+	cached_initialize, cached_status, cached_read, cached_write, cached_ioctl
+};
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Report a test                                                         */
+/*-----------------------------------------------------------------------*/
+
+static void begin (void)
+{
+	disk_resetstats(0);
+	SdCacheStatsReset();
+	DevReads = DevReadSects = DevWrites = DevWriteSects = 0;
+	Start = now_us();
+}
+
+
+static void end (const char *name, DWORD ops, DWORD bytes)
+{
+	double us = now_us() - Start;
+	DISKIO_STATS st;
+
+	disk_getstats(0, &st);
+	printf("%-12s %7u %9.2f %9.2f %8.2f %7u/%-8u %7u/%-8u %7u %9.2f\n",
+		name, ops, us / 1000, us / ops, bytes ? bytes / us : 0.0,
+		st.read_cmds, st.read_sects, st.write_cmds, st.write_sects, st.seeks,
+		(st.read_ticks + st.write_ticks) / 1000.0);
+	if (Dev) {
+		SdCacheStats cs;
+
+		SdCacheStatsGet(&cs);
+		printf("  cache %3u%% hits %7u/%-7u %9u bytes saved %5u read aheads,"
+			" disk %u/%u read %u/%u write cmd/sect\n",
+			cs.hitRate, cs.hits, cs.reads, cs.bytesSaved, cs.readAheads,
+			DevReads, DevReadSects, DevWrites, DevWriteSects);
+	}
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Tests                                                                 */
+/*-----------------------------------------------------------------------*/
+
+static void bench_mount (void)
+{
+	DWORD i, n = 100;
+
+	begin();
+	for (i = 0; i < n; i++) {
+		f_mount(0, NULL);
+		f_mount(0, &Fs);
+		check(f_opendir(&Dir, ""), "mount");	/* Mounts on first access */
+	}
+	end("mount", n, 0);
+}
+
+
+static void bench_getfree (void)
+{
+	DWORD nclust;
+	FATFS *fs;
+
+	begin();
+	check(f_getfree("", &nclust, &fs), "f_getfree");
+	end("getfree", 1, 0);
+	printf("  %u free clusters of %u sectors\n", nclust, fs->sects_clust);
+}
+
+
+static void bench_seq (DWORD size, WORD bsize)
+{
+	DWORD ofs, ops;
+	WORD n, bw;
+
+	begin();
+	check(f_open(&File, "seq.bin", FA_CREATE_ALWAYS | FA_WRITE), "f_open");
+	for (ofs = ops = 0; ofs < size; ofs += n, ops++) {
+		n = (size - ofs < bsize) ? (WORD)(size - ofs) : bsize;
+		memset(Buff, (BYTE)ops, n);
+		check(f_write(&File, Buff, n, &bw), "f_write");
+		if (bw != n) check(FR_DENIED, "f_write (disk full)");
+	}
+	check(f_close(&File), "f_close");
+	end("seq write", ops, size);
+
+	begin();
+	check(f_open(&File, "seq.bin", FA_READ), "f_open");
+	for (ofs = ops = 0; ofs < size; ofs += n, ops++) {
+		n = (size - ofs < bsize) ? (WORD)(size - ofs) : bsize;
+		check(f_read(&File, Buff, n, &bw), "f_read");
+		if (bw != n || Buff[0] != (BYTE)ops || Buff[n - 1] != (BYTE)ops)
+			check(FR_RW_ERROR, "f_read (data)");
+	}
+	check(f_close(&File), "f_close");
+	end("seq read", ops, size);
+}
+
+
+static void bench_random (DWORD size, DWORD n)
+{
+	static FEXTENT ext[64];
+	DWORD i, ofs;
+	WORD br;
+	BYTE pass;
+
+	for (pass = 0; pass < 2; pass++) {	/* Follow the FAT, then the extent map */
+		check(f_open(&File, "seq.bin", FA_READ), "f_open");
+		if (pass) check(f_extmap(&File, ext, 64), "f_extmap");
+		Seed = 1;
+		begin();
+		for (i = 0; i < n; i++)
+			check(f_lseek(&File, rnd() % size), "f_lseek");
+		end(pass ? "seek extmap" : "seek", n, 0);
+		check(f_close(&File), "f_close");
+	}
+
+	check(f_open(&File, "seq.bin", FA_READ), "f_open");
+	Seed = 1;
+	begin();
+	for (i = 0; i < n; i++) {
+		ofs = rnd() % (size - 512);
+		check(f_lseek(&File, ofs), "f_lseek");
+		check(f_read(&File, Buff, 512, &br), "f_read");
+	}
+	end("random read", n, n * 512);
+	check(f_close(&File), "f_close");
+}
+
+
+static void bench_files (DWORD n)
+{
+	char name[32];
+	DWORD i, cnt;
+	WORD bw;
+
+	check(f_mkdir("many"), "f_mkdir");
+
+	begin();
+	for (i = 0; i < n; i++) {
+		sprintf(name, "many/F%05u.DAT", i);
+		check(f_open(&File, name, FA_CREATE_NEW | FA_WRITE), "f_open");
+		check(f_write(&File, name, 16, &bw), "f_write");
+		check(f_close(&File), "f_close");
+	}
+	end("create", n, 0);
+
+	begin();
+	check(f_opendir(&Dir, "many"), "f_opendir");
+	for (cnt = 0; ; cnt++) {
+		check(f_readdir(&Dir, &Finfo), "f_readdir");
+		if (!Finfo.fname[0]) break;
+	}
+	end("list", cnt, 0);
+	if (cnt != n) check(FR_NO_FILE, "f_readdir (count)");
+
+	Seed = 1;
+	begin();
+	for (i = 0; i < n; i++) {
+		sprintf(name, "many/F%05u.DAT", rnd() % n);
+		check(f_open(&File, name, FA_READ), "f_open");
+	}
+	end("open", n, 0);
+
+	begin();
+	for (i = 0; i < n; i++) {
+		sprintf(name, "many/F%05u.DAT", i);
+		check(f_unlink(name), "f_unlink");
+	}
+	check(f_unlink("many"), "f_unlink");
+	end("delete", n, 0);
+}
+
+
+static void bench_hotpath (DWORD n, DWORD ops)
+{
+	char path[64], *p;
+	DWORD i;
+	WORD bw;
+	BYTE d;
+
+	/* n files at the end of a path eight directories deep, the file opened
+	   over and over is the last one of the directory */
+	p = path;
+	for (d = 0; d < 8; d++) {
+		p += sprintf(p, "%sD%u", d ? "/" : "", d);
+		check(f_mkdir(path), "f_mkdir");
+	}
+	begin();
+	for (i = 0; i < n; i++) {
+		sprintf(p, "/F%05u.DAT", i);
+		check(f_open(&File, path, FA_CREATE_NEW | FA_WRITE), "f_open");
+		check(f_write(&File, path, 16, &bw), "f_write");
+		check(f_close(&File), "f_close");
+	}
+	end("deep create", n, 0);
+
+	begin();
+	for (i = 0; i < ops; i++) {
+		check(f_open(&File, path, FA_READ), "f_open");
+		check(f_close(&File), "f_close");
+	}
+	end("hot open", ops, 0);
+
+	begin();
+	for (i = 0; i < ops; i++)
+		check(f_stat(path, &Finfo), "f_stat");
+	end("hot stat", ops, 0);
+
+	/* More paths than the path cache holds, all at the end of the directory */
+	begin();
+	for (i = 0; i < ops; i++) {
+		sprintf(p, "/F%05u.DAT", n - 1 - i % 64);
+		check(f_stat(path, &Finfo), "f_stat");
+	}
+	end("cold stat", ops, 0);
+
+	for (i = 0; i < n; i++) {
+		sprintf(p, "/F%05u.DAT", i);
+		check(f_unlink(path), "f_unlink");
+	}
+	for (d = 8; d > 0; d--) {
+		*p = 0;
+		check(f_unlink(path), "f_unlink");
+		p = strrchr(path, '/');
+		if (!p) p = path;
+	}
+}
+
+
+static DWORD fill (FIL *fp, DWORD size, WORD bsize)	/* Bytes written, less if the disk is full */
+{
+	DWORD ofs;
+	WORD n, bw;
+
+	memset(Buff, 0x55, bsize);
+	for (ofs = 0; ofs < size; ofs += bw) {
+		n = (size - ofs < bsize) ? (WORD)(size - ofs) : bsize;
+		check(f_write(fp, Buff, n, &bw), "f_write");
+		if (bw != n) return ofs + bw;
+	}
+	return ofs;
+}
+
+
+static void bench_append (DWORD n, WORD bsize)
+{
+	DWORD csize = (DWORD)Fs.sects_clust * 512, nclust, gap, words, size, i;
+	DWORD *map;
+	FATFS *fs;
+	BYTE pass;
+
+	/* Two files grow in turns by one and by gap - 1 clusters until the
+	   volume is full. Deleting the first leaves about n single cluster holes
+	   spread over the volume, each cluster appended to the second one is
+	   searched over gap - 1 clusters in use. */
+	check(f_getfree("", &nclust, &fs), "f_getfree");
+	gap = (n && nclust / n > 2) ? nclust / n : 2;
+	check(f_open(&File, "hole.bin", FA_CREATE_ALWAYS | FA_WRITE), "f_open");
+	check(f_open(&File2, "keep.bin", FA_CREATE_ALWAYS | FA_WRITE), "f_open");
+	while (fill(&File, csize, bsize) == csize
+		&& fill(&File2, (gap - 1) * csize, bsize) == (gap - 1) * csize) ;
+	n = (File.fsize + csize - 1) / csize;
+	size = File2.fsize;
+	check(f_close(&File), "f_close");
+	check(f_close(&File2), "f_close");
+	check(f_unlink("hole.bin"), "f_unlink");
+	printf("  %u holes, one in %u clusters\n", n, gap);
+
+	words = (Fs.max_clust + 31) / 32;
+	map = malloc(words * 4);
+	if (!map) check(FR_NOT_ENABLED, "malloc");
+
+	for (pass = 0; pass < 2; pass++) {	/* Scan the FAT, then the bitmap */
+		f_mount(0, NULL);
+		f_mount(0, &Fs);
+		check(f_freemap(0, pass ? map : NULL, words), "f_freemap");
+		check(f_open(&File, "keep.bin", FA_OPEN_EXISTING | FA_WRITE), "f_open");
+		check(f_lseek(&File, size), "f_lseek");
+		begin();
+		for (i = 0; i < n; i++) {
+			if (fill(&File, csize, bsize) != csize)
+				check(FR_DENIED, "f_write (disk full)");
+		}
+		check(f_close(&File), "f_close");
+		end(pass ? "append fmap" : "append", n, n * csize);
+
+		check(f_open(&File, "keep.bin", FA_OPEN_EXISTING | FA_WRITE), "f_open");
+		check(f_lseek(&File, size), "f_lseek");
+		check(f_truncate(&File), "f_truncate");	/* Give the holes back */
+		check(f_close(&File), "f_close");
+	}
+
+	check(f_freemap(0, NULL, 0), "f_freemap");
+	free(map);
+	check(f_unlink("keep.bin"), "f_unlink");
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Main                                                                  */
+/*-----------------------------------------------------------------------*/
+
+int main (int argc, char *argv[])
+{
+	const char *image = NULL;
+	DWORD disk_mb = 64, file_mb = 8, files = 1000, reads = 2000, appends = 100;
+	DWORD entries = 2000, opens = 2000;
+	WORD bsize = 32768;
+	BYTE csize = 8, format = 0, policy = 0xFF;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-f")) { format = 1; continue; }
+		if (argv[i][0] != '-' || i + 1 >= argc) {
+			printf("usage: %s [-i image] [-f] [-m disk MB] [-c cluster sectors]"
+				" [-s file MB] [-b buffer bytes] [-n files] [-r random reads]"
+				" [-a appends] [-d deep directory entries] [-o hot opens]"
+				" [-k cache policy]\n", argv[0]);
+			return 2;
+		}
+		switch (argv[i++][1]) {
+		case 'i': image = argv[i]; break;
+		case 'm': disk_mb = atoi(argv[i]); break;
+		case 'c': csize = (BYTE)atoi(argv[i]); break;
+		case 's': file_mb = atoi(argv[i]); break;
+		case 'b': bsize = (WORD)atoi(argv[i]); break;
+		case 'n': files = atoi(argv[i]); break;
+		case 'r': reads = atoi(argv[i]); break;
+		case 'a': appends = atoi(argv[i]); break;
+		case 'd': entries = atoi(argv[i]); break;
+		case 'o': opens = atoi(argv[i]); break;
+		case 'k': policy = (BYTE)atoi(argv[i]); break;
+		}
+	}
+
+	Buff = malloc(bsize > 512 ? bsize : 512);
+	if (image) {
+		Img.path = image;
+		Img.sectors = disk_mb * 2048;
+		disk_register(0, &diskio_img, &Img);
+	} else {
+		Ram.sectors = disk_mb * 2048;
+		Ram.data = calloc(Ram.sectors, 512);
+		disk_register(0, &diskio_ram, &Ram);
+		format = 1;
+	}
+	if (policy != 0xFF) {	/* Put the sector cache on top of the disk */
+		Dev = image ? &diskio_img : &diskio_ram;
+		SdCacheInit(cache_io, image ? (void*)&Img : (void*)&Ram,
+			policy ? SD_CACHE_WRITE_BACK : SD_CACHE_WRITE_THROUGH);
+		disk_register(0, &diskio_cached, image ? (void*)&Img : (void*)&Ram);
+	}
+	if (!Buff || (!image && !Ram.data)) {
+		printf("Out of memory\n");
+		return 1;
+	}
+	disk_setclock(host_clock);
+
+	f_mount(0, &Fs);
+	if (format) check(f_mkfs(0, 1, csize), "f_mkfs");
+
+	printf("%s, %u MB file, %u byte buffer, %u files%s\n",
+		image ? image : "RAM disk", file_mb, bsize, files,
+		!Dev ? "" : policy ? ", write back cache" : ", write through cache");
+	printf("%-12s %7s %9s %9s %8s %16s %16s %7s %9s\n", "test", "ops", "ms",
+		"us/op", "MB/s", "read cmd/sect", "write cmd/sect", "seeks", "disk ms");
+
+	bench_mount();
+	bench_getfree();
+	bench_seq(file_mb << 20, bsize);
+	bench_random(file_mb << 20, reads);
+	bench_files(files);
+	bench_hotpath(entries, opens);
+	bench_append(appends, bsize);
+
+	check(f_unlink("seq.bin"), "f_unlink");
+	f_mount(0, NULL);
+	disk_ioctl(0, CTRL_SYNC, NULL);
+	return 0;
+}
@@ -0,0 +1,202 @@
+/*-----------------------------------------------------------------------*/
+/* Disk I/O dispatcher                                                   */
+/*-----------------------------------------------------------------------*/
+/* The low level disk I/O functions called by FatFs. Each physical drive
+/  is served by the backend registered with disk_register: the MMC/SD card
+/  on the target, a RAM disk or an image file on a host. All commands are
+/  counted here, so every backend can be measured the same way. */
+
+#include <string.h>
+#include "diskio.h"
+
+
+typedef struct _DISKIO_DRIVE {
+	const DISKIO_OPS *ops;
+	void *ctx;
+	DWORD next;				/* Sector after the previous command */
+	DISKIO_STATS stats;
+} DISKIO_DRIVE;
+
+static DISKIO_DRIVE Disks[_DISKIO_DRIVES];
+static DWORD (*Clock)(void);
+static DISKIO_TRACE Trace;
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Register the backend of a physical drive                              */
+/*-----------------------------------------------------------------------*/
+
+DRESULT disk_register (
+	BYTE drv,				/* Physical drive number */
+	const DISKIO_OPS *ops,	/* Backend, NULL to remove the drive */
+	void *ctx				/* Passed to every backend function */
+)
+{
+	if (drv >= _DISKIO_DRIVES) return RES_PARERR;
+
+	Disks[drv].ops = ops;
+	Disks[drv].ctx = ctx;
+	Disks[drv].next = 0;
+	memset(&Disks[drv].stats, 0, sizeof(DISKIO_STATS));
+	return RES_OK;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Set the time base and the trace hook                                  */
+/*-----------------------------------------------------------------------*/
+
+void disk_setclock (
+	DWORD (*clock)(void)	/* Free running counter, NULL: no timing */
+)
+{
+	Clock = clock;
+}
+
+
+void disk_settrace (
+	DISKIO_TRACE trace		/* Called after each read and write, NULL: off */
+)
+{
+	Trace = trace;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Get or clear the counters of a physical drive                         */
+/*-----------------------------------------------------------------------*/
+
+void disk_getstats (
+	BYTE drv,				/* Physical drive number */
+	DISKIO_STATS *st		/* Copy of the counters */
+)
+{
+	if (drv < _DISKIO_DRIVES)
+		*st = Disks[drv].stats;
+	else
+		memset(st, 0, sizeof(DISKIO_STATS));
+}
+
+
+void disk_resetstats (
+	BYTE drv				/* Physical drive number */
+)
+{
+	if (drv < _DISKIO_DRIVES)
+		memset(&Disks[drv].stats, 0, sizeof(DISKIO_STATS));
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Count and time a read or write command                                */
+/*-----------------------------------------------------------------------*/
+
+static void account (
+	BYTE drv,
+	BYTE write,
+	DWORD sector,
+	BYTE count,
+	DWORD start,			/* Clock before the command */
+	DRESULT res
+)
+{
+	DISKIO_DRIVE *d = &Disks[drv];
+	DWORD ticks = Clock ? Clock() - start : 0;
+
+	if (write) {
+		d->stats.write_cmds++;
+		d->stats.write_sects += count;
+		d->stats.write_ticks += ticks;
+	} else {
+		d->stats.read_cmds++;
+		d->stats.read_sects += count;
+		d->stats.read_ticks += ticks;
+	}
+	if (sector != d->next) d->stats.seeks++;
+	if (res != RES_OK) d->stats.errors++;
+	if (ticks > d->stats.max_ticks) d->stats.max_ticks = ticks;
+	d->next = sector + count;
+
+	if (Trace) Trace(drv, write, sector, count, ticks);
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* FatFs disk I/O functions                                              */
+/*-----------------------------------------------------------------------*/
+
+DSTATUS disk_initialize (
+	BYTE drv				/* Physical drive number */
+)
+{
+	if (drv >= _DISKIO_DRIVES || !Disks[drv].ops) return STA_NOINIT | STA_NODISK;
+
+	return Disks[drv].ops->initialize(Disks[drv].ctx);
+}
+
+
+DSTATUS disk_status (
+	BYTE drv				/* Physical drive number */
+)
+{
+	if (drv >= _DISKIO_DRIVES || !Disks[drv].ops) return STA_NOINIT | STA_NODISK;
+
+	return Disks[drv].ops->status(Disks[drv].ctx);
+}
+
+
+DRESULT disk_read (
+	BYTE drv,				/* Physical drive number */
+	BYTE *buff,				/* Data buffer to store read data */
+	DWORD sector,			/* Sector number (LBA) */
+	BYTE count				/* Sector count (1..255) */
+)
+{
+	DWORD start;
+	DRESULT res;
+
+	if (drv >= _DISKIO_DRIVES || !Disks[drv].ops) return RES_NOTRDY;
+
+	start = Clock ? Clock() : 0;
+	res = Disks[drv].ops->read(Disks[drv].ctx, buff, sector, count);
+	account(drv, 0, sector, count, start, res);
+	return res;
+}
+
+
+#if _READONLY == 0
+DRESULT disk_write (
+	BYTE drv,				/* Physical drive number */
+	const BYTE *buff,		/* Data to be written */
+	DWORD sector,			/* Sector number (LBA) */
+	BYTE count				/* Sector count (1..255) */
+)
+{
+	DWORD start;
+	DRESULT res;
+
+	if (drv >= _DISKIO_DRIVES || !Disks[drv].ops) return RES_NOTRDY;
+
+	start = Clock ? Clock() : 0;
+	res = Disks[drv].ops->write(Disks[drv].ctx, buff, sector, count);
+	account(drv, 1, sector, count, start, res);
+	return res;
+}
+#endif /* _READONLY */
+
+
+DRESULT disk_ioctl (
+	BYTE drv,				/* Physical drive number */
+	BYTE ctrl,				/* Control code */
+	void *buff				/* Buffer to send/receive control data */
+)
+{
+	if (drv >= _DISKIO_DRIVES || !Disks[drv].ops) return RES_NOTRDY;
+
+	return Disks[drv].ops->ioctl(Disks[drv].ctx, ctrl, buff);
+}
@@ -35,6 +35,62 @@ DRESULT disk_ioctl (BYTE, BYTE, void*);
 void	disk_timerproc (void);
 
 
+/*---------------------------------------*/
+/* Disk I/O backends                     */
+
+/* The disk_* functions above dispatch to the backend registered for the
+/  physical drive. Every command is counted and, with a clock set by
+/  disk_setclock, timed in the clock's ticks. */
+
+#define _DISKIO_DRIVES	2	/* Number of physical drives */
+
+typedef struct _DISKIO_OPS {
+	DSTATUS	(*initialize) (void*);
+	DSTATUS	(*status) (void*);
+	DRESULT	(*read) (void*, BYTE*, DWORD, BYTE);
+	DRESULT	(*write) (void*, const BYTE*, DWORD, BYTE);
+	DRESULT	(*ioctl) (void*, BYTE, void*);
+} DISKIO_OPS;
+
+typedef struct _DISKIO_STATS {
+	DWORD	read_cmds;		/* disk_read calls */
+	DWORD	read_sects;		/* Sectors read */
+	DWORD	write_cmds;		/* disk_write calls */
+	DWORD	write_sects;	/* Sectors written */
+	DWORD	seeks;			/* Commands not continuing the previous one */
+	DWORD	errors;			/* Commands failed */
+	DWORD	read_ticks;		/* Time in disk_read */
+	DWORD	write_ticks;	/* Time in disk_write */
+	DWORD	max_ticks;		/* Longest command */
+} DISKIO_STATS;
+
+/* Called after every disk_read (write = 0) and disk_write (write = 1) */
+typedef void (*DISKIO_TRACE) (BYTE drv, BYTE write, DWORD sector, BYTE count, DWORD ticks);
+
+DRESULT disk_register (BYTE, const DISKIO_OPS*, void*);
+void	disk_setclock (DWORD (*)(void));
+void	disk_settrace (DISKIO_TRACE);
+void	disk_getstats (BYTE, DISKIO_STATS*);
+void	disk_resetstats (BYTE);
+
+/* RAM disk, the context is a DISKIO_RAM */
+typedef struct _DISKIO_RAM {
+	BYTE	*data;			/* sectors * 512 bytes */
+	DWORD	sectors;
+} DISKIO_RAM;
+
+extern const DISKIO_OPS diskio_ram;
+
+/* Disk image file (stdio), the context is a DISKIO_IMG */
+typedef struct _DISKIO_IMG {
+	const char	*path;		/* Image file, opened by disk_initialize */
+	DWORD	sectors;		/* Size to create a new image, 0: use an existing one */
+	void	*file;			/* FILE* of the open image */
+} DISKIO_IMG;
+
+extern const DISKIO_OPS diskio_img;
+
+
 
 
 /* Disk Status Bits (DSTATUS) */
@@ -0,0 +1,99 @@
+/*-----------------------------------------------------------------------*/
+/* Disk image file backend                                               */
+/*-----------------------------------------------------------------------*/
+/* A raw image of a card (e.g. from dd) accessed with stdio. The image is
+/  opened by disk_initialize, a new one of img.sectors sectors is created
+/  if the file does not exist. CTRL_SYNC flushes the stdio buffer. */
+
+#include <stdio.h>
+#include "diskio.h"
+
+
+static DSTATUS img_initialize (void *ctx)
+{
+	DISKIO_IMG *img = (DISKIO_IMG*)ctx;
+	FILE *fp;
+	long size;
+
+	if (img->file) return 0;
+
+	fp = fopen(img->path, "r+b");
+	if (!fp && img->sectors) { /* Create a new image */
+		fp = fopen(img->path, "w+b");
+		if (fp && (fseek(fp, (long)img->sectors * 512 - 1, SEEK_SET)
+				|| fputc(0, fp) == EOF)) {
+			fclose(fp);
+			fp = NULL;
+		}
+	}
+	if (!fp) return STA_NOINIT | STA_NODISK;
+
+	if (fseek(fp, 0, SEEK_END) || (size = ftell(fp)) < 512) {
+		fclose(fp);
+		return STA_NOINIT;
+	}
+	img->sectors = (DWORD)(size / 512);
+	img->file = fp;
+	return 0;
+}
+
+
+static DSTATUS img_status (void *ctx)
+{
+	return ((DISKIO_IMG*)ctx)->file ? 0 : STA_NOINIT;
+}
+
+
+static DRESULT img_read (void *ctx, BYTE *buff, DWORD sector, BYTE count)
+{
+	DISKIO_IMG *img = (DISKIO_IMG*)ctx;
+	FILE *fp = (FILE*)img->file;
+
+	if (!fp) return RES_NOTRDY;
+	if (!count || sector >= img->sectors || count > img->sectors - sector)
+		return RES_PARERR;
+	if (fseek(fp, (long)sector * 512, SEEK_SET)
+			|| fread(buff, 512, count, fp) != count)
+		return RES_ERROR;
+	return RES_OK;
+}
+
+
+static DRESULT img_write (void *ctx, const BYTE *buff, DWORD sector, BYTE count)
+{
+	DISKIO_IMG *img = (DISKIO_IMG*)ctx;
+	FILE *fp = (FILE*)img->file;
+
+	if (!fp) return RES_NOTRDY;
+	if (!count || sector >= img->sectors || count > img->sectors - sector)
+		return RES_PARERR;
+	if (fseek(fp, (long)sector * 512, SEEK_SET)
+			|| fwrite(buff, 512, count, fp) != count)
+		return RES_ERROR;
+	return RES_OK;
+}
+
+
+static DRESULT img_ioctl (void *ctx, BYTE ctrl, void *buff)
+{
+	DISKIO_IMG *img = (DISKIO_IMG*)ctx;
+
+	if (!img->file) return RES_NOTRDY;
+
+	switch (ctrl) {
+	case GET_SECTOR_COUNT:
+		*(DWORD*)buff = img->sectors;
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD*)buff = 512;
+		return RES_OK;
+	case CTRL_SYNC:
+		return fflush((FILE*)img->file) ? RES_ERROR : RES_OK;
+	}
+	return RES_PARERR;
+}
+
+
+const DISKIO_OPS diskio_img = {
+	img_initialize, img_status, img_read, img_write, img_ioctl
+};
@@ -0,0 +1,66 @@
+/*-----------------------------------------------------------------------*/
+/* RAM disk backend                                                      */
+/*-----------------------------------------------------------------------*/
+/* A sector array in memory, e.g. a host benchmark or a volume in DDR.
+/  Register it with disk_register(drv, &diskio_ram, &ram) after setting
+/  ram.data and ram.sectors. */
+
+#include <string.h>
+#include "diskio.h"
+
+
+static DSTATUS ram_initialize (void *ctx)
+{
+	return ((DISKIO_RAM*)ctx)->data ? 0 : STA_NOINIT;
+}
+
+
+static DSTATUS ram_status (void *ctx)
+{
+	return ((DISKIO_RAM*)ctx)->data ? 0 : STA_NOINIT;
+}
+
+
+static DRESULT ram_read (void *ctx, BYTE *buff, DWORD sector, BYTE count)
+{
+	DISKIO_RAM *ram = (DISKIO_RAM*)ctx;
+
+	if (!count || sector >= ram->sectors || count > ram->sectors - sector)
+		return RES_PARERR;
+	memcpy(buff, ram->data + sector * 512, (DWORD)count * 512);
+	return RES_OK;
+}
+
+
+static DRESULT ram_write (void *ctx, const BYTE *buff, DWORD sector, BYTE count)
+{
+	DISKIO_RAM *ram = (DISKIO_RAM*)ctx;
+
+	if (!count || sector >= ram->sectors || count > ram->sectors - sector)
+		return RES_PARERR;
+	memcpy(ram->data + sector * 512, buff, (DWORD)count * 512);
+	return RES_OK;
+}
+
+
+static DRESULT ram_ioctl (void *ctx, BYTE ctrl, void *buff)
+{
+	DISKIO_RAM *ram = (DISKIO_RAM*)ctx;
+
+	switch (ctrl) {
+	case GET_SECTOR_COUNT:
+		*(DWORD*)buff = ram->sectors;
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD*)buff = 512;
+		return RES_OK;
+	case CTRL_SYNC:
+		return RES_OK;
+	}
+	return RES_PARERR;
+}
+
+
+const DISKIO_OPS diskio_ram = {
+	ram_initialize, ram_status, ram_read, ram_write, ram_ioctl
+};
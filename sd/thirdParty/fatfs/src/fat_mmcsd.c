@@ -15,6 +15,7 @@
 #include "ff.h"
 #include "string.h"
 #include "../../../../uart/dr_uart.h"
+#include "../../../dr_sd_cache.h"
 
 
 typedef struct _fatDevice
@@ -32,30 +33,56 @@ typedef struct _fatDevice
 
 
 #define DRIVE_NUM_MMCSD     0
-#define DRIVE_NUM_MAX      2
+#define DRIVE_NUM_MAX      _DISKIO_DRIVES
 
 
 fatDevice fat_devices[DRIVE_NUM_MAX];
 
+#if _MULTI_PARTITION
+/*
+ * Logical drive to partition binding, drive 0 is the first and drive 1 the
+ * second primary partition of the card
+ */
+const PARTITION Drives[_DRIVES] =
+{
+    {DRIVE_NUM_MMCSD, 0},
+    {DRIVE_NUM_MMCSD, 1}
+};
+#endif
+
+
+/*
+ * Block device access of the sector cache
+ */
+static int32_t
+MmcsdCacheIo(void *ctx, uint8_t *buf, uint32_t sector, uint32_t count,
+             uint32_t write)
+{
+    mmcsdCtrlInfo *ctrl = (mmcsdCtrlInfo *) ctx;
+
+    if (write)
+    {
+        return (MMCSDWriteCmdSend(ctrl, buf, sector, count) == 1);
+    }
+
+    return (MMCSDReadCmdSend(ctrl, buf, sector, count) == 1);
+}
+
 
 /*-----------------------------------------------------------------------*/
 /* Initialize Disk Drive                                                 */
 /*-----------------------------------------------------------------------*/
 
-DSTATUS
-disk_initialize(
-    BYTE bValue)                /* Physical drive number (0) */
+static DSTATUS
+mmcsd_initialize(
+    void *ctx)                  /* fatDevice of the physical drive */
 {
+    fatDevice *dev = (fatDevice *) ctx;
 	unsigned int status;
    
-    if (DRIVE_NUM_MAX <= bValue)
-    {
-        return STA_NODISK;
-    }
-    
-    if ((DRIVE_NUM_MMCSD == bValue) && (fat_devices[bValue].initDone != 1))
+    if (dev->initDone != 1)
     {
-        mmcsdCardInfo *card = (mmcsdCardInfo *) fat_devices[bValue].dev;
+        mmcsdCardInfo *card = (mmcsdCardInfo *) dev->dev;
         
         /* SD Card init */
         status = MMCSDCardInit(card->ctrl);
@@ -92,16 +119,16 @@ disk_initialize(
             }
 #endif            
             /* Set bus width */
-            if (card->cardType == MMCSD_CARD_SD)
-            {
-                MMCSDBusWidthSet(card->ctrl);
-            }
+            MMCSDBusWidthSet(card->ctrl);
     
             /* Transfer speed */
             MMCSDTranSpeedSet(card->ctrl);
+
+            /* A new card, drop everything cached */
+            SdCacheInit(MmcsdCacheIo, card->ctrl, SD_CACHE_POLICY);
         }
 
-		fat_devices[bValue].initDone = 1;
+		dev->initDone = 1;
     }
         
     return 0;
@@ -113,8 +140,8 @@ disk_initialize(
 /* Returns the current status of a drive                                 */
 /*-----------------------------------------------------------------------*/
 
-DSTATUS disk_status (
-    BYTE drv)                   /* Physical drive number (0) */
+static DSTATUS mmcsd_status (
+    void *ctx)                  /* fatDevice of the physical drive */
 {
 	return 0;
 }
@@ -125,22 +152,25 @@ DSTATUS disk_status (
 /* This function reads sector(s) from the disk drive                     */
 /*-----------------------------------------------------------------------*/
 
-DRESULT disk_read (
-    BYTE drv,               /* Physical drive number (0) */
+static DRESULT mmcsd_read (
+    void *ctx,              /* fatDevice of the physical drive */
     BYTE* buff,             /* Pointer to the data buffer to store read data */
-    DWORD sector,           /* Physical drive nmuber (0) */
+    DWORD sector,           /* Start sector number (LBA) */
     BYTE count)             /* Sector count (1..255) */
 {
-	if (drv == DRIVE_NUM_MMCSD)
+	fatDevice *dev = (fatDevice *) ctx;
+
+	/* Read ahead a cluster on sequential access */
+	if (dev->fs != NULL)
 	{
-		mmcsdCardInfo *card = fat_devices[drv].dev;
+		SdCacheReadAheadSet(dev->fs->sects_clust);
+	}
 
-    	/* READ BLOCK */
-		if (MMCSDReadCmdSend(card->ctrl, buff, sector, count) == 1)
-		{
-        	return RES_OK;
-		}
-    }
+	/* READ BLOCK */
+	if (SdCacheRead(buff, sector, count))
+	{
+		return RES_OK;
+	}
 
     return RES_ERROR;
 }
@@ -151,39 +181,52 @@ DRESULT disk_read (
 /* This function writes sector(s) to the disk drive                     */
 /*-----------------------------------------------------------------------*/
 
-#if _READONLY == 0
-DRESULT disk_write (
-    BYTE ucDrive,           /* Physical drive number (0) */
+static DRESULT mmcsd_write (
+    void *ctx,              /* fatDevice of the physical drive */
     const BYTE* buff,       /* Pointer to the data to be written */
     DWORD sector,           /* Start sector number (LBA) */
     BYTE count)             /* Sector count (1..255) */
 {
-	if (ucDrive == DRIVE_NUM_MMCSD)
+	/* WRITE BLOCK */
+	if (SdCacheWrite(buff, sector, count))
 	{
-		mmcsdCardInfo *card = fat_devices[ucDrive].dev;
-    	/* WRITE BLOCK */
-	    if(MMCSDWriteCmdSend(card->ctrl,(BYTE*) buff, sector, count) == 1)
-		{
-        	return RES_OK;
-		}
+		return RES_OK;
 	}
 
     return RES_ERROR;
 }
-#endif /* _READONLY */
 
 /*-----------------------------------------------------------------------*/
 /* Miscellaneous Functions                                               */
 /*-----------------------------------------------------------------------*/
 
-DRESULT disk_ioctl (
-    BYTE drv,               /* Physical drive number (0) */
+static DRESULT mmcsd_ioctl (
+    void *ctx,              /* fatDevice of the physical drive */
     BYTE ctrl,              /* Control code */
     void *buff)             /* Buffer to send/receive control data */
 {
+	/* Write back dirty sectors of the cache */
+	if (ctrl == CTRL_SYNC)
+	{
+		return SdCacheFlush() ? RES_OK : RES_ERROR;
+	}
+
 	return RES_OK;
 }
 
+/*
+ * Disk I/O backend of the card, HSMMCSDFsMount registers it with the
+ * fatDevice of the drive as context
+ */
+const DISKIO_OPS mmcsd_diskio =
+{
+    mmcsd_initialize,
+    mmcsd_status,
+    mmcsd_read,
+    mmcsd_write,
+    mmcsd_ioctl
+};
+
 /*---------------------------------------------------------*/
 /* User Provided Timer Function for FatFs module           */
 /*---------------------------------------------------------*/
@@ -50,6 +50,18 @@
 static FATFS *FatFs[_DRIVES]; /* Pointer to the file system objects (logical drives) */
 static WORD fsid; /* File system mount ID */
 
+#if _USE_LFN
+static WORD LfnBuf[_MAX_LFN + 1]; /* Long name of the current path segment (UCS-2) */
+static WORD LfnLen; /* Length of LfnBuf[], 0: the segment is a valid 8.3 name */
+static const BYTE LfnOfs[] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 }; /* Offsets of the characters in an LFN entry */
+#endif
+
+#if !_FS_READONLY && _USE_FREEMAP
+#define FMAP_USED(fs, cl)    ((fs)->fmap[(cl) / 32] & (1UL << ((cl) % 32)))
+#define FMAP_SET(fs, cl)    ((fs)->fmap[(cl) / 32] |= (1UL << ((cl) % 32)))
+#define FMAP_CLR(fs, cl)    ((fs)->fmap[(cl) / 32] &= ~(1UL << ((cl) % 32)))
+#endif
+
 /*-----------------------------------------------------------------------*/
 /* Change window offset                                                  */
 /*-----------------------------------------------------------------------*/
@@ -106,7 +118,7 @@ FATFS *fs /* File system object */
 		ST_DWORD(&fs->win[FSI_StrucSig], 0x61417272);
 		ST_DWORD(&fs->win[FSI_Free_Count], fs->free_clust);
 		ST_DWORD(&fs->win[FSI_Nxt_Free], fs->last_clust);
-		disk_write(0, fs->win, fs->fsi_sector, 1);
+		disk_write(fs->drive, fs->win, fs->fsi_sector, 1);
 		fs->fsi_flag = 0;
 	}
 #endif
@@ -204,6 +216,14 @@ DWORD val /* New value to mark the cluster */
 		return iFALSE;
 	}
 	fs->winflag = 1;
+#if _USE_FREEMAP
+	if (fs->fmap_valid) { /* Keep the bitmap in sync with the FAT */
+		if (val)
+			FMAP_SET(fs, clust);
+		else
+			FMAP_CLR(fs, clust);
+	}
+#endif
 	return iTRUE;
 }
 #endif /* !_FS_READONLY */
@@ -237,6 +257,73 @@ DWORD clust /* Cluster# to remove chain from */
 }
 #endif
 
+/*-----------------------------------------------------------------------*/
+/* Build the free cluster bitmap                                         */
+/*-----------------------------------------------------------------------*/
+
+#if !_FS_READONLY && _USE_FREEMAP
+static iBOOL fmap_ready( /* TRUE: fs->fmap[] can be used, FALSE: scan the FAT */
+FATFS *fs /* File system object */
+) {
+	DWORD clust, cstat, n;
+
+	if (fs->fmap_valid)
+		return iTRUE;
+	if (!fs->fmap || fs->fmap_size < (fs->max_clust + 31) / 32)
+		return iFALSE; /* No bitmap or too small for this volume */
+
+	memset(fs->fmap, 0xFF, fs->fmap_size * 4); /* Cluster 0, 1 and beyond the volume are in use */
+	n = 0;
+	for (clust = 2; clust < fs->max_clust; clust++) { /* Scan the FAT once */
+		cstat = get_cluster(fs, clust);
+		if (cstat == 1)
+			return iFALSE;
+		if (cstat == 0) {
+			FMAP_CLR(fs, clust);
+			n++;
+		}
+	}
+	if (fs->free_clust != n) { /* The scan is exact, correct FSInfo if needed */
+		fs->free_clust = n;
+#if _USE_FSINFO
+		if (fs->fs_type == FS_FAT32)
+			fs->fsi_flag = 1;
+#endif
+	}
+	fs->fmap_valid = 1;
+	return iTRUE;
+}
+
+static DWORD fmap_find( /* 0: no free cluster, >=2: free cluster number */
+FATFS *fs, /* File system object */
+DWORD scl /* Search starts after this cluster */
+) {
+	DWORD nw = (fs->max_clust + 31) / 32, wi, w, cl;
+	WORD pass;
+
+	cl = scl + 1;
+	if (cl >= fs->max_clust)
+		cl = 2;
+	wi = cl / 32;
+	w = fs->fmap[wi] | ((1UL << (cl % 32)) - 1); /* Ignore clusters before the start */
+	for (pass = 0; pass <= 1; pass++) { /* To the end, then wrap around */
+		for (;;) {
+			if (w != 0xFFFFFFFF) { /* Find first zero in the word */
+				for (cl = wi * 32; w & 1; w >>= 1)
+					cl++;
+				return cl;
+			}
+			if (++wi >= nw)
+				break;
+			w = fs->fmap[wi];
+		}
+		wi = 0;
+		w = fs->fmap[0];
+	}
+	return 0;
+}
+#endif /* _USE_FREEMAP */
+
 /*-----------------------------------------------------------------------*/
 /* Stretch or create a cluster chain                                     */
 /*-----------------------------------------------------------------------*/
@@ -261,21 +348,30 @@ DWORD clust /* Cluster# to stretch, 0 means create new */
 		scl = clust;
 	}
 
-	ncl = scl; /* Start cluster */
-	for (;;) {
-		ncl++; /* Next cluster */
-		if (ncl >= mcl) { /* Wrap around */
-			ncl = 2;
-			if (ncl > scl)
+#if _USE_FREEMAP
+	if (fmap_ready(fs)) { /* Find first zero bit in the bitmap */
+		ncl = fmap_find(fs, scl);
+		if (ncl == 0)
+			return 0; /* No free custer */
+	} else
+#endif
+	{
+		ncl = scl; /* Start cluster */
+		for (;;) {
+			ncl++; /* Next cluster */
+			if (ncl >= mcl) { /* Wrap around */
+				ncl = 2;
+				if (ncl > scl)
+					return 0; /* No free custer */
+			}
+			cstat = get_cluster(fs, ncl); /* Get the cluster status */
+			if (cstat == 0)
+				break; /* Found a free cluster */
+			if (cstat == 1)
+				return 1; /* Any error occured */
+			if (ncl == scl)
 				return 0; /* No free custer */
 		}
-		cstat = get_cluster(fs, ncl); /* Get the cluster status */
-		if (cstat == 0)
-			break; /* Found a free cluster */
-		if (cstat == 1)
-			return 1; /* Any error occured */
-		if (ncl == scl)
-			return 0; /* No free custer */
 	}
 
 	if (!put_cluster(fs, ncl, 0x0FFFFFFF))
@@ -309,6 +405,40 @@ DWORD clust /* Cluster# to be converted */
 	return clust * fs->sects_clust + fs->database;
 }
 
+/*-----------------------------------------------------------------------*/
+/* Get the extent holding a cluster of the file                          */
+/*-----------------------------------------------------------------------*/
+
+#if _USE_FASTSEEK
+static WORD ext_find( /* Index of the extent in fp->ext[] */
+const FIL *fp, /* File object with extent map */
+DWORD ci /* Cluster index in the file (< cluster count) */
+) {
+	WORD lo = 0, hi = fp->n_ext - 1, mid;
+
+	while (lo < hi) { /* Last extent with fofs <= ci */
+		mid = (WORD) ((lo + hi + 1) / 2);
+		if (fp->ext[mid].fofs <= ci)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+static DWORD ext_clust( /* >=2: cluster number, 1: out of the file */
+const FIL *fp, /* File object with extent map */
+DWORD ci /* Cluster index in the file */
+) {
+	WORD i;
+
+	if (ci >= fp->ext[fp->n_ext].fofs)
+		return 1;
+	i = ext_find(fp, ci);
+	return fp->ext[i].clust + (ci - fp->ext[i].fofs);
+}
+#endif /* _USE_FASTSEEK */
+
 /*-----------------------------------------------------------------------*/
 /* Move directory pointer to next                                        */
 /*-----------------------------------------------------------------------*/
@@ -383,6 +513,58 @@ const BYTE *dir /* Ptr to the directory entry */
 	finfo->fdate = LD_WORD(&dir[DIR_WrtDate]); /* Date */
 	finfo->ftime = LD_WORD(&dir[DIR_WrtTime]); /* Time */
 }
+
+#if _USE_LFN
+/*-----------------------------------------------------------------------*/
+/* Collect the characters of an LFN entry into LfnBuf[]                  */
+/*-----------------------------------------------------------------------*/
+
+static iBOOL pick_lfn( /* TRUE: successful, FALSE: invalid LFN entry */
+const BYTE *dir /* Ptr to the LFN entry */
+) {
+	WORD i, c, w = 1;
+	BYTE s;
+
+	i = ((dir[LDIR_Ord] & 0x3F) - 1) * 13; /* Offset in the long name */
+	if (i >= _MAX_LFN)
+		return iFALSE;
+	if (dir[LDIR_Ord] & 0x40) /* The last entry of the name terminates LfnBuf[] */
+		LfnBuf[i + 13 <= _MAX_LFN ? i + 13 : _MAX_LFN] = 0;
+	for (s = 0; s < 13; s++) {
+		c = LD_WORD(&dir[LfnOfs[s]]);
+		if (w) { /* Characters up to the terminator */
+			if (i >= _MAX_LFN && c)
+				return iFALSE; /* Too long */
+			LfnBuf[i++] = w = c;
+		} else if (c != 0xFFFF) { /* Padding must be 0xFFFF */
+			return iFALSE;
+		}
+	}
+	return iTRUE;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Copy the long name in LfnBuf[] to the file information                */
+/*-----------------------------------------------------------------------*/
+
+static
+void get_lfname( /* No return code */
+FILINFO *finfo, /* Ptr to the file information, lfname is set by the application */
+iBOOL valid /* TRUE: LfnBuf[] holds the long name of the entry */
+) {
+	WORD i = 0, c;
+	char *p = finfo->lfname;
+
+	if (!p || !finfo->lfsize)
+		return;
+	if (valid) {
+		while ((c = LfnBuf[i]) != 0 && i < finfo->lfsize - 1) {
+			p[i++] = (c < 0x100) ? (char) c : '?'; /* Latin-1 only */
+		}
+	}
+	p[i] = '\0'; /* Empty: the entry has no long name */
+}
+#endif /* _USE_LFN */
 #endif /* _FS_MINIMIZE <= 1 */
 
 /*-----------------------------------------------------------------------*/
@@ -459,6 +641,329 @@ char *dirname /* Pointer to directory name buffer {Name(8), Ext(3), NT flag(1)}
 	return 1;
 }
 
+#if _USE_LFN
+/*-----------------------------------------------------------------------*/
+/* LFN helpers                                                           */
+/*-----------------------------------------------------------------------*/
+
+static WORD lfn_upper( /* Upper case of a character, names are case insensitive */
+WORD c
+) {
+	return ((c >= 'a' && c <= 'z') || (c >= 0xE0 && c <= 0xFE && c != 0xF7)) ? c - 0x20 : c;
+}
+
+static BYTE sfn_sum( /* Checksum of the short name an LFN entry belongs to */
+const BYTE *dir /* Ptr to the short name {file(8),ext(3)} */
+) {
+	BYTE sum = 0, n;
+
+	for (n = 0; n < 11; n++)
+		sum = (sum >> 1) + (sum << 7) + dir[n];
+	return sum;
+}
+
+static iBOOL cmp_lfn( /* TRUE: the LFN entry matches LfnBuf[] */
+const BYTE *dir /* Ptr to the LFN entry */
+) {
+	WORD i, c, w = 1;
+	BYTE s;
+
+	i = ((dir[LDIR_Ord] & 0x3F) - 1) * 13; /* Offset in the long name */
+	for (s = 0; s < 13; s++) {
+		c = LD_WORD(&dir[LfnOfs[s]]);
+		if (w) {
+			if (i > _MAX_LFN || lfn_upper(c) != lfn_upper(w = LfnBuf[i++]))
+				return iFALSE;
+		} else if (c != 0xFFFF) {
+			return iFALSE;
+		}
+	}
+	if ((dir[LDIR_Ord] & 0x40) && w && i <= _MAX_LFN && LfnBuf[i]) /* The last entry must end the name */
+		return iFALSE;
+	return iTRUE;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Create the name in format of directory entry, long names accepted     */
+/*-----------------------------------------------------------------------*/
+
+static
+char create_name( /* 1: error - detected an invalid format, '\0'or'/': next character */
+const char **path, /* Pointer to the file path pointer */
+char *dirname /* Short name {Name(8), Ext(3), NT flag(1)}, generated from a long name */
+) {
+	const char *p = *path, *q;
+	WORD n, len;
+	BYTE c, e, i, t;
+
+	for (len = 0; (c = p[len]) != '\0' && c != '/'; len++) { /* Collect the segment */
+		if (c < ' ' || c == 0x7F || strchr("\"*:<>?|\\", c))
+			return 1; /* Reject control chars and chars invalid in long names */
+		if (len >= _MAX_LFN)
+			return 1;
+		LfnBuf[len] = c;
+	}
+	e = c; /* Separator */
+	*path = (e == '/') ? p + len + 1 : p + len;
+	q = p;
+	if (make_dirfile(&q, dirname) != 1) { /* A valid 8.3 name, no LFN entries */
+		LfnLen = 0;
+		return e;
+	}
+	while (len && (LfnBuf[len - 1] == ' ' || LfnBuf[len - 1] == '.'))
+		len--; /* Strip trailing spaces and dots */
+	if (!len)
+		return 1;
+	LfnBuf[len] = 0;
+	LfnLen = len;
+
+	/* Generate the base of the short name, reserve_direntry adds the numeric tail */
+	memset(dirname, ' ', 8 + 3);
+	dirname[11] = 0;
+	for (n = len; n && LfnBuf[n - 1] != '.'; n--); /* Last dot separates the extension */
+	for (i = 0, t = 0; t < len; t++) {
+		c = (BYTE) LfnBuf[t];
+		if (n && t == n - 1) { /* Enter extension part */
+			i = 8;
+			continue;
+		}
+		if (c == ' ' || c == '.')
+			continue;
+		if (c >= 0x80 || strchr("+,;=[]", c))
+			c = '_';
+		if (c >= 'a' && c <= 'z')
+			c -= 0x20;
+		if (i < 8 || (n && t >= n && i < 11))
+			dirname[i++] = c;
+	}
+	if (dirname[0] == ' ')
+		dirname[0] = '_';
+	if ((BYTE) dirname[0] == 0xE5)
+		dirname[0] = 0x05;
+	return e;
+}
+#endif /* _USE_LFN */
+
+/*-----------------------------------------------------------------------*/
+/* Find an object in a directory                                         */
+/*-----------------------------------------------------------------------*/
+
+static FRESULT dir_scan( /* FR_OK: found, FR_NO_FILE: not found, FR_RW_ERROR: disk error */
+DIR *dirobj, /* Directory object, scanning starts at its current entry */
+const char *fn, /* Short name to find {file(8),ext(3),attr(1)}, LfnBuf[] if LfnLen */
+WORD limit, /* Number of entries to check, 0: up to the end of the directory */
+BYTE **dir /* Pointer to the short entry in win[] to return */
+) {
+	BYTE *dptr, c;
+	FATFS *fs = dirobj->fs;
+#if _USE_LFN
+	BYTE a, ord = 0xFF, sum = 0;
+
+	dirobj->lfn_sect = 0;
+#endif
+
+	for (;;) {
+		if (!move_window(fs, dirobj->sect))
+			return FR_RW_ERROR;
+		dptr = &fs->win[(dirobj->index & ((S_SIZ - 1) / 32)) * 32]; /* Pointer to the directory entry */
+		c = dptr[DIR_Name];
+		if (c == 0) /* Has it reached to end of dir? */
+			return FR_NO_FILE;
+#if _USE_LFN
+		a = dptr[DIR_Attr] & 0x3F;
+		if (c == 0xE5 || ((a & AM_VOL) && a != AM_LFN)) { /* Deleted entry or volume label */
+			ord = 0xFF;
+		} else if (a == AM_LFN) { /* An LFN entry, track the sequence in front of a short entry */
+			if (c & 0x40) { /* First entry of a sequence */
+				sum = dptr[LDIR_Chksum];
+				c &= 0xBF;
+				ord = c;
+				dirobj->lfn_clust = dirobj->clust;
+				dirobj->lfn_sect = dirobj->sect;
+				dirobj->lfn_index = dirobj->index;
+			}
+			ord = (c == ord && sum == dptr[LDIR_Chksum] && (!LfnLen || cmp_lfn(dptr))) ? ord - 1 : 0xFF;
+		} else { /* A short entry */
+			if (ord || sum != sfn_sum(dptr))
+				dirobj->lfn_sect = 0; /* No LFN entries belong to it */
+			if (LfnLen ? dirobj->lfn_sect != 0 : !memcmp(&dptr[DIR_Name], fn, 8 + 3)) { /* Matched? */
+				*dir = dptr;
+				return FR_OK;
+			}
+			ord = 0xFF;
+		}
+#else
+		if (c != 0xE5 && !(dptr[DIR_Attr] & AM_VOL) /* Matched? */
+				&& !memcmp(&dptr[DIR_Name], fn, 8 + 3)) {
+			*dir = dptr;
+			return FR_OK;
+		}
+#endif
+		if ((limit && !--limit) || !next_dir_entry(dirobj)) /* Next directory pointer */
+			return FR_NO_FILE;
+	}
+}
+
+#if _USE_DIRHASH || _USE_PATHCACHE
+static
+void dir_remember( /* No return code */
+const DIR *dirobj, /* Directory object pointing to the short entry of the found object */
+DHSLOT *slot /* Slot to store the position of the first entry of the object */
+) {
+	slot->sclust = dirobj->sclust;
+	slot->clust = dirobj->clust;
+	slot->sect = dirobj->sect;
+	slot->index = dirobj->index;
+	slot->nent = 1;
+#if _USE_LFN
+	if (dirobj->lfn_sect) {
+		slot->clust = dirobj->lfn_clust;
+		slot->sect = dirobj->lfn_sect;
+		slot->index = dirobj->lfn_index;
+		slot->nent = (BYTE) (dirobj->index - dirobj->lfn_index + 1);
+	}
+#endif
+}
+
+static FRESULT dir_recall( /* FR_OK: found, FR_NO_FILE: the slot is stale, FR_RW_ERROR: disk error */
+DIR *dirobj, /* Directory object to point to the object */
+const DHSLOT *slot, /* Cached position of the object */
+const char *fn, /* Short name to find {file(8),ext(3),attr(1)}, LfnBuf[] if LfnLen */
+BYTE **dir /* Pointer to the short entry in win[] to return */
+) {
+	dirobj->sclust = slot->sclust; /* Check the entries at the cached position only */
+	dirobj->clust = slot->clust;
+	dirobj->sect = slot->sect;
+	dirobj->index = slot->index;
+	return dir_scan(dirobj, fn, slot->nent, dir);
+}
+#endif
+
+#if _USE_DIRHASH
+static WORD name_hash( /* Hash of a name in a directory */
+const char *fn, /* Short name {file(8),ext(3)}, LfnBuf[] if LfnLen */
+DWORD sclust /* Start cluster of the directory */
+) {
+	DWORD h = sclust;
+	BYTE n;
+#if _USE_LFN
+	const WORD *p;
+
+	if (LfnLen) {
+		for (p = LfnBuf; *p; p++)
+			h = h * 31 + lfn_upper(*p);
+	} else
+#endif
+	for (n = 0; n < 11; n++)
+		h = h * 31 + (BYTE) fn[n];
+	h ^= h >> 16; /* Spread names differing in the last characters over all slots */
+	h *= 0x45D9F3BUL;
+	h ^= h >> 16;
+	return (WORD) h;
+}
+#endif
+
+static FRESULT dir_find( /* FR_OK: found, FR_NO_FILE: not found, FR_RW_ERROR: disk error */
+DIR *dirobj, /* Directory object at the top of the directory */
+const char *fn, /* Short name to find {file(8),ext(3),attr(1)}, LfnBuf[] if LfnLen */
+BYTE **dir /* Pointer to the short entry in win[] to return */
+) {
+#if _USE_DIRHASH
+	DWORD clust = dirobj->clust, sect = dirobj->sect;
+	WORD index = dirobj->index, hash;
+	DHSLOT *set, tmp;
+	BYTE w;
+	FRESULT res;
+
+	hash = name_hash(fn, dirobj->sclust);
+	set = &dirobj->fs->dhash[(hash % (_DIRHASH_SLOTS / 2)) * 2]; /* 2-way set, [0] is the recently used */
+	for (w = 0; w < 2; w++) {
+		if (set[w].sect && set[w].sclust == dirobj->sclust && set[w].tag == (BYTE) (hash >> 8)) {
+			res = dir_recall(dirobj, &set[w], fn, dir);
+			if (res == FR_OK && w) {
+				tmp = set[0];
+				set[0] = set[1];
+				set[1] = tmp;
+			}
+			if (res != FR_NO_FILE)
+				return res;
+			set[w].sect = 0; /* The entries have changed, scan the directory */
+			dirobj->clust = clust;
+			dirobj->sect = sect;
+			dirobj->index = index;
+		}
+	}
+	res = dir_scan(dirobj, fn, 0, dir);
+	if (res == FR_OK) { /* Remember the first entry of the object */
+		set[1] = set[0];
+		dir_remember(dirobj, &set[0]);
+		set[0].tag = (BYTE) (hash >> 8);
+	}
+	return res;
+#else
+	return dir_scan(dirobj, fn, 0, dir);
+#endif
+}
+
+#if _USE_PATHCACHE
+/*-----------------------------------------------------------------------*/
+/* Full path cache                                                       */
+/*-----------------------------------------------------------------------*/
+
+#define PCACHE_CLEAR(fs)    memset((fs)->pcache, 0, sizeof((fs)->pcache))
+
+static DWORD path_hash( /* FNV-1a hash of a path */
+const char *path
+) {
+	DWORD h = 2166136261UL;
+	BYTE c;
+
+	while ((c = *path++) != '\0')
+		h = (h ^ c) * 16777619UL;
+	return h;
+}
+
+static FRESULT pcache_find( /* FR_OK: found, FR_NO_FILE: not cached, FR_RW_ERROR: disk error */
+DIR *dirobj, /* Directory object to return the directory of the object */
+char *fn, /* Pointer to last segment name to return {file(8),ext(3),attr(1)} */
+const char *path, /* Full-path string, not empty */
+DWORD hash, /* path_hash(path) */
+BYTE **dir /* Directory pointer in Win[] to retutn */
+) {
+	PCSLOT *pc, tmp;
+	const char *p;
+	BYTE i;
+	FRESULT res;
+	FATFS *fs = dirobj->fs;
+
+	for (i = 0; i < _PATHCACHE_SLOTS; i++) {
+		pc = &fs->pcache[i];
+		if (!pc->pos.sect || pc->hash != hash || strcmp(pc->path, path))
+			continue; /* The hash only preselects, the path must match */
+		p = strrchr(path, '/'); /* The last segment is checked against the entries */
+		p = p ? p + 1 : path;
+#if _USE_LFN
+		if (create_name(&p, fn) != '\0')
+#else
+		if (make_dirfile(&p, fn) != '\0')
+#endif
+			return FR_NO_FILE;
+		res = dir_recall(dirobj, &pc->pos, fn, dir);
+		if (res != FR_OK) {
+			pc->pos.sect = 0; /* The entries have changed */
+			return (res == FR_NO_FILE) ? FR_NO_FILE : res;
+		}
+		if (i) { /* Move to front */
+			tmp = *pc;
+			memmove(&fs->pcache[1], &fs->pcache[0], i * sizeof(PCSLOT));
+			fs->pcache[0] = tmp;
+		}
+		return FR_OK;
+	}
+	return FR_NO_FILE;
+}
+#endif /* _USE_PATHCACHE */
+
 /*-----------------------------------------------------------------------*/
 /* Trace a file path                                                     */
 /*-----------------------------------------------------------------------*/
@@ -472,7 +977,19 @@ BYTE **dir /* Directory pointer in Win[] to retutn */
 	DWORD clust;
 	char ds;
 	BYTE *dptr = NULL;
+	FRESULT res;
 	FATFS *fs = dirobj->fs; /* Get logical drive from the given DIR structure */
+#if _USE_PATHCACHE
+	const char *top = path;
+	DWORD phash = 0;
+
+	if (*path != '\0') { /* Look for a hot path */
+		phash = path_hash(path);
+		res = pcache_find(dirobj, fn, path, phash, dir);
+		if (res != FR_NO_FILE)
+			return res;
+	}
+#endif
 
 	/* Initialize directory object */
 	clust = fs->dirbase;
@@ -491,24 +1008,26 @@ BYTE **dir /* Directory pointer in Win[] to retutn */
 	}
 
 	for (;;) {
+#if _USE_LFN
+		ds = create_name(&path, fn); /* Get a paragraph into fn[] and LfnBuf[] */
+#else
 		ds = make_dirfile(&path, fn); /* Get a paragraph into fn[] */
+#endif
 		if (ds == 1)
 			return FR_INVALID_NAME;
-		for (;;) {
-			if (!move_window(fs, dirobj->sect))
-				return FR_RW_ERROR;
-			dptr = &fs->win[(dirobj->index & ((S_SIZ - 1) / 32)) * 32]; /* Pointer to the directory entry */
-			if (dptr[DIR_Name] == 0) /* Has it reached to end of dir? */
-				return !ds ? FR_NO_FILE : FR_NO_PATH;
-			if (dptr[DIR_Name] != 0xE5 /* Matched? */
-			&& !(dptr[DIR_Attr] & AM_VOL)
-					&& !memcmp(&dptr[DIR_Name], fn, 8 + 3))
-				break;
-			if (!next_dir_entry(dirobj)) /* Next directory pointer */
-				return !ds ? FR_NO_FILE : FR_NO_PATH;
-		}
+		res = dir_find(dirobj, fn, &dptr);
+		if (res != FR_OK)
+			return (res == FR_NO_FILE && ds) ? FR_NO_PATH : res;
 		if (!ds) {
 			*dir = dptr;
+#if _USE_PATHCACHE
+			if (strlen(top) < _PATHCACHE_LEN) { /* Remember the path, the least recently used is dropped */
+				memmove(&fs->pcache[1], &fs->pcache[0], (_PATHCACHE_SLOTS - 1) * sizeof(PCSLOT));
+				fs->pcache[0].hash = phash;
+				strcpy(fs->pcache[0].path, top);
+				dir_remember(dirobj, &fs->pcache[0].pos);
+			}
+#endif
 			return FR_OK;
 		} /* Matched with end of path */
 		if (!(dptr[DIR_Attr] & AM_DIR))
@@ -521,56 +1040,221 @@ BYTE **dir /* Directory pointer in Win[] to retutn */
 	}
 }
 
+#if !_FS_READONLY
+/*-----------------------------------------------------------------------*/
+/* Rewind a directory object to its first entry                          */
+/*-----------------------------------------------------------------------*/
+
+static
+void dir_rewind( /* No return code */
+DIR *dirobj /* Directory object */
+) {
+	FATFS *fs = dirobj->fs;
+
+	dirobj->clust = dirobj->sclust;
+	dirobj->sect = dirobj->sclust ? clust2sect(fs, dirobj->sclust) : fs->dirbase;
+	dirobj->index = 0;
+}
+
+#if _USE_LFN
+/*-----------------------------------------------------------------------*/
+/* Store a part of LfnBuf[] into an LFN entry                            */
+/*-----------------------------------------------------------------------*/
+
+static
+void fit_lfn( /* No return code */
+BYTE *dir, /* Ptr to the LFN entry */
+BYTE ord, /* Order of the entry (1-20) */
+BYTE sum /* Checksum of the short name */
+) {
+	WORD i, c = 1;
+	BYTE s;
+
+	i = (ord - 1) * 13; /* Offset in the long name */
+	dir[LDIR_Attr] = AM_LFN;
+	dir[LDIR_Type] = 0;
+	dir[LDIR_Chksum] = sum;
+	ST_WORD(&dir[LDIR_FstClusLO], 0);
+	for (s = 0; s < 13; s++) {
+		if (c != 0xFFFF)
+			c = LfnBuf[i++]; /* The terminator follows the last character */
+		ST_WORD(&dir[LfnOfs[s]], c);
+		if (!c)
+			c = 0xFFFF; /* Padding */
+	}
+	if (c == 0xFFFF || !LfnBuf[i])
+		ord |= 0x40; /* The last entry of the name */
+	dir[LDIR_Ord] = ord;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Add a numeric tail to the short name of a long name                   */
+/*-----------------------------------------------------------------------*/
+
+static FRESULT gen_numname( /* FR_OK: fn[] is not used in the directory, FR_DENIED: no free name */
+DIR *dirobj, /* Target directory */
+char *fn /* Short name base from create_name, "~n" is put in front of the extension */
+) {
+	char base[8], ns[8];
+	BYTE *dptr, i, j, c;
+	WORD seq, len, n;
+	DWORD sreg;
+	const WORD *p;
+	FRESULT res;
+
+	memcpy(base, fn, 8);
+	for (seq = 1; seq < 100; seq++) {
+		n = seq;
+		if (seq > 5) { /* Many collisions, use a hash of the long name instead of the sequence */
+			sreg = seq;
+			for (p = LfnBuf; *p; p++) {
+				n = *p;
+				for (i = 0; i < 16; i++) {
+					sreg = (sreg << 1) + (n & 1);
+					n >>= 1;
+					if (sreg & 0x10000)
+						sreg ^= 0x11021;
+				}
+			}
+			n = (WORD) sreg;
+		}
+		i = 7; /* Tail in hexdecimal */
+		do {
+			c = (BYTE) (n % 16 + '0');
+			ns[i--] = (c > '9') ? c + 7 : c;
+			n /= 16;
+		} while (n);
+		ns[i] = '~';
+
+		for (j = 0; j < i && base[j] != ' '; j++) /* Body is cut to fit the tail */
+			fn[j] = base[j];
+		while (j < 8)
+			fn[j++] = (i < 8) ? ns[i++] : ' ';
+
+		len = LfnLen; /* Look for the short name only */
+		LfnLen = 0;
+		dir_rewind(dirobj);
+		res = dir_scan(dirobj, fn, 0, &dptr);
+		LfnLen = len;
+		if (res != FR_OK)
+			return (res == FR_NO_FILE) ? FR_OK : res;
+	}
+	return FR_DENIED;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Remove the LFN entries of an object found by trace_path               */
+/*-----------------------------------------------------------------------*/
+
+static iBOOL remove_lfn( /* TRUE: successful, FALSE: disk error */
+DIR *dirobj /* Directory object pointing to the short entry of the object */
+) {
+	FATFS *fs = dirobj->fs;
+	WORD index = dirobj->index;
+
+	if (!dirobj->lfn_sect)
+		return iTRUE;
+	dirobj->clust = dirobj->lfn_clust;
+	dirobj->sect = dirobj->lfn_sect;
+	dirobj->index = dirobj->lfn_index;
+	do {
+		if (!move_window(fs, dirobj->sect))
+			return iFALSE;
+		fs->win[(dirobj->index & ((S_SIZ - 1) / 32)) * 32] = 0xE5;
+		fs->winflag = 1;
+	} while (next_dir_entry(dirobj) && dirobj->index != index);
+	return iTRUE;
+}
+#endif /* _USE_LFN */
+
 /*-----------------------------------------------------------------------*/
 /* Reserve a directory entry                                             */
 /*-----------------------------------------------------------------------*/
 
-#if !_FS_READONLY
 static FRESULT reserve_direntry( /* FR_OK: successful, FR_DENIED: no free entry, FR_RW_ERROR: a disk error occured */
 DIR *dirobj, /* Target directory to create new entry */
+char *fn, /* Short name of the new entry, gets a numeric tail for a long name */
 BYTE **dir /* Pointer to pointer to created entry to retutn */
 ) {
 	DWORD clust, sector;
-	BYTE c, n, *dptr;
+	BYTE c, n, nent, cnt;
 	FATFS *fs = dirobj->fs;
+#if _USE_LFN
+	DWORD sclust = 0, ssect = 0;
+	WORD sindex = 0;
+	FRESULT res;
 
-	/* Re-initialize directory object */
-	clust = dirobj->sclust;
-	if (clust) { /* Dyanmic directory table */
-		dirobj->clust = clust;
-		dirobj->sect = clust2sect(fs, clust);
-	} else { /* Static directory table */
-		dirobj->sect = fs->dirbase;
+	nent = 1;
+	if (LfnLen) { /* A long name needs a free short name and its LFN entries in front of it */
+		res = gen_numname(dirobj, fn);
+		if (res != FR_OK)
+			return res;
+		nent = (BYTE) ((LfnLen + 12) / 13 + 1);
 	}
-	dirobj->index = 0;
+#else
+	nent = 1;
+#endif
 
-	do {
+	dir_rewind(dirobj); /* Re-initialize directory object */
+	cnt = 0;
+	for (;;) {
 		if (!move_window(fs, dirobj->sect))
 			return FR_RW_ERROR;
-		dptr = &fs->win[(dirobj->index & ((S_SIZ - 1) / 32)) * 32]; /* Pointer to the directory entry */
-		c = dptr[DIR_Name];
+		c = fs->win[(dirobj->index & ((S_SIZ - 1) / 32)) * 32];
 		if (c == 0 || c == 0xE5) { /* Found an empty entry! */
-			*dir = dptr;
-			return FR_OK;
+#if _USE_LFN
+			if (!cnt) { /* Top of a free run */
+				sclust = dirobj->clust;
+				ssect = dirobj->sect;
+				sindex = dirobj->index;
+			}
+#endif
+			if (++cnt == nent)
+				break;
+		} else {
+			cnt = 0;
 		}
-	} while (next_dir_entry(dirobj)); /* Next directory pointer */
-	/* Reached to end of the directory table */
+		if (next_dir_entry(dirobj)) /* Next directory pointer */
+			continue;
+		/* Reached to end of the directory table */
 
-	/* Abort when static table or could not stretch dynamic table */
-	if (!clust || !(clust = create_chain(fs, dirobj->clust)))
-		return FR_DENIED;
-	if (clust == 1 || !move_window(fs, 0))
-		return FR_RW_ERROR;
+		/* Abort when static table or could not stretch dynamic table */
+		if (!dirobj->sclust || !(clust = create_chain(fs, dirobj->clust)))
+			return FR_DENIED;
+		if (clust == 1 || !move_window(fs, 0))
+			return FR_RW_ERROR;
 
-	fs->winsect = sector = clust2sect(fs, clust); /* Cleanup the expanded table */
-	memset(fs->win, 0, S_SIZ);
-	for (n = fs->sects_clust; n; n--) {
-		if (disk_write(fs->drive, fs->win, sector, 1) != RES_OK)
+		fs->winsect = sector = clust2sect(fs, clust); /* Cleanup the expanded table */
+		memset(fs->win, 0, S_SIZ);
+		for (n = fs->sects_clust; n; n--) {
+			if (disk_write(fs->drive, fs->win, sector, 1) != RES_OK)
+				return FR_RW_ERROR;
+			sector++;
+		}
+		fs->winflag = 1;
+		dirobj->clust = clust; /* Continue at the top of the new table */
+		dirobj->sect = fs->winsect;
+		dirobj->index++;
+	}
+
+#if _USE_LFN
+	if (nent > 1) { /* Store the long name in front of the short entry */
+		c = sfn_sum((BYTE *) fn);
+		dirobj->clust = sclust;
+		dirobj->sect = ssect;
+		dirobj->index = sindex;
+		for (n = nent - 1; n; n--) {
+			if (!move_window(fs, dirobj->sect))
+				return FR_RW_ERROR;
+			fit_lfn(&fs->win[(dirobj->index & ((S_SIZ - 1) / 32)) * 32], n, c);
+			fs->winflag = 1;
+			next_dir_entry(dirobj); /* The run is allocated already */
+		}
+		if (!move_window(fs, dirobj->sect))
 			return FR_RW_ERROR;
-		sector++;
 	}
-	fs->winflag = 1;
-	*dir = fs->win;
+#endif
+	*dir = &fs->win[(dirobj->index & ((S_SIZ - 1) / 32)) * 32];
 	return FR_OK;
 }
 #endif /* !_FS_READONLY */
@@ -646,7 +1330,16 @@ BYTE chk_wp /* !=0: Check media write protection for wrinting fuctions */
 
 	/* The logical drive has not been mounted, following code attempts to mount the logical drive */
 
+#if !_FS_READONLY && _USE_FREEMAP
+	{
+		DWORD *fmap = fs->fmap, fmap_size = fs->fmap_size; /* Registered bitmap survives, its content not */
+		memset(fs, 0, sizeof(FATFS)); /* Clean-up the file system object */
+		fs->fmap = fmap;
+		fs->fmap_size = fmap_size;
+	}
+#else
 	memset(fs, 0, sizeof(FATFS)); /* Clean-up the file system object */
+#endif
 	fs->drive = LD2PD(drv); /* Bind the logical drive and a physical drive */
 	stat = disk_initialize(fs->drive); /* Initialize low level disk I/O layer */
 	if (stat & STA_NOINIT) /* Check if the drive is ready */
@@ -661,6 +1354,10 @@ BYTE chk_wp /* !=0: Check media write protection for wrinting fuctions */
 #endif
 	/* Search FAT partition on the drive */
 	fmt = check_fs(fs, bootsect = 0); /* Check sector 0 as an SFD format */
+#if _MULTI_PARTITION
+	if (!fmt && LD2PT(drv)) /* An SFD volume has no further partitions */
+		return FR_NO_FILESYSTEM;
+#endif
 	if (fmt == 1) { /* Not a FAT boot record, it may be patitioned */
 		/* Check a partition listed in top of the partition table */
 		tbl = &fs->win[MBR_Table + LD2PT(drv) * 16]; /* Partition table */
@@ -709,12 +1406,16 @@ BYTE chk_wp /* !=0: Check media write protection for wrinting fuctions */
 	/* Load fsinfo sector if needed */
 	if (fmt == FS_FAT32) {
 		fs->fsi_sector = bootsect + LD_WORD(&fs->win[BPB_FSInfo]);
-		if (disk_read(0, fs->win, fs->fsi_sector, 1) == RES_OK &&
+		if (disk_read(fs->drive, fs->win, fs->fsi_sector, 1) == RES_OK &&
 				LD_WORD(&fs->win[BS_55AA]) == 0xAA55 &&
 				LD_DWORD(&fs->win[FSI_LeadSig]) == 0x41615252 &&
 				LD_DWORD(&fs->win[FSI_StrucSig]) == 0x61417272) {
 			fs->last_clust = LD_DWORD(&fs->win[FSI_Nxt_Free]);
 			fs->free_clust = LD_DWORD(&fs->win[FSI_Free_Count]);
+			if (fs->free_clust > maxclust - 2) /* 0xFFFFFFFF or out of range: unknown */
+				fs->free_clust = 0xFFFFFFFF;
+			if (fs->last_clust >= maxclust) /* No valid hint */
+				fs->last_clust = 0;
 		}
 	}
 #endif
@@ -766,6 +1467,29 @@ FATFS *fs /* Pointer to new file system object (NULL for unmount)*/
 	return FR_OK;
 }
 
+#if !_FS_READONLY && _USE_FREEMAP
+/*-----------------------------------------------------------------------*/
+/* Register the Free Cluster Bitmap of a Logical Drive                   */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_freemap(BYTE drv, /* Logical drive number (mounted by f_mount) */
+DWORD *map, /* Bitmap, one bit per cluster (NULL: scan the FAT) */
+DWORD words /* Size of map[] in words, at least (clusters + 2 + 31) / 32 */
+) {
+	FATFS *fs;
+
+	if (drv >= _DRIVES)
+		return FR_INVALID_DRIVE;
+	if (!(fs = FatFs[drv]))
+		return FR_NOT_ENABLED;
+	fs->fmap = map;
+	fs->fmap_size = map ? words : 0;
+	fs->fmap_valid = 0; /* Built on the next allocation */
+
+	return FR_OK;
+}
+#endif /* _USE_FREEMAP */
+
 /*-----------------------------------------------------------------------*/
 /* Open or Create a File                                                 */
 /*-----------------------------------------------------------------------*/
@@ -805,7 +1529,7 @@ BYTE mode /* Access mode and file open mode flags */
 		if (res != FR_OK) { /* No file, create new */
 			if (res != FR_NO_FILE)
 				return res;
-			res = reserve_direntry(&dirobj, &dir);
+			res = reserve_direntry(&dirobj, fn, &dir);
 			if (res != FR_OK)
 				return res;
 			memset(dir, 0, 32); /* Initialize the new entry with open name */
@@ -854,19 +1578,93 @@ BYTE mode /* Access mode and file open mode flags */
 			return FR_DENIED;
 	}
 
-	fp->dir_sect = fs->winsect; /* Pointer to the directory entry */
-	fp->dir_ptr = dir;
+	fp->dir_sect = fs->winsect; /* Pointer to the directory entry */
+	fp->dir_ptr = dir;
+#endif
+	fp->flag = mode; /* File access mode */
+	fp->org_clust = /* File start cluster */
+	((DWORD) LD_WORD(&dir[DIR_FstClusHI]) << 16) | LD_WORD(&dir[DIR_FstClusLO]);
+	fp->fsize = LD_DWORD(&dir[DIR_FileSize]); /* File size */
+	fp->fptr = 0; /* File ptr */
+	fp->sect_clust = 1; /* Sector counter */
+#if _USE_FASTSEEK
+	fp->ext = NULL; /* No extent map until f_extmap */
+	fp->n_ext = 0;
+#endif
+#if _USE_ZEROCOPY
+	fp->zc_buf = NULL; /* No zero-copy window until f_zcbuf */
+	fp->zc_sects = 0;
+	fp->zc_pin = 0;
+#endif
+	fp->fs = fs;
+	fp->id = fs->id; /* Owner file system object of the file */
+
+	return FR_OK;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Move to the next sector of a file on read                             */
+/*-----------------------------------------------------------------------*/
+
+static DWORD next_sect( /* !=0: sector number, 0: failed */
+FIL *fp /* File object, fptr is on the sector boundary */
+) {
+	DWORD clust, sect;
+	FATFS *fs = fp->fs;
+
+	if (--fp->sect_clust) { /* Decrement left sector counter */
+		sect = fp->curr_sect + 1; /* Get current sector */
+	} else { /* On the cluster boundary, get next cluster */
+#if _USE_FASTSEEK
+		if (fp->ext) /* Look up the extent map */
+			clust = ext_clust(fp, fp->fptr / ((DWORD) fs->sects_clust * S_SIZ));
+		else
+#endif
+		clust = (fp->fptr == 0) ?
+				fp->org_clust : get_cluster(fs, fp->curr_clust);
+		if (clust < 2 || clust >= fs->max_clust)
+			return 0;
+		fp->curr_clust = clust; /* Current cluster */
+		sect = clust2sect(fs, clust); /* Get current sector */
+		fp->sect_clust = fs->sects_clust; /* Re-initialize the left sector counter */
+	}
+#if !_FS_READONLY
+	if (fp->flag & FA__DIRTY) { /* Flush file I/O buffer if needed */
+		if (disk_write(fs->drive, fp->buffer, fp->curr_sect, 1) != RES_OK)
+			return 0;
+		fp->flag &= ~FA__DIRTY;
+	}
+#endif
+	fp->curr_sect = sect; /* Update current sector */
+	return sect;
+}
+
+static BYTE contig_sects( /* Number of sectors readable with one disk_read from curr_sect */
+FIL *fp, /* File object */
+BYTE cc /* Number of sectors wanted */
+) {
+	DWORD ncs = fp->sect_clust; /* Sectors left in the cluster */
+
+#if _USE_FASTSEEK
+	if (fp->ext) { /* The contiguous run may span clusters */
+		FATFS *fs = fp->fs;
+		DWORD ci = fp->fptr / ((DWORD) fs->sects_clust * S_SIZ);
+		ncs += (fp->ext[ext_find(fp, ci) + 1].fofs - ci - 1) * fs->sects_clust;
+	}
 #endif
-	fp->flag = mode; /* File access mode */
-	fp->org_clust = /* File start cluster */
-	((DWORD) LD_WORD(&dir[DIR_FstClusHI]) << 16) | LD_WORD(&dir[DIR_FstClusLO]);
-	fp->fsize = LD_DWORD(&dir[DIR_FileSize]); /* File size */
-	fp->fptr = 0; /* File ptr */
-	fp->sect_clust = 1; /* Sector counter */
-	fp->fs = fs;
-	fp->id = fs->id; /* Owner file system object of the file */
+	return (cc > ncs) ? (BYTE) ncs : cc;
+}
 
-	return FR_OK;
+static void skip_sects( /* Account cc sectors read from curr_sect */
+FIL *fp, /* File object */
+BYTE cc /* Number of sectors read */
+) {
+	BYTE csize = fp->fs->sects_clust;
+	DWORD pos = (DWORD) (csize - fp->sect_clust) + cc - 1; /* Last sector from top of the cluster */
+
+	fp->curr_clust += pos / csize; /* Only moves within a contiguous run */
+	fp->sect_clust = (BYTE) (csize - pos % csize);
+	fp->curr_sect += cc - 1;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -878,7 +1676,7 @@ void *buff, /* Pointer to data buffer */
 WORD btr, /* Number of bytes to read */
 WORD *br /* Pointer to number of bytes read */
 ) {
-	DWORD clust, sect, remain;
+	DWORD sect, remain;
 	WORD rcnt;
 	BYTE cc, *rbuff = buff;
 	FRESULT res;
@@ -892,6 +1690,10 @@ WORD *br /* Pointer to number of bytes read */
 		return FR_RW_ERROR; /* Check error flag */
 	if (!(fp->flag & FA_READ))
 		return FR_DENIED; /* Check access mode */
+#if _USE_ZEROCOPY
+	if (fp->zc_pin)
+		return FR_DENIED; /* A zero-copy block is not released yet */
+#endif
 	remain = fp->fsize - fp->fptr;
 	if (btr > remain)
 		btr = (WORD) remain; /* Truncate read count by number of bytes left */
@@ -899,34 +1701,15 @@ WORD *br /* Pointer to number of bytes read */
 	for (; btr; /* Repeat until all data transferred */
 	rbuff += rcnt, fp->fptr += rcnt, *br += rcnt, btr -= rcnt) {
 		if ((fp->fptr & (S_SIZ - 1)) == 0) { /* On the sector boundary */
-			if (--fp->sect_clust) { /* Decrement left sector counter */
-				sect = fp->curr_sect + 1; /* Get current sector */
-			} else { /* On the cluster boundary, get next cluster */
-				clust = (fp->fptr == 0) ?
-						fp->org_clust : get_cluster(fs, fp->curr_clust);
-				if (clust < 2 || clust >= fs->max_clust)
-					goto fr_error;
-				fp->curr_clust = clust; /* Current cluster */
-				sect = clust2sect(fs, clust); /* Get current sector */
-				fp->sect_clust = fs->sects_clust; /* Re-initialize the left sector counter */
-			}
-#if !_FS_READONLY
-			if (fp->flag & FA__DIRTY) { /* Flush file I/O buffer if needed */
-				if (disk_write(fs->drive, fp->buffer, fp->curr_sect, 1)
-						!= RES_OK)
-					goto fr_error;
-				fp->flag &= ~FA__DIRTY;
-			}
-#endif
-			fp->curr_sect = sect; /* Update current sector */
+			sect = next_sect(fp);
+			if (!sect)
+				goto fr_error;
 			cc = btr / S_SIZ; /* When left bytes >= S_SIZ, */
 			if (cc) { /* Read maximum contiguous sectors directly */
-				if (cc > fp->sect_clust)
-					cc = fp->sect_clust;
+				cc = contig_sects(fp, cc);
 				if (disk_read(fs->drive, rbuff, sect, cc) != RES_OK)
 					goto fr_error;
-				fp->sect_clust -= cc - 1;
-				fp->curr_sect += cc - 1;
+				skip_sects(fp, cc);
 				rcnt = cc * S_SIZ;
 				continue;
 			}
@@ -946,7 +1729,138 @@ WORD *br /* Pointer to number of bytes read */
 	return FR_RW_ERROR;
 }
 
+#if _USE_ZEROCOPY
+/*-----------------------------------------------------------------------*/
+/* Set the Zero-Copy Window of a File                                    */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_zcbuf(FIL *fp, /* Pointer to the file object */
+BYTE *buf, /* Sector aligned DMA buffer (NULL: use the file I/O buffer only) */
+BYTE sects /* Size of buf[] in sectors */
+) {
+	FRESULT res;
+
+	res = validate(fp->fs, fp->id); /* Check validity of the object */
+	if (res)
+		return res;
+	if (fp->zc_pin)
+		return FR_DENIED;
+	fp->zc_buf = sects ? buf : NULL;
+	fp->zc_sects = buf ? sects : 0;
+	return FR_OK;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Read File without Copy                                                */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_read_zc(FIL *fp, /* Pointer to the file object */
+const BYTE **ptr, /* Pointer to return the pointer to the data */
+WORD *len /* Pointer to return the number of bytes (0: end of file) */
+) {
+	DWORD sect, remain;
+	WORD cnt;
+	BYTE cc;
+	FRESULT res;
+	FATFS *fs = fp->fs;
+
+	*ptr = NULL;
+	*len = 0;
+	res = validate(fs, fp->id); /* Check validity of the object */
+	if (res)
+		return res;
+	if (fp->flag & FA__ERROR)
+		return FR_RW_ERROR; /* Check error flag */
+	if (!(fp->flag & FA_READ))
+		return FR_DENIED; /* Check access mode */
+	if (fp->zc_pin)
+		return FR_DENIED; /* The previous block is not released yet */
+	remain = fp->fsize - fp->fptr;
+	if (!remain)
+		return FR_OK; /* End of file */
+
+	if ((fp->fptr & (S_SIZ - 1)) == 0) { /* On the sector boundary */
+		sect = next_sect(fp);
+		if (!sect)
+			goto fz_error;
+		cc = (remain / S_SIZ > fp->zc_sects) ? fp->zc_sects : (BYTE) (remain / S_SIZ);
+		if (cc) { /* Read contiguous sectors into the zero-copy window */
+			cc = contig_sects(fp, cc);
+			if (disk_read(fs->drive, fp->zc_buf, sect, cc) != RES_OK)
+				goto fz_error;
+			skip_sects(fp, cc);
+			*ptr = fp->zc_buf;
+			cnt = cc * S_SIZ;
+			goto fz_pin;
+		}
+		if (disk_read(fs->drive, fp->buffer, sect, 1) != RES_OK) /* Load the sector into file I/O buffer */
+			goto fz_error;
+	}
+	cnt = S_SIZ - ((WORD) fp->fptr & (S_SIZ - 1)); /* Hand out the rest of the file I/O buffer */
+	if (cnt > remain)
+		cnt = (WORD) remain;
+	*ptr = &fp->buffer[fp->fptr & (S_SIZ - 1)];
+
+	fz_pin: /* The data stays valid until f_read_zc_release */
+	fp->fptr += cnt;
+	fp->zc_pin = 1;
+	*len = cnt;
+	return FR_OK;
+
+	fz_error: /* Abort this file due to an unrecoverable error */
+	fp->flag |= FA__ERROR;
+	return FR_RW_ERROR;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Release a Block of f_read_zc                                          */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_read_zc_release(FIL *fp /* Pointer to the file object */
+) {
+	FRESULT res;
+
+	res = validate(fp->fs, fp->id); /* Check validity of the object */
+	if (res == FR_OK)
+		fp->zc_pin = 0;
+	return res;
+}
+#endif /* _USE_ZEROCOPY */
+
 #if !_FS_READONLY
+/*-----------------------------------------------------------------------*/
+/* Count the sectors of a direct write from curr_sect                    */
+/*-----------------------------------------------------------------------*/
+
+static BYTE write_run( /* Number of sectors to write from curr_sect, the file object is advanced to the last one */
+FIL *fp, /* Pointer to the file object, curr_sect is the first sector */
+BYTE cc /* Number of whole sectors to write */
+) {
+	DWORD clust = fp->curr_clust, nxt;
+	WORD n = fp->sect_clust, m;
+	FATFS *fs = fp->fs;
+
+	while (n < cc) { /* Following clusters already allocated in a row join the run */
+		nxt = get_cluster(fs, clust);
+		if (nxt != clust + 1)
+			break;
+		clust = nxt;
+		n += fs->sects_clust;
+	}
+	if (cc > n)
+		cc = (BYTE) n;
+	if (clust == fp->curr_clust) { /* Within the current cluster */
+		fp->sect_clust -= cc - 1;
+		fp->curr_sect += cc - 1;
+	} else {
+		m = cc - (n - fs->sects_clust); /* Sectors written in the last cluster */
+		fp->curr_clust = clust;
+		fp->curr_sect = clust2sect(fs, clust) + m - 1;
+		fp->sect_clust = (BYTE) (fs->sects_clust - m + 1);
+	}
+	return cc;
+}
+
 /*-----------------------------------------------------------------------*/
 /* Write File                                                            */
 /*-----------------------------------------------------------------------*/
@@ -971,6 +1885,10 @@ WORD *bw /* Pointer to number of bytes written */
 		return FR_RW_ERROR; /* Check error flag */
 	if (!(fp->flag & FA_WRITE))
 		return FR_DENIED; /* Check access mode */
+#if _USE_ZEROCOPY
+	if (fp->zc_pin)
+		return FR_DENIED; /* A zero-copy block is not released yet */
+#endif
 	if (fp->fsize + btw < fp->fsize)
 		return FR_OK; /* File size cannot reach 4GB */
 
@@ -1004,12 +1922,9 @@ WORD *bw /* Pointer to number of bytes written */
 			fp->curr_sect = sect; /* Update current sector */
 			cc = btw / S_SIZ; /* When left bytes >= S_SIZ, */
 			if (cc) { /* Write maximum contiguous sectors directly */
-				if (cc > fp->sect_clust)
-					cc = fp->sect_clust;
+				cc = write_run(fp, cc);
 				if (disk_write(fs->drive, wbuff, sect, cc) != RES_OK)
 					goto fw_error;
-				fp->sect_clust -= cc - 1;
-				fp->curr_sect += cc - 1;
 				wcnt = cc * S_SIZ;
 				continue;
 			}
@@ -1074,6 +1989,183 @@ FRESULT f_sync(FIL *fp /* Pointer to the file object */
 	return res;
 }
 
+#if _USE_PREALLOC
+/*-----------------------------------------------------------------------*/
+/* Find a run of free clusters                                           */
+/*-----------------------------------------------------------------------*/
+
+static DWORD find_run( /* 0: no run, 1: error, >=2: first cluster of the run */
+FATFS *fs, /* File system object */
+DWORD scl, /* Search starts after this cluster */
+DWORD n /* Number of contiguous free clusters */
+) {
+	DWORD cl, i, len, cstat, mcl = fs->max_clust;
+#if _USE_FREEMAP
+	iBOOL map = fmap_ready(fs);
+#endif
+
+	cl = scl + 1;
+	if (cl < 2 || cl >= mcl)
+		cl = 2;
+	len = 0;
+	for (i = 2; i < mcl; i++, cl++) { /* Up to the end, then from the top */
+		if (cl >= mcl) { /* A run does not wrap around */
+			cl = 2;
+			len = 0;
+		}
+#if _USE_FREEMAP
+		if (map)
+			cstat = FMAP_USED(fs, cl);
+		else
+#endif
+		{
+			cstat = get_cluster(fs, cl);
+			if (cstat == 1)
+				return 1;
+		}
+		if (cstat)
+			len = 0;
+		else if (++len == n)
+			return cl - n + 1;
+	}
+	return 0;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Allocate Clusters ahead of the File R/W Pointer                       */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_prealloc(FIL *fp, /* Pointer to the file object */
+DWORD size /* Number of bytes to allocate from the file R/W pointer */
+) {
+	DWORD clust, nxt, ncl, need, csize, i;
+	FRESULT res;
+	FATFS *fs = fp->fs;
+
+	res = validate(fs, fp->id); /* Check validity of the object */
+	if (res)
+		return res;
+	if (fp->flag & FA__ERROR)
+		return FR_RW_ERROR; /* Check error flag */
+	if (!(fp->flag & FA_WRITE))
+		return FR_DENIED; /* Check access mode */
+	if (fp->fptr + size < fp->fptr)
+		return FR_DENIED; /* File size cannot reach 4GB */
+
+	csize = (DWORD) fs->sects_clust * S_SIZ; /* Cluster size in unit of byte */
+	need = (fp->fptr + size + csize - 1) / csize; /* Clusters the file needs */
+	if (fp->fptr) { /* Current cluster holds the byte before the R/W pointer */
+		clust = fp->curr_clust;
+		ncl = (fp->fptr - 1) / csize + 1;
+	} else {
+		clust = fp->org_clust;
+		ncl = clust ? 1 : 0;
+	}
+	while (clust && ncl < need) { /* Follow the chain to its end */
+		nxt = get_cluster(fs, clust);
+		if (nxt == 1)
+			goto fp_error;
+		if (nxt < 2 || nxt >= fs->max_clust)
+			break;
+		clust = nxt;
+		ncl++;
+	}
+	if (ncl >= need)
+		return FR_OK;
+	need -= ncl; /* Clusters to add */
+
+	nxt = find_run(fs, clust ? clust : fs->last_clust, need);
+	if (nxt == 1)
+		goto fp_error;
+	if (nxt) { /* Link the run and append it to the chain */
+		for (i = 0; i < need; i++) {
+			if (!put_cluster(fs, nxt + i,
+					(i == need - 1) ? 0x0FFFFFFF : nxt + i + 1))
+				goto fp_error;
+		}
+		if (clust) {
+			if (!put_cluster(fs, clust, nxt))
+				goto fp_error;
+		} else {
+			fp->org_clust = nxt;
+			fp->flag |= FA__WRITTEN;
+		}
+		fs->last_clust = nxt + need - 1;
+		if (fs->free_clust != 0xFFFFFFFF) {
+			fs->free_clust -= need;
+#if _USE_FSINFO
+			fs->fsi_flag = 1;
+#endif
+		}
+		return FR_OK;
+	}
+
+	while (need--) { /* No run that long, stretch the chain cluster by cluster */
+		nxt = create_chain(fs, clust);
+		if (nxt == 0)
+			return FR_DENIED; /* Disk full */
+		if (nxt == 1 || nxt >= fs->max_clust)
+			goto fp_error;
+		if (!clust) {
+			fp->org_clust = nxt;
+			fp->flag |= FA__WRITTEN;
+		}
+		clust = nxt;
+	}
+	return FR_OK;
+
+	fp_error: /* Abort this file due to an unrecoverable error */
+	fp->flag |= FA__ERROR;
+	return FR_RW_ERROR;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Truncate File at the R/W Pointer                                      */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_truncate(FIL *fp /* Pointer to the file object */
+) {
+	DWORD nxt;
+	FRESULT res;
+	FATFS *fs = fp->fs;
+
+	res = validate(fs, fp->id); /* Check validity of the object */
+	if (res)
+		return res;
+	if (fp->flag & FA__ERROR)
+		return FR_RW_ERROR; /* Check error flag */
+	if (!(fp->flag & FA_WRITE))
+		return FR_DENIED; /* Check access mode */
+
+	if (fp->fsize > fp->fptr) {
+		fp->fsize = fp->fptr; /* Set file size to the R/W pointer */
+		fp->flag |= FA__WRITTEN;
+	}
+	if (fp->fptr == 0) { /* Remove the whole chain */
+		if (fp->org_clust) {
+			if (!remove_chain(fs, fp->org_clust))
+				goto ft_error;
+			fp->org_clust = 0;
+			fp->flag |= FA__WRITTEN;
+		}
+	} else { /* Remove the clusters beyond the current one */
+		nxt = get_cluster(fs, fp->curr_clust);
+		if (nxt == 1)
+			goto ft_error;
+		if (nxt >= 2 && nxt < fs->max_clust) {
+			if (!put_cluster(fs, fp->curr_clust, 0x0FFFFFFF)
+					|| !remove_chain(fs, nxt))
+				goto ft_error;
+		}
+	}
+	return FR_OK;
+
+	ft_error: /* Abort this file due to an unrecoverable error */
+	fp->flag |= FA__ERROR;
+	return FR_RW_ERROR;
+}
+#endif /* _USE_PREALLOC */
+
 #endif /* !_FS_READONLY */
 
 /*-----------------------------------------------------------------------*/
@@ -1112,6 +2204,10 @@ DWORD ofs /* File pointer from top of file */
 		return res;
 	if (fp->flag & FA__ERROR)
 		return FR_RW_ERROR;
+#if _USE_ZEROCOPY
+	if (fp->zc_pin)
+		return FR_DENIED; /* A zero-copy block is not released yet */
+#endif
 #if !_FS_READONLY
 	if (fp->flag & FA__DIRTY) { /* Write-back dirty buffer if needed */
 		if (disk_write(fs->drive, fp->buffer, fp->curr_sect, 1) != RES_OK)
@@ -1126,6 +2222,26 @@ DWORD ofs /* File pointer from top of file */
 	fp->fptr = 0;
 	fp->sect_clust = 1; /* Set file R/W pointer to top of the file */
 
+#if _USE_FASTSEEK
+	if (ofs && fp->ext) { /* Look up the cluster in the extent map */
+		csize = (DWORD) fs->sects_clust * S_SIZ; /* Cluster size in unit of byte */
+		clust = ext_clust(fp, (ofs - 1) / csize);
+		if (clust < 2 || clust >= fs->max_clust)
+			goto fk_error;
+		fp->curr_clust = clust;
+		fp->fptr = (ofs - 1) / csize * csize; /* Skip leading clusters */
+		ofs -= fp->fptr;
+		csect = (BYTE) ((ofs - 1) / S_SIZ); /* Sector offset in the cluster */
+		fp->curr_sect = clust2sect(fs, clust) + csect; /* Current sector */
+		if ((ofs & (S_SIZ - 1)) && /* Load current sector if needed */
+		disk_read(fs->drive, fp->buffer, fp->curr_sect, 1) != RES_OK)
+			goto fk_error;
+		fp->sect_clust = fs->sects_clust - csect; /* Left sector counter in the cluster */
+		fp->fptr += ofs; /* Update file R/W pointer */
+		ofs = 0;
+	}
+#endif
+
 	/* Move file R/W pointer if needed */
 	if (ofs) {
 		clust = fp->org_clust; /* Get start cluster */
@@ -1181,6 +2297,70 @@ DWORD ofs /* File pointer from top of file */
 	return FR_RW_ERROR;
 }
 
+#if _USE_FASTSEEK
+/*-----------------------------------------------------------------------*/
+/* Build the Cluster Extent Map of a File                                */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_extmap(FIL *fp, /* Pointer to the file object */
+FEXTENT *tbl, /* Pointer to the extent table (NULL: remove the map) */
+WORD items /* Number of items in tbl, one more than the extents */
+) {
+	DWORD clust, nxt, ncl;
+	WORD n;
+	FRESULT res;
+	FATFS *fs = fp->fs;
+
+	res = validate(fs, fp->id); /* Check validity of the object */
+	if (res)
+		return res;
+	fp->ext = NULL;
+	fp->n_ext = 0;
+	if (!tbl)
+		return FR_OK;
+#if !_FS_READONLY
+	if (fp->flag & FA_WRITE) /* The chain of a written file can change */
+		return FR_DENIED;
+#endif
+	if (items < 2)
+		return FR_NOT_ENOUGH_CORE;
+
+	n = 0;
+	ncl = 0;
+	clust = fp->org_clust;
+	if (clust) {
+		tbl[0].fofs = 0;
+		tbl[0].clust = clust;
+		for (;;) { /* Follow the chain once, start a new extent on each gap */
+			if (clust < 2 || clust >= fs->max_clust)
+				return FR_RW_ERROR;
+			ncl++;
+			nxt = get_cluster(fs, clust);
+			if (nxt == 1)
+				return FR_RW_ERROR;
+			if (nxt < 2 || nxt >= fs->max_clust) /* End of the chain */
+				break;
+			if (nxt != clust + 1) {
+				if (++n >= items - 1)
+					return FR_NOT_ENOUGH_CORE;
+				tbl[n].fofs = ncl;
+				tbl[n].clust = nxt;
+			}
+			clust = nxt;
+		}
+		n++;
+	}
+	tbl[n].fofs = ncl; /* Terminator holds the cluster count */
+	tbl[n].clust = 0;
+
+	if (n) {
+		fp->ext = tbl;
+		fp->n_ext = n;
+	}
+	return FR_OK;
+}
+#endif /* _USE_FASTSEEK */
+
 #if _FS_MINIMIZE <= 1
 /*-----------------------------------------------------------------------*/
 /* Create a directroy object                                             */
@@ -1226,6 +2406,9 @@ FILINFO *finfo /* Pointer to file information to return */
 	BYTE *dir, c;
 	FATFS *fs = dirobj->fs;
 	FRESULT result;
+#if _USE_LFN
+	BYTE a, ord = 0xFF, sum = 0;
+#endif
 
 	result = validate(fs, dirobj->id); /* Check validity of the object */
 	if (result) {
@@ -1240,8 +2423,26 @@ FILINFO *finfo /* Pointer to file information to return */
 		c = *dir;
 		if (c == 0)
 			break; /* Has it reached to end of dir? */
+#if _USE_LFN
+		a = dir[DIR_Attr] & 0x3F;
+		if (c != 0xE5 && a == AM_LFN) { /* An LFN entry, collect the long name */
+			if (c & 0x40) { /* First entry of a sequence */
+				sum = dir[LDIR_Chksum];
+				c &= 0xBF;
+				ord = c;
+			}
+			ord = (c == ord && sum == dir[LDIR_Chksum] && pick_lfn(dir)) ? ord - 1 : 0xFF;
+		} else {
+			if (c != 0xE5 && !(a & AM_VOL)) { /* Is it a valid entry? */
+				get_fileinfo(finfo, dir);
+				get_lfname(finfo, !ord && sum == sfn_sum(dir));
+			}
+			ord = 0xFF;
+		}
+#else
 		if (c != 0xE5 && !(dir[DIR_Attr] & AM_VOL)) /* Is it a valid entry? */
 			get_fileinfo(finfo, dir);
+#endif
 		if (!next_dir_entry(dirobj))
 			dirobj->sect = 0; /* Next entry */
 		if (finfo->fname[0])
@@ -1252,6 +2453,31 @@ FILINFO *finfo /* Pointer to file information to return */
 }
 
 #if _FS_MINIMIZE == 0
+#if _USE_LFN
+/*-----------------------------------------------------------------------*/
+/* Read the long name of an object found by trace_path into LfnBuf[]     */
+/*-----------------------------------------------------------------------*/
+
+static iBOOL read_lfn( /* TRUE: LfnBuf[] holds the long name, FALSE: no long name */
+const DIR *dirobj /* Directory object pointing to the short entry of the object */
+) {
+	DIR lobj = *dirobj;
+	FATFS *fs = dirobj->fs;
+
+	if (!lobj.lfn_sect)
+		return iFALSE;
+	lobj.clust = lobj.lfn_clust;
+	lobj.sect = lobj.lfn_sect;
+	lobj.index = lobj.lfn_index;
+	do {
+		if (!move_window(fs, lobj.sect)
+				|| !pick_lfn(&fs->win[(lobj.index & ((S_SIZ - 1) / 32)) * 32]))
+			return iFALSE;
+	} while (next_dir_entry(&lobj) && lobj.index != dirobj->index);
+	return iTRUE;
+}
+#endif
+
 /*-----------------------------------------------------------------------*/
 /* Get File Status                                                       */
 /*-----------------------------------------------------------------------*/
@@ -1272,9 +2498,13 @@ FILINFO *finfo /* Pointer to file information to return */
 
 	res = trace_path(&dirobj, fn, path, &dir); /* Trace the file path */
 	if (res == FR_OK) { /* Trace completed */
-		if (dir) /* Found an object */
+		if (dir) { /* Found an object */
 			get_fileinfo(finfo, dir);
-		else
+#if _USE_LFN
+			if (finfo->lfname)
+				get_lfname(finfo, read_lfn(&dirobj));
+#endif
+		} else
 			/* It is root dir */
 			res = FR_INVALID_NAME;
 	}
@@ -1307,6 +2537,12 @@ FATFS **fatfs /* Pointer to pointer to the file system object to return */
 		*nclust = fs->free_clust;
 		return FR_OK;
 	}
+#if _USE_FREEMAP
+	if (fmap_ready(fs)) { /* Building the bitmap counts the free clusters */
+		*nclust = fs->free_clust;
+		return FR_OK;
+	}
+#endif
 
 	/* Count number of free clusters */
 	fat = fs->fs_type;
@@ -1361,6 +2597,9 @@ FRESULT f_unlink(const char *path /* Pointer to the file or directory path */
 	char fn[8 + 3 + 1];
 	FRESULT res;
 	DIR dirobj;
+#if _USE_LFN
+	DIR lobj;
+#endif
 	FATFS *fs;
 
 	res = auto_mount(&path, &fs, 1);
@@ -1375,9 +2614,15 @@ FRESULT f_unlink(const char *path /* Pointer to the file or directory path */
 		return FR_INVALID_NAME; /* It is the root directory */
 	if (dir[DIR_Attr] & AM_RDO)
 		return FR_DENIED; /* It is a R/O object */
+#if _USE_PATHCACHE
+	PCACHE_CLEAR(fs); /* Paths of the object and below are gone */
+#endif
 	dsect = fs->winsect;
 	dclust = ((DWORD) LD_WORD(&dir[DIR_FstClusHI]) << 16)
 			| LD_WORD(&dir[DIR_FstClusLO]);
+#if _USE_LFN
+	lobj = dirobj; /* Position of the LFN entries */
+#endif
 
 	if (dir[DIR_Attr] & AM_DIR) { /* It is a sub-directory */
 		dirobj.clust = dclust; /* Check if the sub-dir is empty or not */
@@ -1392,12 +2637,19 @@ FRESULT f_unlink(const char *path /* Pointer to the file or directory path */
 			if (sdir[DIR_Name] != 0xE5 && !(sdir[DIR_Attr] & AM_VOL))
 				return FR_DENIED; /* The directory is not empty */
 		} while (next_dir_entry(&dirobj));
+#if _USE_DIRHASH
+		memset(fs->dhash, 0, sizeof(fs->dhash)); /* Its table may be reused for anything */
+#endif
 	}
 
 	if (!move_window(fs, dsect))
 		return FR_RW_ERROR; /* Mark the directory entry 'deleted' */
 	dir[DIR_Name] = 0xE5;
 	fs->winflag = 1;
+#if _USE_LFN
+	if (!remove_lfn(&lobj))
+		return FR_RW_ERROR;
+#endif
 	if (!remove_chain(fs, dclust))
 		return FR_RW_ERROR; /* Remove the cluster chain */
 
@@ -1427,8 +2679,11 @@ FRESULT f_mkdir(const char *path /* Pointer to the directory path */
 		return FR_EXIST; /* Any file or directory is already existing */
 	if (res != FR_NO_FILE)
 		return res;
+#if _USE_PATHCACHE
+	PCACHE_CLEAR(fs);
+#endif
 
-	res = reserve_direntry(&dirobj, &dir); /* Reserve a directory entry */
+	res = reserve_direntry(&dirobj, fn, &dir); /* Reserve a directory entry */
 	if (res != FR_OK)
 		return res;
 	sect = fs->winsect;
@@ -1455,11 +2710,10 @@ FRESULT f_mkdir(const char *path /* Pointer to the directory path */
 	memcpy(&fw[32], &fw[0], 32);
 	fw[33] = '.'; /* Create ".." entry */
 	pclust = dirobj.sclust;
-#if _FAT32
 	ST_WORD(&fw[ DIR_FstClusHI], dclust >> 16);
-	if (fs->fs_type == FS_FAT32 && pclust == fs->dirbase) pclust = 0;
+	if (fs->fs_type == FS_FAT32 && pclust == fs->dirbase)
+		pclust = 0; /* ".." of the root is 0 */
 	ST_WORD(&fw[32+DIR_FstClusHI], pclust >> 16);
-#endif
 	ST_WORD(&fw[ DIR_FstClusLO], dclust);
 	ST_WORD(&fw[32+DIR_FstClusLO], pclust);
 	fs->winflag = 1;
@@ -1521,6 +2775,9 @@ const char *path_new /* Pointer to the new name */
 	DWORD sect_old;
 	BYTE *dir_old, *dir_new, direntry[32 - 11];
 	DIR dirobj;
+#if _USE_LFN
+	DIR lobj;
+#endif
 	char fn[8 + 3 + 1];
 	FATFS *fs;
 
@@ -1536,13 +2793,19 @@ const char *path_new /* Pointer to the new name */
 		return FR_NO_FILE;
 	sect_old = fs->winsect; /* Save the object information */
 	memcpy(direntry, &dir_old[DIR_Attr], 32 - 11);
+#if _USE_LFN
+	lobj = dirobj; /* Position of the old LFN entries */
+#endif
 
 	res = trace_path(&dirobj, fn, path_new, &dir_new); /* Check new object */
 	if (res == FR_OK)
 		return FR_EXIST; /* The new object name is already existing */
 	if (res != FR_NO_FILE)
 		return res; /* Is there no old name? */
-	res = reserve_direntry(&dirobj, &dir_new); /* Reserve a directory entry */
+#if _USE_PATHCACHE
+	PCACHE_CLEAR(fs); /* Paths of the object and below change */
+#endif
+	res = reserve_direntry(&dirobj, fn, &dir_new); /* Reserve a directory entry */
 	if (res != FR_OK)
 		return res;
 
@@ -1554,6 +2817,11 @@ const char *path_new /* Pointer to the new name */
 	if (!move_window(fs, sect_old))
 		return FR_RW_ERROR; /* Remove old entry */
 	dir_old[DIR_Name] = 0xE5;
+	fs->winflag = 1;
+#if _USE_LFN
+	if (!remove_lfn(&lobj))
+		return FR_RW_ERROR;
+#endif
 
 	return sync(fs);
 }
@@ -1586,6 +2854,9 @@ FRESULT f_mkfs (
 	if (drv >= _DRIVES) return FR_INVALID_DRIVE;
 	fs = FatFs[drv];
 	if (!fs) return FR_NOT_ENABLED;
+#if _MULTI_PARTITION
+	if (LD2PT(drv)) return FR_MKFS_ABORTED; /* Only the first partition can be created */
+#endif
 	memset(fs, 0, sizeof(FATFS));
 	drv = LD2PD(drv);
 
@@ -38,20 +38,81 @@
 /  3: f_lseek is removed in addition to level 2. */
 
 #define _DRIVES        2
-/* Number of logical drives to be used. This affects the size of internal table. */
+/* Number of logical drives to be used. This affects the size of internal table.
+/  RAM: 4 bytes per drive, plus one FATFS object per mounted drive. */
 
+#ifndef _USE_MKFS
 #define    _USE_MKFS    0
+#endif
 /* When _USE_MKFS is set to 1 and _FS_READONLY is set to 0, f_mkfs function is
-/  enabled. */
+/  enabled. The host benchmark defines it on the command line. */
 
-#define    _MULTI_PARTITION    0
+#define    _MULTI_PARTITION    1
 /* When _MULTI_PARTITION is set to 0, each logical drive is bound to same
 /  physical drive number and can mount only 1st primaly partition. When it is
-/  set to 1, each logical drive can mount a partition listed in Drives[]. */
+/  set to 1, each logical drive can mount a partition listed in Drives[].
+/  RAM: 2 bytes per drive (const Drives[] table, defined by the disk layer).
+/  A drive bound to partition 1-3 does not mount an SFD volume and cannot be
+/  formatted by f_mkfs. */
 
-#define _USE_FSINFO    0
+#define _USE_FSINFO    1
 /* To enable FSInfo support on FAT32 volume, set _USE_FSINFO to 1. */
 
+#define _USE_FREEMAP    1
+/* To enable the in-RAM free cluster bitmap (f_freemap), set _USE_FREEMAP to 1.
+/  The bitmap is built on the first allocation after mount, cluster allocation
+/  and f_getfree then work on the bitmap instead of scanning the FAT. Not
+/  available with _FS_READONLY. */
+
+#define _USE_FASTSEEK    1
+/* To enable the cluster extent map of files (f_extmap), set _USE_FASTSEEK to 1.
+/  A file with an extent map seeks without following the FAT chain and reads
+/  contiguous cluster runs with one disk_read. Not available with
+/  _FS_MINIMIZE >= 3. */
+
+#define _USE_ZEROCOPY    1
+/* To enable f_read_zc, set _USE_ZEROCOPY to 1. f_read_zc hands out a pointer
+/  to file data in the file I/O buffer or in a DMA window set by f_zcbuf
+/  instead of copying it. The block must be released with f_read_zc_release
+/  before the file object is used again. */
+
+#define _USE_PREALLOC    1
+/* To enable f_prealloc and f_truncate, set _USE_PREALLOC to 1. f_prealloc
+/  allocates the clusters ahead of the file pointer as one contiguous run if
+/  the volume has one, so that f_write can write across cluster boundaries
+/  with one disk_write. f_truncate releases clusters beyond the file pointer.
+/  Not available with _FS_READONLY. */
+
+#define _USE_LFN    1
+#define _MAX_LFN    255
+/* To enable long file names (VFAT), set _USE_LFN to 1. A name which is not a
+/  valid 8.3 name is looked up by its LFN entries and created with LFN entries
+/  and a short name with numeric tail (~1 - ~5, then hashed). Characters are
+/  stored as Latin-1 (0x00-0xFF), other UCS-2 characters are read as '?'.
+/  f_readdir and f_stat return the long name in FILINFO.lfname if it is set.
+/  RAM: 2 * (_MAX_LFN + 1) bytes static work buffer, 10 bytes per DIR and
+/  6 bytes per FILINFO (plus the lfname buffer of the application). */
+
+#define _USE_DIRHASH    1
+#define _DIRHASH_SLOTS    32
+/* To enable the directory lookup cache, set _USE_DIRHASH to 1. It remembers
+/  the position of recently found names in a 2-way set associative table
+/  keyed on directory and name hash, so that opening the same names again
+/  does not scan the whole directory. A cached position is verified before
+/  use. _DIRHASH_SLOTS must be even.
+/  RAM: 16 * _DIRHASH_SLOTS bytes per FATFS. */
+
+#define _USE_PATHCACHE    1
+#define _PATHCACHE_SLOTS    8
+#define _PATHCACHE_LEN    64
+/* To enable the path cache, set _USE_PATHCACHE to 1. It maps the last
+/  _PATHCACHE_SLOTS full paths found to the position of their entries, so
+/  a hot path is resolved by checking the entries of the object only, without
+/  tracing the directories. A hit needs the same path string, paths of
+/  _PATHCACHE_LEN characters or more are not cached. f_unlink, f_rename and
+/  f_mkdir clear it.
+/  RAM: (20 + _PATHCACHE_LEN) * _PATHCACHE_SLOTS bytes per FATFS. */
+
 #define    _USE_SJIS    1
 /* When _USE_SJIS is set to 1, Shift-JIS code transparency is enabled, otherwise
 /  only US-ASCII(7bit) code can be accepted as file/directory name. */
@@ -85,6 +146,11 @@
 #define   FATFS_SIZE_FS_READONLY   8 /*(2 * 4->DWORD)*/
 #define   FATFS_SIZE_USE_FSINFO   6 /*(1 * 4 ->DWORD) + (2 * 1 ->BYTE)*/
 #define   FATFS_SIZE_S_MAX_SIZE   2 /*(1*2 - WORD)*/
+#if !_FS_READONLY && _USE_FREEMAP
+#define   FATFS_SIZE_USE_FREEMAP 12 /*(1 * 4->pointer)+(2 * 4->DWORD)*/
+#else
+#define   FATFS_SIZE_USE_FREEMAP  0
+#endif
 
 #if !_FS_READONLY && _USE_FSINFO && (S_MAX_SIZ > 512)
 #define   FATFS_SIZE     (FATFS_SIZE_NON_DEPEND \
@@ -109,19 +175,56 @@
 #define   FATFS_SIZE   (FATFS_SIZE_NON_DEPEND)
 #endif
 
-#define   PAD1_SIZE SOC_CACHELINE_SIZE_MAX - (FATFS_SIZE % SOC_CACHELINE_SIZE_MAX)
+#define   PAD1_SIZE SOC_CACHELINE_SIZE_MAX - ((FATFS_SIZE + FATFS_SIZE_USE_FREEMAP) \
+                                          % SOC_CACHELINE_SIZE_MAX)
 #define   FIL_SIZE_NON_DEPEND   28 /*(1*2->WORD)+(6*4->DWORD)+(2*1->BYTE) */
 #define   FIL_SIZE_FS_READONLY   8 /*(2 * 4->DWORD)*/
+#if _USE_FASTSEEK
+#define   FIL_SIZE_USE_FASTSEEK  8 /*(1 * 4->pointer)+(2 * 2->WORD)*/
+#else
+#define   FIL_SIZE_USE_FASTSEEK  0
+#endif
+#if _USE_ZEROCOPY
+#define   FIL_SIZE_USE_ZEROCOPY  8 /*(1 * 4->pointer)+(2 * 1->BYTE)+(1 * 2->WORD)*/
+#else
+#define   FIL_SIZE_USE_ZEROCOPY  0
+#endif
 
 #if  !_FS_READONLY
 #define   FIL_SIZE   SOC_CACHELINE_SIZE_MAX - (FIL_SIZE_NON_DEPEND \
-                                                + FIL_SIZE_FS_READONLY)
+                                                + FIL_SIZE_FS_READONLY \
+                                                + FIL_SIZE_USE_FASTSEEK \
+                                                + FIL_SIZE_USE_ZEROCOPY)
 #else
-#define   FIL_SIZE   SOC_CACHELINE_SIZE_MAX - (FIL_SIZE_NON_DEPEND)
+#define   FIL_SIZE   SOC_CACHELINE_SIZE_MAX - (FIL_SIZE_NON_DEPEND \
+                                                + FIL_SIZE_USE_FASTSEEK \
+                                                + FIL_SIZE_USE_ZEROCOPY)
 #endif
 #define PAD3_SIZE SOC_CACHELINE_SIZE_MAX - (FIL_SIZE % SOC_CACHELINE_SIZE_MAX)
 #endif
 
+#if _USE_DIRHASH || _USE_PATHCACHE
+/* Directory lookup cache slot */
+typedef struct _DHSLOT {
+    DWORD    sclust;        /* Start cluster of the directory (0: static root) */
+    DWORD    clust;        /* Cluster of the first entry of the object */
+    DWORD    sect;        /* Sector of the first entry of the object (0: empty slot) */
+    WORD    index;        /* Index of the first entry of the object */
+    BYTE    tag;        /* Upper bits of the name hash */
+    BYTE    nent;        /* Number of entries of the object (LFN entries + 1) */
+} PACKED DHSLOT;
+#endif
+
+#if _USE_PATHCACHE
+/* Path cache slot */
+typedef struct _PCSLOT {
+    DWORD    hash;        /* Hash of the full path */
+    DHSLOT    pos;        /* Position of the object (pos.sect 0: empty slot) */
+    char    path[_PATHCACHE_LEN];    /* The full path, verified on a hit */
+} PACKED PCSLOT;
+#endif
+
+
 /* File system object structure */
 typedef struct _FATFS {
     WORD    id;                /* File system mount ID */
@@ -140,6 +243,11 @@ typedef struct _FATFS {
     BYTE    fsi_flag;        /* fsinfo dirty flag (1:must be written back) */
     BYTE    pad2;
 #endif
+#if _USE_FREEMAP
+    DWORD*    fmap;            /* Free cluster bitmap, bit set: in use (NULL: scan the FAT) */
+    DWORD    fmap_size;        /* Size of fmap[] in words */
+    DWORD    fmap_valid;        /* fmap[] reflects the FAT */
+#endif
 #endif
     BYTE    fs_type;        /* FAT sub type */
     BYTE    sects_clust;    /* Sectors per cluster */
@@ -157,6 +265,12 @@ typedef struct _FATFS {
     BYTE    pad1;
 #endif
     BYTE    win[S_MAX_SIZ];    /* Disk access window for Directory/FAT */
+#if _USE_DIRHASH
+    DHSLOT    dhash[_DIRHASH_SLOTS];    /* Directory lookup cache */
+#endif
+#if _USE_PATHCACHE
+    PCSLOT    pcache[_PATHCACHE_SLOTS];    /* Path cache, most recently used first */
+#endif
 }PACKED FATFS;
 
 
@@ -168,9 +282,21 @@ typedef struct _DIR {
     DWORD    sclust;        /* Start cluster */
     DWORD    clust;        /* Current cluster */
     DWORD    sect;        /* Current sector */
+#if _USE_LFN
+    DWORD    lfn_clust;    /* Cluster of the first LFN entry of the found object */
+    DWORD    lfn_sect;    /* Sector of the first LFN entry (0: no LFN entries) */
+    WORD    lfn_index;    /* Index of the first LFN entry */
+#endif
 } PACKED DIR;
 
 
+/* Cluster extent of a file, a run of contiguous clusters */
+typedef struct _FEXTENT {
+    DWORD    fofs;        /* Cluster index of the run in the file */
+    DWORD    clust;        /* First cluster of the run */
+} PACKED FEXTENT;
+
+
 /* File object structure */
 typedef struct _FIL {
     WORD    id;                /* Owner file system mount ID */
@@ -186,6 +312,17 @@ typedef struct _FIL {
     DWORD    dir_sect;        /* Sector containing the directory entry */
     BYTE*    dir_ptr;        /* Ponter to the directory entry in the window */
 #endif
+#if _USE_FASTSEEK
+    FEXTENT*    ext;        /* Extent map, ext[n_ext].fofs is the cluster count (NULL: no map) */
+    WORD    n_ext;        /* Number of extents */
+    WORD    pad4;
+#endif
+#if _USE_ZEROCOPY
+    BYTE*    zc_buf;        /* Zero-copy window (NULL: file I/O buffer only) */
+    BYTE    zc_sects;        /* Size of zc_buf[] in sectors */
+    BYTE    zc_pin;        /* A block handed out by f_read_zc is not released */
+    WORD    pad5;
+#endif
 #ifdef SOC_CACHELINE_SIZE_MAX
 #if (PAD3_SIZE != 0)
     BYTE    pad3[PAD3_SIZE];
@@ -202,6 +339,10 @@ typedef struct _FILINFO {
     WORD ftime;                /* Time */
     BYTE fattrib;            /* Attribute */
     char fname[8+1+3+1];    /* Name (8.3 format) */
+#if _USE_LFN
+    char *lfname;            /* Pointer to the long name buffer (NULL: not needed) */
+    WORD lfsize;            /* Size of lfname[] including the terminator */
+#endif
 } PACKED FILINFO;
 
 
@@ -243,7 +384,8 @@ typedef enum {
     FR_NOT_ENABLED,        /* 10 */
     FR_NO_FILESYSTEM,    /* 11 */
     FR_INVALID_OBJECT,    /* 12 */
-    FR_MKFS_ABORTED        /* 13 */
+    FR_MKFS_ABORTED,    /* 13 */
+    FR_NOT_ENOUGH_CORE    /* 14 */
 }PACKED FRESULT;
 
 
@@ -254,13 +396,20 @@ typedef enum {
 FRESULT f_mount (BYTE, FATFS*);                        /* Mount/Unmount a logical drive */
 FRESULT f_open (FIL*, const char*, BYTE);            /* Open or create a file */
 FRESULT f_read (FIL*, void*, WORD, WORD*);            /* Read data from a file */
+FRESULT f_read_zc (FIL*, const BYTE**, WORD*);        /* Read data from a file without copy */
+FRESULT f_read_zc_release (FIL*);                    /* Release the block of f_read_zc */
+FRESULT f_zcbuf (FIL*, BYTE*, BYTE);                /* Set the zero-copy window of a file */
 FRESULT f_write (FIL*, const void*, WORD, WORD*);    /* Write data to a file */
 FRESULT f_lseek (FIL*, DWORD);                        /* Move file pointer of a file object */
+FRESULT f_prealloc (FIL*, DWORD);                    /* Allocate clusters ahead of the file pointer */
+FRESULT f_truncate (FIL*);                            /* Truncate a file at the file pointer */
+FRESULT f_extmap (FIL*, FEXTENT*, WORD);            /* Build the cluster extent map of a file */
 FRESULT f_close (FIL*);                                /* Close an open file object */
 FRESULT f_opendir (DIR*, const char*);                /* Open an existing directory */
 FRESULT f_readdir (DIR*, FILINFO*);                    /* Read a directory item */
 FRESULT f_stat (const char*, FILINFO*);                /* Get file status */
 FRESULT f_getfree (const char*, DWORD*, FATFS**);    /* Get number of free clusters on the drive */
+FRESULT f_freemap (BYTE, DWORD*, DWORD);            /* Register the free cluster bitmap of a drive */
 FRESULT f_sync (FIL*);                                /* Flush cached data of a writing file */
 FRESULT f_unlink (const char*);                        /* Delete an existing file or directory */
 FRESULT    f_mkdir (const char*);                        /* Create a new directory */
@@ -364,6 +513,12 @@ DWORD get_fattime (void);    /* 31-25: Year(0-127 org.1980), 24-21: Month(1-12),
 #define    DIR_FstClusLO        26
 #define    DIR_FileSize        28
 
+#define    LDIR_Ord            0
+#define    LDIR_Attr            11
+#define    LDIR_Type            12
+#define    LDIR_Chksum            13
+#define    LDIR_FstClusLO        26
+
 
 
 /* Multi-byte word access macros  */
@@ -410,6 +410,9 @@ int HSMMCSDBusFreqSet(unsigned int baseAddr, unsigned int freq_in,
 			clkd++;
 		}
 
+        /* The card clock must be off while the divider changes */
+        HWREG(baseAddr + MMCHS_SYSCTL) &= ~MMCHS_SYSCTL_CEN;
+
         regVal = HWREG(baseAddr + MMCHS_SYSCTL) & ~MMCHS_SYSCTL_CLKD;
         HWREG(baseAddr + MMCHS_SYSCTL) = regVal | (clkd << MMCHS_SYSCTL_CLKD_SHIFT);
 
@@ -426,6 +429,70 @@ int HSMMCSDBusFreqSet(unsigned int baseAddr, unsigned int freq_in,
     return 0;
 }    
 
+/**
+ * \brief   Get the output bus frequency
+ *
+ * \param   baseAddr      Base Address of the MMC/SD controller Registers.
+ * \param   freq_in       The input/ref frequency to the controller
+ *
+ * \return  Frequency on the bus as programmed in CLKD, 0 if the card clock
+ *          is disabled
+ **/
+unsigned int HSMMCSDBusFreqGet(unsigned int baseAddr, unsigned int freq_in)
+{
+    unsigned int clkd;
+
+    if (!(HWREG(baseAddr + MMCHS_SYSCTL) & MMCHS_SYSCTL_CEN))
+    {
+        return 0;
+    }
+
+    clkd = (HWREG(baseAddr + MMCHS_SYSCTL) & MMCHS_SYSCTL_CLKD) >>
+                                             MMCHS_SYSCTL_CLKD_SHIFT;
+
+    /* 0 and 1 both bypass the divider */
+    return (clkd < 2) ? freq_in : (freq_in / clkd);
+}
+
+/**
+ * \brief   Enable or disable the high speed timing of the controller
+ *
+ * \param   baseAddr      Base Address of the MMC/SD controller Registers.
+ * \param   speed         HS_MMCSD_BUS_HIGHSPEED or HS_MMCSD_BUS_STDSPEED
+ *
+ * \note: Must match the timing the card was switched to (CMD6).
+ *
+ * \return  None.
+ **/
+void HSMMCSDHighSpeedSet(unsigned int baseAddr, unsigned int speed)
+{
+    HWREG(baseAddr + MMCHS_HCTL) &= ~MMCHS_HCTL_HSPE;
+    HWREG(baseAddr + MMCHS_HCTL) |= speed;
+}
+
+/**
+ * \brief   Get the configured data bus width
+ *
+ * \param   baseAddr      Base Address of the MMC/SD controller Registers.
+ *
+ * \return  HS_MMCSD_BUS_WIDTH_8BIT, HS_MMCSD_BUS_WIDTH_4BIT or
+ *          HS_MMCSD_BUS_WIDTH_1BIT
+ **/
+unsigned int HSMMCSDBusWidthGet(unsigned int baseAddr)
+{
+    if (HWREG(baseAddr + MMCHS_CON) & MMCHS_CON_DW8)
+    {
+        return HS_MMCSD_BUS_WIDTH_8BIT;
+    }
+
+    if (HWREG(baseAddr + MMCHS_HCTL) & MMCHS_HCTL_DTW)
+    {
+        return HS_MMCSD_BUS_WIDTH_4BIT;
+    }
+
+    return HS_MMCSD_BUS_WIDTH_1BIT;
+}
+
 /**
  * \brief   Sends INIT stream to the card
  *
@@ -290,6 +290,9 @@ void HSMMCSDModuleClkConfig(void);
  int HSMMCSDSoftReset(unsigned int baseAddr);
  int HSMMCSDBusFreqSet(unsigned int baseAddr, unsigned int freq_in,
                              unsigned int freq_out, unsigned int bypass);
+ unsigned int HSMMCSDBusFreqGet(unsigned int baseAddr, unsigned int freq_in);
+ void HSMMCSDHighSpeedSet(unsigned int baseAddr, unsigned int speed);
+ unsigned int HSMMCSDBusWidthGet(unsigned int baseAddr);
  void HSMMCSDCommandSend(unsigned int baseAddr, unsigned int cmd,
                                unsigned int cmdarg, void *data,
                                unsigned int nblks, unsigned int dmaEn);
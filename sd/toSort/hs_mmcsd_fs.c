@@ -40,9 +40,11 @@
 */
 
 #include "../thirdParty/fatfs/src/ff.h"
+#include "../thirdParty/fatfs/src/diskio.h"
 #include "cmdline.h"
 #include "hs_mmcsd.h"
 #include "../../console/dr_console.h"
+#include "../../watch/dr_watch.h"
 //#include "consoleUtils.h"
 //#include "uartStdio.h"
 #include "string.h"
@@ -66,6 +68,7 @@ typedef struct _fatDevice
 }fatDevice;
 #endif
 extern fatDevice fat_devices[2];
+extern const DISKIO_OPS mmcsd_diskio;
 
 /*****************************************************************************
 Defines the size of the buffers that hold the path, or temporary data from
@@ -110,9 +113,50 @@ static FATFS g_sFatFs  __attribute__ ((aligned (SOC_CACHELINE_SIZE)));
 
 #endif
 
+#if _MULTI_PARTITION
+/*****************************************************************************
+FAT fs state of the second partition (logical drive 1).
+******************************************************************************/
+#ifdef __IAR_SYSTEMS_ICC__
+#pragma data_alignment=SOC_CACHELINE_SIZE
+static FATFS g_sFatFs2;
+
+#elif defined(__TMS470__)
+#pragma DATA_ALIGN(g_sFatFs2, SOC_CACHELINE_SIZE);
+static FATFS g_sFatFs2;
+
+#elif defined(gcc)
+static FATFS g_sFatFs2  __attribute__ ((aligned (SOC_CACHELINE_SIZE)));
+
+#endif
+#endif
+
+#if !_FS_READONLY && _USE_FREEMAP
+/*****************************************************************************
+Free cluster bitmap of the card, registered with f_freemap at mount. It holds
+HSMMCSD_FS_FREEMAP_CLUSTERS clusters (128k for the default, enough for a 32GB
+card with 32k clusters). Cluster allocation on a bigger volume scans the FAT
+as before, 0 leaves the bitmap out.
+******************************************************************************/
+#ifndef HSMMCSD_FS_FREEMAP_CLUSTERS
+#define HSMMCSD_FS_FREEMAP_CLUSTERS     (1024 * 1024)
+#endif
+
+#if HSMMCSD_FS_FREEMAP_CLUSTERS
+static DWORD g_ulFreeMap[(HSMMCSD_FS_FREEMAP_CLUSTERS + 2 + 31) / 32];
+#endif
+#endif
+
 static DIR g_sDirObject;
 static FILINFO g_sFileInfo;
 
+#if _USE_LFN
+/*****************************************************************************
+Long name of the entry in g_sFileInfo.
+******************************************************************************/
+static char g_cLfnBuf[_MAX_LFN + 1];
+#endif
+
 #ifdef __IAR_SYSTEMS_ICC__
 #pragma data_alignment=SOC_CACHELINE_SIZE
 static FIL g_sFileObject;
@@ -182,7 +226,8 @@ tFresultString g_sFresultStrings[] =
     FRESULT_ENTRY(FR_NOT_ENABLED),
     FRESULT_ENTRY(FR_NO_FILESYSTEM),
     FRESULT_ENTRY(FR_INVALID_OBJECT),
-    FRESULT_ENTRY(FR_MKFS_ABORTED)
+    FRESULT_ENTRY(FR_MKFS_ABORTED),
+    FRESULT_ENTRY(FR_NOT_ENOUGH_CORE)
 };
 
 /*****************************************************************************
@@ -446,6 +491,7 @@ Cmd_ls(int argc, char *argv[])
     unsigned long ulDirCount;
     FRESULT fresult;
     FATFS *pFatFs;
+    char *pcName;
 
     /*
     ** Open the current directory for access.
@@ -464,6 +510,11 @@ Cmd_ls(int argc, char *argv[])
     ulFileCount = 0;
     ulDirCount = 0;
 
+#if _USE_LFN
+    g_sFileInfo.lfname = g_cLfnBuf;
+    g_sFileInfo.lfsize = sizeof(g_cLfnBuf);
+#endif
+
     /*
     ** Enter loop to enumerate through all directory entries.
     */
@@ -508,6 +559,17 @@ Cmd_ls(int argc, char *argv[])
             ulTotalSize += g_sFileInfo.fsize;
         }
 
+        /*
+        ** Show the long name if the entry has one.
+        */
+        pcName = g_sFileInfo.fname;
+#if _USE_LFN
+        if(g_cLfnBuf[0])
+        {
+            pcName = g_cLfnBuf;
+        }
+#endif
+
         /*
         ** Print the entry information on a single line with formatting to show
         ** the attributes, date, time, size, and name.
@@ -524,7 +586,7 @@ Cmd_ls(int argc, char *argv[])
                            (g_sFileInfo.ftime >> 11),
                            (g_sFileInfo.ftime >> 5) & 63,
                             g_sFileInfo.fsize,
-                            g_sFileInfo.fname);
+                            pcName);
     }
 
     /*
@@ -1171,7 +1233,17 @@ Cmd_help(int argc, char *argv[])
     return(0);
 }
 
-
+/*******************************************************************************
+**
+** Clock of the disk statistics. disk_setclock takes a DWORD function, which is
+** not the type of WatchCycleCountGet with every compiler.
+**
+*******************************************************************************/
+static DWORD
+HSMMCSDFsClock(void)
+{
+    return((DWORD) WatchCycleCountGet());
+}
 
 void HSMMCSDFsMount(unsigned int driveNum, void *ptr)
 {
@@ -1180,9 +1252,32 @@ void HSMMCSDFsMount(unsigned int driveNum, void *ptr)
     g_sPState = 0;
     g_sCState = 0;
     f_mount(driveNum, &g_sFatFs);
+#if !_FS_READONLY && _USE_FREEMAP && HSMMCSD_FS_FREEMAP_CLUSTERS
+    /*
+    ** The bitmap is built from the FAT on the first allocation, after that
+    ** allocations and f_getfree do not read the FAT. It serves the first
+    ** partition only.
+    */
+    f_freemap(driveNum, g_ulFreeMap, sizeof(g_ulFreeMap) / sizeof(DWORD));
+#endif
+#if _MULTI_PARTITION
+    /*
+    ** The second partition of the card is logical drive 1 ("1:"), Drives[]
+    ** binds it to the same physical drive. It is mounted on first access.
+    */
+    f_mount(driveNum + 1, &g_sFatFs2);
+#endif
     fat_devices[driveNum].dev = ptr;
     fat_devices[driveNum].fs = &g_sFatFs;
     fat_devices[driveNum].initDone = 0;
+
+    /*
+    ** The card is the disk I/O backend of the physical drive, its commands
+    ** are counted and timed in CPU cycles (disk_getstats).
+    */
+    disk_register(driveNum, &mmcsd_diskio, &fat_devices[driveNum]);
+    WatchCycleCounterInit();
+    disk_setclock(HSMMCSDFsClock);
 }
 
 /*******************************************************************************
@@ -201,6 +201,12 @@ unsigned int HSMMCSDCmdSend(mmcsdCtrlInfo *ctrl, mmcsdCmd *c)
 
     cmd = HS_MMCSD_CMD(c->idx, cmdType, rspType, cmdDir);
 
+    /* Let the controller issue CMD12 after the last block */
+    if (c->flags & SD_CMDRSP_AUTOCMD12)
+    {
+        cmd |= MMCHS_CMD_ACEN;
+    }
+
     if (dataPresent)
     {
         HSMMCSDIntrStatusClear(ctrl->memBase, HS_MMCSD_STAT_TRNFCOMP);
@@ -220,6 +226,11 @@ unsigned int HSMMCSDCmdSend(mmcsdCtrlInfo *ctrl, mmcsdCmd *c)
     {
         HSMMCSDResponseGet(ctrl->memBase, c->rsp);
     }
+    else
+    {
+        /* A command timeout leaves the CMD line busy until it is reset */
+        HSMMCSDLinesReset(ctrl->memBase, HS_MMCSD_CMDLINE_RESET);
+    }
 
     return status;
 }
@@ -244,11 +255,29 @@ void HSMMCSDBusWidthConfig(mmcsdCtrlInfo *ctrl, unsigned int busWidth)
     {
            HSMMCSDBusWidthSet(ctrl->memBase, HS_MMCSD_BUS_WIDTH_1BIT);
     }
+    else if (busWidth == SD_BUS_WIDTH_8BIT)
+    {
+           HSMMCSDBusWidthSet(ctrl->memBase, HS_MMCSD_BUS_WIDTH_8BIT);
+    }
     else
     {
            HSMMCSDBusWidthSet(ctrl->memBase, HS_MMCSD_BUS_WIDTH_4BIT);
     }
 }
+
+/**
+ * \brief   Switch the controller between normal and high speed timing
+ *
+ * \param   mmcsdCtrlInfo It holds the mmcsd control information.
+ * \param   enable        1 for high speed, 0 for normal speed
+ *
+ * \return  None.
+ **/
+void HSMMCSDHighSpeedConfig(mmcsdCtrlInfo *ctrl, unsigned int enable)
+{
+    HSMMCSDHighSpeedSet(ctrl->memBase, enable ? HS_MMCSD_BUS_HIGHSPEED :
+                                                HS_MMCSD_BUS_STDSPEED);
+}
 /**
  * \brief   Set output bus frequency
  *
@@ -49,6 +49,7 @@ extern "C" {
 /* Prototype declarations */
 extern void HSMMCSDBusWidthConfig(mmcsdCtrlInfo *ctrl, unsigned int busWidth);
 extern int HSMMCSDBusFreqConfig(mmcsdCtrlInfo *ctrl, unsigned int busFreq);
+extern void HSMMCSDHighSpeedConfig(mmcsdCtrlInfo *ctrl, unsigned int enable);
 extern unsigned int HSMMCSDCmdSend(mmcsdCtrlInfo *ctrl, mmcsdCmd *c);
 extern unsigned int HSMMCSDControllerInit(mmcsdCtrlInfo *ctrl);
 extern unsigned int HSMMCSDCardPresent(mmcsdCtrlInfo *ctrl);
@@ -63,6 +63,23 @@ static unsigned char dataBuffer[DATA_RESPONSE_WIDTH]
 #error "Unsupported compiler\n\r"
 #endif
 
+/* Cache size aligned buffer for the MMC extended CSD register */
+#ifdef __TMS470__
+#pragma DATA_ALIGN(extCsdBuffer, SOC_CACHELINE_SIZE);
+static unsigned char extCsdBuffer[MMC_EXT_CSD_SIZE];
+
+#elif defined(__IAR_SYSTEMS_ICC__)
+#pragma data_alignment = SOC_CACHELINE_SIZE
+static unsigned char extCsdBuffer[MMC_EXT_CSD_SIZE];
+
+#elif defined(gcc)
+static unsigned char extCsdBuffer[MMC_EXT_CSD_SIZE]
+                               __attribute__((aligned(SOC_CACHELINE_SIZE)));
+
+#else
+#error "Unsupported compiler\n\r"
+#endif
+
 /**
  * \brief   This function sends the command to MMCSD.
  *
@@ -111,6 +128,132 @@ unsigned int MMCSDAppCmdSend(mmcsdCtrlInfo *ctrl, mmcsdCmd *c)
     return status;
 }
 
+/**
+ * \brief   This function sends SD SWITCH_FUNC (CMD6) and reads the 64 byte
+ *          switch status into dataBuffer.
+ *
+ * \param    mmcsdCtrlInfo It holds the mmcsd control information.
+ * \param    arg           Mode (check or switch) and function selection
+ *
+ * \returns  1 - successfull.
+ *           0 - failed.
+ **/
+static unsigned int MMCSDSdSwitchFunc(mmcsdCtrlInfo *ctrl, unsigned int arg)
+{
+    unsigned int status = 0;
+    mmcsdCmd cmd;
+
+    ctrl->xferSetup(ctrl, 1, dataBuffer, 64, 1);
+
+    cmd.idx = SD_CMD(6);
+    cmd.arg = arg;
+    cmd.flags = SD_CMDRSP_READ | SD_CMDRSP_DATA;
+    cmd.nblks = 1;
+    cmd.data = (signed char*)dataBuffer;
+
+    status = MMCSDCmdSend(ctrl, &cmd);
+
+    if (status == 0)
+    {
+        return 0;
+    }
+
+    status = ctrl->xferStatusGet(ctrl);
+
+    /* Invalidate the data cache. */
+   // CacheDataInvalidateBuff((unsigned int) dataBuffer, DATA_RESPONSE_WIDTH);
+
+    return status;
+}
+
+/**
+ * \brief   This function writes a byte of the MMC extended CSD with the
+ *          SWITCH command (CMD6) and waits until the card is back in the
+ *          transfer state.
+ *
+ * \param    mmcsdCtrlInfo It holds the mmcsd control information.
+ * \param    index         EXT_CSD byte index
+ * \param    value         Value to write
+ *
+ * \returns  1 - successfull.
+ *           0 - failed or the card rejected the switch.
+ **/
+static unsigned int MMCSDMmcSwitch(mmcsdCtrlInfo *ctrl, unsigned int index,
+                                   unsigned int value)
+{
+    mmcsdCardInfo *card = ctrl->card;
+    unsigned int retry = 0xFFFF;
+    unsigned int status = 0;
+    mmcsdCmd cmd;
+
+    cmd.idx = SD_CMD(6);
+    cmd.flags = SD_CMDRSP_BUSY;
+    cmd.arg = MMC_SWITCH_WRITE_BYTE(index, value);
+
+    status = MMCSDCmdSend(ctrl, &cmd);
+
+    if (status == 0)
+    {
+        return 0;
+    }
+
+    /* Poll the card status (CMD13) until the switch is done */
+    do {
+        cmd.idx = SD_CMD(13);
+        cmd.flags = 0;
+        cmd.arg = card->rca << 16;
+
+        status = MMCSDCmdSend(ctrl, &cmd);
+
+    } while (((status == 0) || !(cmd.rsp[0] & MMC_STATUS_READY) ||
+              (MMC_STATUS_STATE(cmd.rsp[0]) != MMC_STATE_TRAN)) && --retry);
+
+    if ((retry == 0) || (cmd.rsp[0] & MMC_STATUS_SWITCH_ERROR))
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * \brief   Configure the MMC bus width, 8 bit is used if both the card and
+ *          the controller support it.
+ *
+ * \param    mmcsdCtrlInfo It holds the mmcsd control information.
+ *
+ * \returns  1 - successfull.
+ *           0 - failed.
+ **/
+static unsigned int MMCSDMmcBusWidthSet(mmcsdCtrlInfo *ctrl)
+{
+    mmcsdCardInfo *card = ctrl->card;
+    unsigned int busWidth = SD_BUS_WIDTH_1BIT;
+    unsigned int extCsdWidth = MMC_EXT_CSD_BUS_WIDTH_1;
+
+    if ((ctrl->busWidth & SD_BUS_WIDTH_8BIT) &&
+        (card->busWidth & SD_BUS_WIDTH_8BIT))
+    {
+        busWidth = SD_BUS_WIDTH_8BIT;
+        extCsdWidth = MMC_EXT_CSD_BUS_WIDTH_8;
+    }
+    else if ((ctrl->busWidth & SD_BUS_WIDTH_4BIT) &&
+             (card->busWidth & SD_BUS_WIDTH_4BIT))
+    {
+        busWidth = SD_BUS_WIDTH_4BIT;
+        extCsdWidth = MMC_EXT_CSD_BUS_WIDTH_4;
+    }
+
+    if (MMCSDMmcSwitch(ctrl, MMC_EXT_CSD_BUS_WIDTH, extCsdWidth) == 0)
+    {
+        return 0;
+    }
+
+    ctrl->busWidthConfig(ctrl, busWidth);
+
+    return 1;
+}
+
 /**
  * \brief   Configure the MMC/SD bus width
  *
@@ -131,6 +274,11 @@ unsigned int MMCSDBusWidthSet(mmcsdCtrlInfo *ctrl)
     unsigned int status = 0;
     mmcsdCmd capp;
 
+    if (card->cardType == MMCSD_CARD_MMC)
+    {
+        return MMCSDMmcBusWidthSet(ctrl);
+    }
+
     capp.idx = SD_CMD(6);
     capp.arg = SD_BUS_WIDTH_1BIT;
     capp.flags = 0;
@@ -164,6 +312,13 @@ unsigned int MMCSDBusWidthSet(mmcsdCtrlInfo *ctrl)
 /**
  * \brief    This function configures the transmission speed in MMCSD.
  *
+ * High speed is negotiated only if the controller allows it (highspeed).
+ * SD cards (1.10 and later) are asked with a CMD6 check first and switched
+ * only if they report support, MMC cards are switched through HS_TIMING if
+ * the EXT_CSD lists 52MHz. If the negotiation fails the default speed is
+ * used. The bus frequency never exceeds the requested one, so the real
+ * clock depends on the divider of the controller input clock.
+ *
  * \param    mmcsdCtrlInfo It holds the mmcsd control information.
  *
  * \returns  1 - successfull.
@@ -172,59 +327,60 @@ unsigned int MMCSDBusWidthSet(mmcsdCtrlInfo *ctrl)
 unsigned int MMCSDTranSpeedSet(mmcsdCtrlInfo *ctrl)
 {
     mmcsdCardInfo *card = ctrl->card;
-    unsigned int speed;
+    unsigned int highSpeed = 0;
+    unsigned int freq;
     int status;
-    unsigned int cmdStatus = 0;
-    mmcsdCmd cmd;
 
-    ctrl->xferSetup(ctrl, 1, dataBuffer, 64, 1);
-
-    cmd.idx = SD_CMD(6);
-    cmd.arg = ((SD_SWITCH_MODE & SD_CMD6_GRP1_SEL) | (SD_CMD6_GRP1_HS));
-    cmd.flags = SD_CMDRSP_READ | SD_CMDRSP_DATA;
-    cmd.nblks = 1;
-    cmd.data = (signed char*)dataBuffer;
-
-    cmdStatus = MMCSDCmdSend(ctrl, &cmd);
-
-    if (cmdStatus == 0)
+    if (card->cardType == MMCSD_CARD_MMC)
     {
-        return 0;
-    }
-
-    cmdStatus = ctrl->xferStatusGet(ctrl);
+        if (ctrl->highspeed && (card->tranSpeed == SD_TRANSPEED_50MBPS))
+        {
+            highSpeed = MMCSDMmcSwitch(ctrl, MMC_EXT_CSD_HS_TIMING, 1);
+        }
 
-    if (cmdStatus == 0)
-    {
-        return 0;
+        freq = highSpeed ? MMC_CLK_HIGH_SPEED : MMC_CLK_DEFAULT_SPEED;
     }
+    else
+    {
+        /* CMD6 is defined from version 1.10 on */
+        if (ctrl->highspeed && (card->sd_ver >= SD_VERSION_1P1))
+        {
+            /* Check mode does not change the card, it only reports support */
+            if (MMCSDSdSwitchFunc(ctrl, (SD_CHECK_MODE & SD_CMD6_GRP1_SEL) |
+                                        SD_CMD6_GRP1_HS) &&
+                (SD_CMD6_STAT_GRP1_SUPPORT(dataBuffer) & BIT(SD_CMD6_GRP1_HS)))
+            {
+                if (MMCSDSdSwitchFunc(ctrl, (SD_SWITCH_MODE & SD_CMD6_GRP1_SEL) |
+                                            SD_CMD6_GRP1_HS) &&
+                    (SD_CMD6_STAT_GRP1_SEL(dataBuffer) == SD_CMD6_GRP1_HS))
+                {
+                    highSpeed = 1;
+                }
+            }
+        }
 
-    /* Invalidate the data cache. */
-   // CacheDataInvalidateBuff((unsigned int) dataBuffer, DATA_RESPONSE_WIDTH);
-
-    speed = card->tranSpeed;
+        freq = highSpeed ? SD_CLK_HIGH_SPEED : SD_CLK_DEFAULT_SPEED;
+    }
 
-    if ((dataBuffer[16] & 0xF) == SD_CMD6_GRP1_HS)
+    if (highSpeed)
     {
         card->tranSpeed = SD_TRANSPEED_50MBPS;
     }
 
-    if (speed == SD_TRANSPEED_50MBPS)
-    {
-        status = ctrl->busFreqConfig(ctrl, 50000000);
-        ctrl->opClk = 50000000;
-    }
-    else
+    if (ctrl->highSpeedConfig != NULL)
     {
-        status = ctrl->busFreqConfig(ctrl, 25000000);
-        ctrl->opClk = 25000000;
+        ctrl->highSpeedConfig(ctrl, highSpeed);
     }
 
+    status = ctrl->busFreqConfig(ctrl, freq);
+
     if (status != 0)
     {
         return 0;
     }
 
+    ctrl->opClk = freq;
+
     return 1;
 }
 
@@ -342,6 +498,174 @@ void MMCSDIntEnable(mmcsdCtrlInfo *ctrl)
     return;
 }
 
+/**
+ * \brief   This function intializes a MMC card, the card is left selected
+ *          in the transfer state.
+ *
+ * \param    mmcsdCtrlInfo It holds the mmcsd control information.
+ *
+ * \returns  1 - Intialization is successfull.
+ *           0 - Intialization is failed.
+ **/
+static unsigned int MMCSDMmcCardInit(mmcsdCtrlInfo *ctrl)
+{
+    mmcsdCardInfo *card = ctrl->card;
+    unsigned int retry = 0xFFFF;
+    unsigned int status = 0;
+    mmcsdCmd cmd;
+
+    card->cardType = MMCSD_CARD_MMC;
+
+    /* CMD0 - reset card */
+    status = MMCSDCardReset(ctrl);
+
+    if (status == 0)
+    {
+        return 0;
+    }
+
+    /* Poll CMD1 until the card is powered up (BIT31 of OCR) */
+    do {
+            cmd.idx = SD_CMD(1);
+            cmd.flags = 0;
+            cmd.arg = MMC_OCR_HOST;
+
+            status = MMCSDCmdSend(ctrl, &cmd);
+
+    } while (!(status && (cmd.rsp[0] & ((unsigned int)BIT(31)))) && --retry);
+
+    if (retry == 0)
+    {
+        return 0;
+    }
+
+    card->ocr = cmd.rsp[0];
+
+    card->highCap = (card->ocr & MMC_OCR_SECTOR_MODE) ? 1 : 0;
+
+    /* Send CMD2, to get the card identification register */
+    cmd.idx = SD_CMD(2);
+    cmd.flags = SD_CMDRSP_136BITS;
+    cmd.arg = 0;
+
+    status = MMCSDCmdSend(ctrl,&cmd);
+
+    memcpy(card->raw_cid, cmd.rsp, 16);
+
+    if (status == 0)
+    {
+        return 0;
+    }
+
+    /* Send CMD3, the host assigns the relative address of a MMC */
+    card->rca = MMC_RCA_DEFAULT;
+
+    cmd.idx = SD_CMD(3);
+    cmd.flags = 0;
+    cmd.arg = card->rca << 16;
+
+    status = MMCSDCmdSend(ctrl,&cmd);
+
+    if (status == 0)
+    {
+        return 0;
+    }
+
+    /* Send CMD9, to get the card specific data */
+    cmd.idx = SD_CMD(9);
+    cmd.flags = SD_CMDRSP_136BITS;
+    cmd.arg = card->rca << 16;
+
+    status = MMCSDCmdSend(ctrl,&cmd);
+
+    memcpy(card->raw_csd, cmd.rsp, 16);
+
+    if (status == 0)
+    {
+        return 0;
+    }
+
+    /* The CSD of a MMC has the layout of a version 1.0 SD CSD */
+    card->tranSpeed = SD_CARD0_TRANSPEED(card);
+    card->blkLen = 1 << (SD_CARD0_RDBLKLEN(card));
+    card->nBlks = SD_CARD0_NUMBLK(card);
+    card->size = SD_CARD0_SIZE(card);
+    card->busWidth = SD_BUS_WIDTH_1BIT | SD_BUS_WIDTH_4BIT | SD_BUS_WIDTH_8BIT;
+
+    /* Select the card */
+    cmd.idx = SD_CMD(7);
+    cmd.flags = SD_CMDRSP_BUSY;
+    cmd.arg = card->rca << 16;
+
+    status = MMCSDCmdSend(ctrl,&cmd);
+
+    if (status == 0)
+    {
+        return 0;
+    }
+
+    /* Set data block length to 512 (for byte addressing cards) */
+    if( !(card->highCap) )
+    {
+        cmd.idx = SD_CMD(16);
+        cmd.flags = SD_CMDRSP_48BITS;
+        cmd.arg = 512;
+        status = MMCSDCmdSend(ctrl,&cmd);
+
+        /* R1, the card rejects a block length it does not support */
+        if ((status == 0) || (cmd.rsp[0] & MMC_STATUS_ERRORS))
+        {
+            return 0;
+        }
+    }
+
+    card->blkLen = 512;
+
+    /* Send CMD8, to read the extended CSD (on data lines) */
+    ctrl->xferSetup(ctrl, 1, extCsdBuffer, MMC_EXT_CSD_SIZE, 1);
+
+    cmd.idx = SD_CMD(8);
+    cmd.flags = SD_CMDRSP_READ | SD_CMDRSP_DATA;
+    cmd.arg = 0;
+    cmd.nblks = 1;
+    cmd.data = (signed char*)extCsdBuffer;
+
+    status = MMCSDCmdSend(ctrl,&cmd);
+
+    if (status == 0)
+    {
+        return 0;
+    }
+
+    status = ctrl->xferStatusGet(ctrl);
+
+    if (status == 0)
+    {
+        return 0;
+    }
+
+    /* Invalidate the data cache. */
+   // CacheDataInvalidateBuff((unsigned int)extCsdBuffer, MMC_EXT_CSD_SIZE);
+
+    /* Cards above 2GB report their size in the EXT_CSD only */
+    if (card->highCap)
+    {
+        card->nBlks = (extCsdBuffer[MMC_EXT_CSD_SEC_COUNT + 3] << 24) |
+                      (extCsdBuffer[MMC_EXT_CSD_SEC_COUNT + 2] << 16) |
+                      (extCsdBuffer[MMC_EXT_CSD_SEC_COUNT + 1] << 8) |
+                      (extCsdBuffer[MMC_EXT_CSD_SEC_COUNT]);
+        card->size = card->nBlks * card->blkLen;
+    }
+
+    /* Marks 52MHz support, used by MMCSDTranSpeedSet */
+    if (extCsdBuffer[MMC_EXT_CSD_CARD_TYPE] & MMC_EXT_CSD_CARD_TYPE_52)
+    {
+        card->tranSpeed = SD_TRANSPEED_50MBPS;
+    }
+
+    return 1;
+}
+
 /**
  * \brief   This function intializes the MMCSD Card.
  *
@@ -565,30 +889,59 @@ unsigned int MMCSDCardInit(mmcsdCtrlInfo *ctrl)
 
         card->sd_ver = SD_CARD_VERSION(card);
         card->busWidth = SD_CARD_BUSWIDTH(card);
+        card->cmd23 = SD_CARD_CMD23(card);
     }
     else
+    /* MMC Card */
     {
-        return 0;
+        return MMCSDMmcCardInit(ctrl);
     }
 
     return 1;
 }
 
 /**
- * \brief   This function sends the write command to MMCSD card.
+ * \brief   This function sends SET_BLOCK_COUNT (CMD23) to the card.
  *
  * \param    mmcsdCtrlInfo It holds the mmcsd control information.
- * \param    ptr           It determines the address from where data has to written
- * \param    block         It determines to which block data to be written
- * \param    nblks         It determines the number of blocks to be written
+ * \param    nblks         Number of blocks of the following CMD18/CMD25
  *
- * \returns  1 - successfull written of data.
- *           0 - failure to write the data.
+ * \returns  1 - successfull.
+ *           0 - failed.
  **/
-unsigned int MMCSDWriteCmdSend(mmcsdCtrlInfo *ctrl, void *ptr, unsigned int block,
-                               unsigned int nblks)
+static unsigned int MMCSDBlkCountSet(mmcsdCtrlInfo *ctrl, unsigned int nblks)
+{
+    mmcsdCmd cmd;
+
+    cmd.idx = SD_CMD(23);
+    cmd.flags = 0;
+    cmd.arg = nblks;
+
+    return MMCSDCmdSend(ctrl, &cmd);
+}
+
+/**
+ * \brief   This function transfers up to MMCSD_MAX_XFER_BLKS blocks.
+ *
+ * Multi block transfers are terminated, in order of preference, by a
+ * pre-defined block count (CMD23) if the card supports it, by Auto CMD12
+ * if the controller supports it, or else by an explicit STOP command.
+ *
+ * \param    mmcsdCtrlInfo It holds the mmcsd control information.
+ * \param    rwFlag        1 to read, 0 to write
+ * \param    ptr           It determines the data buffer
+ * \param    block         It determines the first block
+ * \param    nblks         It determines the number of blocks
+ *
+ * \returns  1 - successfull transfer of data.
+ *           0 - failure to transfer the data.
+ **/
+static unsigned int MMCSDXferCmdSend(mmcsdCtrlInfo *ctrl, unsigned char rwFlag,
+                                     void *ptr, unsigned int block,
+                                     unsigned int nblks)
 {
     mmcsdCardInfo *card = ctrl->card;
+    unsigned int stopCmd = 0;
     unsigned int status = 0;
     unsigned int address;
     mmcsdCmd cmd;
@@ -606,25 +959,40 @@ unsigned int MMCSDWriteCmdSend(mmcsdCtrlInfo *ctrl, void *ptr, unsigned int bloc
         address = block * card->blkLen;
     }
 
-    /* Clean the data cache. */
-  //  CacheDataCleanBuff((unsigned int) ptr, (512 * nblks));
-
-    ctrl->xferSetup(ctrl, 0, ptr, 512, nblks);
-
-    cmd.flags = SD_CMDRSP_WRITE | SD_CMDRSP_DATA;
+    cmd.flags = SD_CMDRSP_DATA;
+    cmd.flags |= (rwFlag == 1) ? SD_CMDRSP_READ : SD_CMDRSP_WRITE;
     cmd.arg = address;
     cmd.nblks = nblks;
 
     if (nblks > 1)
     {
-        cmd.idx = SD_CMD(25);
-        cmd.flags |= SD_CMDRSP_ABORT;
+        cmd.idx = (rwFlag == 1) ? SD_CMD(18) : SD_CMD(25);
+
+        if (card->cmd23)
+        {
+            /* Card stops by itself after nblks */
+            status = MMCSDBlkCountSet(ctrl, nblks);
+
+            if (status == 0)
+            {
+                return 0;
+            }
+        }
+        else if (ctrl->autoCmd12)
+        {
+            cmd.flags |= SD_CMDRSP_AUTOCMD12;
+        }
+        else
+        {
+            stopCmd = 1;
+        }
     }
     else
     {
-        cmd.idx = SD_CMD(24);
+        cmd.idx = (rwFlag == 1) ? SD_CMD(17) : SD_CMD(24);
     }
 
+    ctrl->xferSetup(ctrl, rwFlag, ptr, 512, nblks);
 
     status = MMCSDCmdSend(ctrl, &cmd);
 
@@ -641,7 +1009,7 @@ unsigned int MMCSDWriteCmdSend(mmcsdCtrlInfo *ctrl, void *ptr, unsigned int bloc
     }
 
     /* Send a STOP */
-    if (cmd.nblks > 1)
+    if (stopCmd)
     {
         status = MMCSDStopCmdSend(ctrl);
 
@@ -657,73 +1025,73 @@ unsigned int MMCSDWriteCmdSend(mmcsdCtrlInfo *ctrl, void *ptr, unsigned int bloc
 /**
  * \brief   This function sends the write command to MMCSD card.
  *
+ * Transfers of more than MMCSD_MAX_XFER_BLKS blocks are split.
+ *
  * \param    mmcsdCtrlInfo It holds the mmcsd control information.
- * \param    ptr           It determines the address to where data has to read
- * \param    block         It determines from which block data to be read
- * \param    nblks         It determines the number of blocks to be read
+ * \param    ptr           It determines the address from where data has to written
+ * \param    block         It determines to which block data to be written
+ * \param    nblks         It determines the number of blocks to be written
  *
- * \returns  1 - successfull reading of data.
- *           0 - failure to the data.
+ * \returns  1 - successfull written of data.
+ *           0 - failure to write the data.
  **/
-unsigned int MMCSDReadCmdSend(mmcsdCtrlInfo *ctrl, void *ptr, unsigned int block,
-                              unsigned int nblks)
+unsigned int MMCSDWriteCmdSend(mmcsdCtrlInfo *ctrl, void *ptr, unsigned int block,
+                               unsigned int nblks)
 {
-    mmcsdCardInfo *card = ctrl->card;
-    unsigned int status = 0;
-    unsigned int address;
-    mmcsdCmd cmd;
-
-    /*
-     * Address is in blks for high cap cards and in actual bytes
-     * for standard capacity cards
-     */
-    if (card->highCap)
-    {
-        address = block;
-    }
-    else
-    {
-        address = block * card->blkLen;
-    }
-
-    ctrl->xferSetup(ctrl, 1, ptr, 512, nblks);
+    unsigned char *data = (unsigned char *)ptr;
+    unsigned int cnt;
 
-    cmd.flags = SD_CMDRSP_READ | SD_CMDRSP_DATA;
-    cmd.arg = address;
-    cmd.nblks = nblks;
+    /* Clean the data cache. */
+  //  CacheDataCleanBuff((unsigned int) ptr, (512 * nblks));
 
-    if (nblks > 1)
-    {
-        cmd.flags |= SD_CMDRSP_ABORT;
-        cmd.idx = SD_CMD(18);
-    }
-    else
+    while (nblks > 0)
     {
-        cmd.idx = SD_CMD(17);
-    }
+        cnt = (nblks > MMCSD_MAX_XFER_BLKS) ? MMCSD_MAX_XFER_BLKS : nblks;
 
-    status = MMCSDCmdSend(ctrl, &cmd);
-    if (status == 0)
-    {
-        return 0;
+        if (MMCSDXferCmdSend(ctrl, 0, data, block, cnt) == 0)
+        {
+            return 0;
+        }
+
+        data += cnt * 512;
+        block += cnt;
+        nblks -= cnt;
     }
 
-    status = ctrl->xferStatusGet(ctrl);
+    return 1;
+}
 
-    if (status == 0)
-    {
-        return 0;
-    }
+/**
+ * \brief   This function sends the read command to MMCSD card.
+ *
+ * Transfers of more than MMCSD_MAX_XFER_BLKS blocks are split.
+ *
+ * \param    mmcsdCtrlInfo It holds the mmcsd control information.
+ * \param    ptr           It determines the address to where data has to read
+ * \param    block         It determines from which block data to be read
+ * \param    nblks         It determines the number of blocks to be read
+ *
+ * \returns  1 - successfull reading of data.
+ *           0 - failure to the data.
+ **/
+unsigned int MMCSDReadCmdSend(mmcsdCtrlInfo *ctrl, void *ptr, unsigned int block,
+                              unsigned int nblks)
+{
+    unsigned char *data = (unsigned char *)ptr;
+    unsigned int cnt;
 
-    /* Send a STOP */
-    if (cmd.nblks > 1)
+    while (nblks > 0)
     {
-        status = MMCSDStopCmdSend(ctrl);
+        cnt = (nblks > MMCSD_MAX_XFER_BLKS) ? MMCSD_MAX_XFER_BLKS : nblks;
 
-        if (status == 0)
+        if (MMCSDXferCmdSend(ctrl, 1, data, block, cnt) == 0)
         {
             return 0;
         }
+
+        data += cnt * 512;
+        block += cnt;
+        nblks -= cnt;
     }
 
     /* Invalidate the data cache. */
@@ -68,6 +68,7 @@ typedef struct _mmcsdCardInfo {
 	unsigned char busWidth;
 	unsigned char tranSpeed;
 	unsigned char highCap;
+	unsigned char cmd23;
 	unsigned int blkLen;
 	unsigned int nBlks;
 	unsigned int size;
@@ -93,6 +94,7 @@ typedef struct _mmcsdCtrlInfo {
 	unsigned int (*cmdSend) (struct _mmcsdCtrlInfo *ctrl, mmcsdCmd *c);
     void (*busWidthConfig) (struct _mmcsdCtrlInfo *ctrl, unsigned int busWidth);
     int (*busFreqConfig) (struct _mmcsdCtrlInfo *ctrl, unsigned int busFreq);
+    void (*highSpeedConfig) (struct _mmcsdCtrlInfo *ctrl, unsigned int enable);
 	unsigned int (*cmdStatusGet) (struct _mmcsdCtrlInfo *ctrl);
 	unsigned int (*xferStatusGet) (struct _mmcsdCtrlInfo *ctrl);
 	void (*xferSetup) (struct _mmcsdCtrlInfo *ctrl, unsigned char rwFlag,
@@ -103,6 +105,7 @@ typedef struct _mmcsdCtrlInfo {
 	unsigned int dmaEnable;
 	unsigned int busWidth;
 	unsigned int highspeed;
+	unsigned int autoCmd12;
 	unsigned int ocr;
         unsigned int cdPinNum;
         unsigned int wpPinNum;
@@ -122,6 +125,12 @@ typedef struct _mmcsdCtrlInfo {
 #define SD_CMDRSP_DATA			BIT(6)
 #define SD_CMDRSP_READ			BIT(7)
 #define SD_CMDRSP_WRITE			BIT(8)
+#define SD_CMDRSP_AUTOCMD12		BIT(9)
+/* 48 bit response (R1), used when no other response flag is set */
+#define SD_CMDRSP_48BITS		0
+
+/* Maximum number of blocks of one data command (16 bit NBLK / CCNT) */
+#define MMCSD_MAX_XFER_BLKS		(0xFFFFu)
 
 
 
@@ -185,11 +194,14 @@ typedef struct _mmcsdCtrlInfo {
 #define SD_VERSION_2P0		2
 #define SD_BUS_WIDTH_1BIT	1
 #define SD_BUS_WIDTH_4BIT	4
+#define SD_BUS_WIDTH_8BIT	8
 
 /* Helper macros */
 /* Note card registers are big endian */
 #define SD_CARD_VERSION(sdcard)		((sdcard)->raw_scr[0] & 0xF)
 #define SD_CARD_BUSWIDTH(sdcard)	(((sdcard)->raw_scr[0] & 0xF00) >> 8)
+/* SCR CMD_SUPPORT bit 33: SET_BLOCK_COUNT (CMD23) */
+#define SD_CARD_CMD23(sdcard)		(((sdcard)->raw_scr[0] & BIT(25)) ? 1 : 0)
 #define GET_SD_CARD_BUSWIDTH(sdcard)  ((((sdcard.busWidth) & 0x0F) == 0x01) ? \
                                       0x1 : ((((sdcard).busWidth & 0x04) == \
                                       0x04) ? 0x04 : 0xFF))
@@ -203,9 +215,49 @@ typedef struct _mmcsdCtrlInfo {
 
 /* CM6 Swith mode arguments for High Speed */
 #define SD_SWITCH_MODE        0x80FFFFFF
+#define SD_CHECK_MODE         0x00FFFFFF
 #define SD_CMD6_GRP1_SEL      0xFFFFFFF0
 #define SD_CMD6_GRP1_HS       0x1
 
+/* CMD6 status: function group 1 support (byte 13) and selection (byte 16) */
+#define SD_CMD6_STAT_GRP1_SUPPORT(stat)  ((stat)[13])
+#define SD_CMD6_STAT_GRP1_SEL(stat)      ((stat)[16] & 0xF)
+
+/* Bus clocks of default and high speed mode */
+#define SD_CLK_DEFAULT_SPEED  25000000
+#define SD_CLK_HIGH_SPEED     50000000
+#define MMC_CLK_DEFAULT_SPEED 26000000
+#define MMC_CLK_HIGH_SPEED    52000000
+
+/* MMC OCR, sector addressing and 2.7 - 3.6V */
+#define MMC_OCR_SECTOR_MODE   BIT(30)
+#define MMC_OCR_HOST          (MMC_OCR_SECTOR_MODE | 0x00FF8000)
+
+/* MMC relative address assigned by the host */
+#define MMC_RCA_DEFAULT       (1u)
+
+/* MMC SWITCH (CMD6) argument to write a byte of the EXT_CSD */
+#define MMC_SWITCH_WRITE_BYTE(idx, val)  ((3u << 24) | ((idx) << 16) | \
+                                          ((val) << 8))
+
+/* MMC EXT_CSD fields */
+#define MMC_EXT_CSD_SIZE          512
+#define MMC_EXT_CSD_BUS_WIDTH     183
+#define MMC_EXT_CSD_HS_TIMING     185
+#define MMC_EXT_CSD_CARD_TYPE     196
+#define MMC_EXT_CSD_SEC_COUNT     212
+#define MMC_EXT_CSD_CARD_TYPE_52  BIT(1)
+#define MMC_EXT_CSD_BUS_WIDTH_1   0
+#define MMC_EXT_CSD_BUS_WIDTH_4   1
+#define MMC_EXT_CSD_BUS_WIDTH_8   2
+
+/* Card status (R1) fields */
+#define MMC_STATUS_ERRORS         0xFDF90000u  /* error bits 31-26, 24-19, 16 */
+#define MMC_STATUS_SWITCH_ERROR   BIT(7)
+#define MMC_STATUS_READY          BIT(8)
+#define MMC_STATUS_STATE(rsp)     (((rsp) >> 9) & 0xF)
+#define MMC_STATE_TRAN            4
+
 /*
  * Function prototypes
  */
@@ -23,3 +23,69 @@ uint64_t WatchCurrentTimeStamp(void) {
 char* WatchCurrentTimeStampString(void) {
 	return "1000.999";
 }
+
+extern void CPUCycleCounterEnable(void);
+extern uint32_t CPUCycleCounterGet(void);
+
+/* Set once WatchCycleCounterInit enabled the cycle counter */
+static uint32_t watchCycleCounterOn = 0;
+
+/**
+ * \brief Enables and resets the Cortex-A8 PMU cycle counter (CCNT)
+ */
+void WatchCycleCounterEnable(void) {
+	CPUCycleCounterEnable();
+}
+
+/**
+ * \brief Enables the cycle counter on the first call only
+ */
+void WatchCycleCounterInit(void) {
+	if (!watchCycleCounterOn) {
+		CPUCycleCounterEnable();
+		watchCycleCounterOn = 1;
+	}
+}
+
+/**
+ * \brief This function returns the current CPU cycle count
+ */
+uint32_t WatchCycleCountGet(void) {
+	return CPUCycleCounterGet();
+}
+
+/**
+ * \brief Converts a cycle count difference into microseconds
+ */
+uint32_t WatchCyclesToUs(uint32_t cycles) {
+	return cycles / WATCH_CYCLES_PER_US;
+}
+
+/*
+**
+** PMNC: enable counters (E) and reset the cycle counter (C),
+** CNTENS: enable the cycle counter (bit 31)
+**
+*/
+__asm("    .sect \".text:CPUCycleCounterEnable\"\n"
+          "    .clink\n"
+          "    .global CPUCycleCounterEnable\n"
+          "CPUCycleCounterEnable:\n"
+          "    mrc     p15, #0, r0, c9, c12, #0\n"
+          "    orr     r0, r0, #0x5\n"
+          "    mcr     p15, #0, r0, c9, c12, #0\n"
+          "    mov     r0, #0x80000000\n"
+          "    mcr     p15, #0, r0, c9, c12, #1\n"
+          "    bx      lr");
+
+/*
+**
+** Wrapper function for reading CCNT
+**
+*/
+__asm("    .sect \".text:CPUCycleCounterGet\"\n"
+          "    .clink\n"
+          "    .global CPUCycleCounterGet\n"
+          "CPUCycleCounterGet:\n"
+          "    mrc     p15, #0, r0, c9, c13, #0\n"
+          "    bx      lr");
@@ -12,6 +12,13 @@
 
 #include <inttypes.h>
 
+/* MPU clock the cycle counter runs on, override for other OPPs */
+#ifndef WATCH_CPU_CLK_HZ
+#define WATCH_CPU_CLK_HZ				(1000000000u)
+#endif
+
+#define WATCH_CYCLES_PER_US				(WATCH_CPU_CLK_HZ / 1000000u)
+
 /**
  * \brief This function returns a Timespamp in Miliseconds
  *
@@ -26,4 +33,38 @@ uint64_t WatchCurrentTimeStamp(void);
  */
 char* WatchCurrentTimeStampString(void);
 
+/**
+ * \brief Enables and resets the Cortex-A8 PMU cycle counter (CCNT)
+ *
+ * Must be called in privileged mode before WatchCycleCountGet is used.
+ */
+void WatchCycleCounterEnable(void);
+
+/**
+ * \brief Enables the cycle counter on the first call only
+ *
+ * Later calls leave it running, so a driver calling this does not reset
+ * the cycle counter under the measurements of other drivers. Drivers use
+ * this instead of WatchCycleCounterEnable.
+ */
+void WatchCycleCounterInit(void);
+
+/**
+ * \brief This function returns the current CPU cycle count
+ *
+ * The counter is 32 bit and wraps, only use differences of two readings.
+ *
+ * \return Cycle count
+ */
+uint32_t WatchCycleCountGet(void);
+
+/**
+ * \brief Converts a cycle count difference into microseconds
+ *
+ * \param cycles		difference of two WatchCycleCountGet readings
+ *
+ * \return Microseconds
+ */
+uint32_t WatchCyclesToUs(uint32_t cycles);
+
 #endif /* WATCH_H_ */